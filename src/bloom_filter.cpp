@@ -0,0 +1,154 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bloom_filter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "page.h"
+
+namespace badgerdb {
+
+namespace {
+
+const std::uint32_t FILTER_MAGIC = 0x426c6f6f;
+const std::size_t BLOCK_WORDS = 8;
+const std::size_t BLOCK_BITS = BLOCK_WORDS * 64;
+const std::size_t PAGE_WORDS = Page::SIZE / sizeof(std::uint64_t);
+
+// First page of a filter file.
+struct FilterHeader {
+  std::uint32_t magic;
+
+  // Zero while the filter is loaded, one once it has been saved.
+  std::uint32_t clean;
+
+  std::uint64_t num_blocks;
+  std::uint64_t num_keys;
+  std::int32_t num_hashes;
+  std::int32_t bits_per_key;
+};
+
+}
+
+BloomFilter::BloomFilter(const std::size_t expectedKeys, const int bitsPerKey)
+    : num_blocks_(std::max<std::size_t>(
+          1, (expectedKeys * bitsPerKey + BLOCK_BITS - 1) / BLOCK_BITS)),
+      num_hashes_(std::max(1, std::min(12, (bitsPerKey * 69 + 50) / 100))),
+      bits_per_key_(bitsPerKey),
+      num_keys_(0) {
+  blocks_.assign(num_blocks_ * BLOCK_WORDS, 0);
+}
+
+std::uint64_t BloomFilter::hash(const int key) {
+  // Finalizer of MurmurHash3.
+  std::uint64_t h = static_cast<std::uint32_t>(key);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+void BloomFilter::insert(const int key) {
+  const std::uint64_t h = hash(key);
+  std::uint64_t* block =
+      &blocks_[((h >> 32) * num_blocks_ >> 32) * BLOCK_WORDS];
+  const std::uint32_t first = static_cast<std::uint32_t>(h);
+  const std::uint32_t step = (first >> 9) | 1;
+  for (int i = 0; i < num_hashes_; ++i) {
+    const std::uint32_t bit = (first + i * step) % BLOCK_BITS;
+    block[bit / 64] |= std::uint64_t(1) << (bit % 64);
+  }
+  ++num_keys_;
+}
+
+bool BloomFilter::mayContain(const int key) const {
+  const std::uint64_t h = hash(key);
+  const std::uint64_t* block =
+      &blocks_[((h >> 32) * num_blocks_ >> 32) * BLOCK_WORDS];
+  const std::uint32_t first = static_cast<std::uint32_t>(h);
+  const std::uint32_t step = (first >> 9) | 1;
+  for (int i = 0; i < num_hashes_; ++i) {
+    const std::uint32_t bit = (first + i * step) % BLOCK_BITS;
+    if ((block[bit / 64] & (std::uint64_t(1) << (bit % 64))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BloomFilter::save(const std::string& fileName, BufMgr* bufMgr) const {
+  if (File::exists(fileName)) {
+    File::remove(fileName);
+  }
+  BlobFile* file = new BlobFile(fileName, true);
+  PageId header_number;
+  Page* page;
+  bufMgr->allocPage(file, header_number, page);
+  FilterHeader* header = reinterpret_cast<FilterHeader*>(page);
+  header->magic = FILTER_MAGIC;
+  header->clean = 1;
+  header->num_blocks = num_blocks_;
+  header->num_keys = num_keys_;
+  header->num_hashes = num_hashes_;
+  header->bits_per_key = bits_per_key_;
+  bufMgr->unPinPage(file, header_number, true);
+
+  for (std::size_t first = 0; first < blocks_.size(); first += PAGE_WORDS) {
+    PageId page_number;
+    bufMgr->allocPage(file, page_number, page);
+    const std::size_t words = std::min(PAGE_WORDS, blocks_.size() - first);
+    std::memcpy(reinterpret_cast<char*>(page), &blocks_[first],
+                words * sizeof(std::uint64_t));
+    bufMgr->unPinPage(file, page_number, true);
+  }
+  bufMgr->flushFile(file);
+  delete file;
+}
+
+BloomFilter* BloomFilter::load(const std::string& fileName, BufMgr* bufMgr) {
+  if (!File::exists(fileName)) {
+    return NULL;
+  }
+  BlobFile* file = new BlobFile(fileName, false);
+  const PageId header_number = 1;
+  Page* page;
+  bufMgr->readPage(file, header_number, page);
+  FilterHeader* header = reinterpret_cast<FilterHeader*>(page);
+  BloomFilter* filter = NULL;
+  if (header->magic == FILTER_MAGIC && header->clean == 1) {
+    filter = new BloomFilter(0, header->bits_per_key);
+    filter->num_blocks_ = header->num_blocks;
+    filter->num_hashes_ = header->num_hashes;
+    filter->num_keys_ = header->num_keys;
+    filter->blocks_.assign(filter->num_blocks_ * BLOCK_WORDS, 0);
+    header->clean = 0;
+  }
+  bufMgr->unPinPage(file, header_number, filter != NULL);
+
+  if (filter != NULL) {
+    PageId page_number = header_number + 1;
+    for (std::size_t first = 0; first < filter->blocks_.size();
+         first += PAGE_WORDS, ++page_number) {
+      bufMgr->readPage(file, page_number, page);
+      const std::size_t words =
+          std::min(PAGE_WORDS, filter->blocks_.size() - first);
+      std::memcpy(&filter->blocks_[first], page,
+                  words * sizeof(std::uint64_t));
+      bufMgr->unPinPage(file, page_number, false);
+    }
+  }
+  // Writes the open mark out before the filter is used.
+  bufMgr->flushFile(file);
+  delete file;
+  return filter;
+}
+
+}
@@ -0,0 +1,102 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "file.h"
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Blocked Bloom filter over INTEGER keys.
+ *
+ * A key hashes to one 64-byte block, the size of a cache line, and sets a
+ * few bits inside it, so a probe touches one cache line whatever the number
+ * of hash functions.  A negative answer is definite: the key was never
+ * inserted.  A positive answer is wrong with a probability that depends on
+ * the bits per key, about 1% at 10 bits per key as long as no more keys
+ * than expected are inserted.
+ *
+ * The filter is kept in memory.  It is saved to a BlobFile of its own, a
+ * header page followed by the blocks.  A saved filter that is loaded again
+ * is marked as open on disk until it is saved once more, so a filter that
+ * missed inserts because of a crash is not trusted.
+ */
+class BloomFilter {
+ public:
+  /**
+   * Creates an empty filter.
+   *
+   * @param expectedKeys  Number of keys the filter is sized for.
+   * @param bitsPerKey    Bits of filter per expected key.
+   */
+  BloomFilter(const std::size_t expectedKeys, const int bitsPerKey);
+
+  /**
+   * Adds a key.
+   */
+  void insert(const int key);
+
+  /**
+   * Returns false if the key was never inserted, true if it may have been.
+   */
+  bool mayContain(const int key) const;
+
+  /**
+   * Returns the number of keys inserted.
+   */
+  std::size_t numKeys() const { return num_keys_; }
+
+  /**
+   * Returns the size of the filter in bytes.
+   */
+  std::size_t size() const { return blocks_.size() * sizeof(std::uint64_t); }
+
+  /**
+   * Writes the filter to a new file, replacing any file with that name.
+   *
+   * @param fileName  Name of the filter file.
+   * @param bufMgr    Buffer manager the pages are written through.
+   */
+  void save(const std::string& fileName, BufMgr* bufMgr) const;
+
+  /**
+   * Reads a filter saved with save and marks the file as open.
+   *
+   * @param fileName  Name of the filter file.
+   * @param bufMgr    Buffer manager the pages are read through.
+   * @return  The filter, owned by the caller, or NULL if there is no such
+   *          file or it was not saved since it was last loaded.
+   */
+  static BloomFilter* load(const std::string& fileName, BufMgr* bufMgr);
+
+ private:
+  /**
+   * Hashes a key to 64 bits; the high half picks the block, the low half the
+   * bits in it.
+   */
+  static std::uint64_t hash(const int key);
+
+  /**
+   * Eight words per 64-byte block.
+   */
+  std::vector<std::uint64_t> blocks_;
+
+  std::size_t num_blocks_;
+  int num_hashes_;
+  int bits_per_key_;
+  std::size_t num_keys_;
+};
+
+}
@@ -22,6 +22,12 @@
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include <climits>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <queue>
+#include <thread>
 
 
 //#define DEBUG
@@ -39,44 +45,216 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 		const int attrByteOffset,
 		const Datatype attrType)
 {
-  //Construct index file name
-  std::ostringstream idxStr;
-  idxStr << relationName << '.' << attrByteOffset;
-  std::string indexName = idxStr.str(); 
- 
-  //setup instance vars
   bufMgr = bufMgrIn;
   BTreeIndex::attrByteOffset = attrByteOffset;
-  rootPageNum = 0;
-  currentPageNum = 0;
-  nextEntry = -1;
-  scanExecuting = false;
-  
+
   //Opens the file if it exists, otherwise a new index file is created
   //scanned via FileScan, and record is inserted.
-  if(badgerdb::File::exists(indexName)){
-    file = new BlobFile(indexName, false);
+  if(openIndexFile(relationName, outIndexName)){
+    buildFromScan(relationName);
+  }
+}
+
+BTreeIndex::BTreeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType,
+		const std::vector<IncludedAttr> &includedAttrs)
+{
+  bufMgr = bufMgrIn;
+  BTreeIndex::attrByteOffset = attrByteOffset;
+  BTreeIndex::includedAttrs = includedAttrs;
+  if(openIndexFile(relationName, outIndexName)){
+    buildFromScan(relationName);
+  }
+}
+
+void BTreeIndex::buildFromScan(const std::string & relationName)
+{
+  FileScan fileScan(relationName, bufMgr);
+
+  //PAX relation: read the key column a page at a time
+  std::size_t column;
+  if(payloadLength == 0 && fileScan.findColumn(attrByteOffset, column)){
+    while(true){
+      ColumnView keys;
+      try{
+        fileScan.scanNextColumn(column, keys);
+      }catch(EndOfFileException&){
+        break;
+      }
+      const int* values = keys.values<int>();
+      for(SlotId slot = 1; slot <= keys.num_slots; slot++){
+        if(keys.isUsed(slot)){
+          int key = values[slot - 1];
+          RecordId rid = {keys.page_number, slot, 0};
+          insertEntry(&key, rid);
+        }
+      }
+    }
   }else{
-    file = new BlobFile(indexName, true);
-    FileScan fileScan(relationName, bufMgrIn);
-    
     //Scan
+    std::string scratch;
     while(true){
       RecordId rid;  //Get the rid if it exists
       try{
         fileScan.scanNext(rid);
-	//read record for key and insert to tree
-        std::string recordStr =  fileScan.getRecord();
-        const char *record = recordStr.c_str();
-        int key = *((int *)(record + attrByteOffset));
+        //read record for key and insert to tree
+        RecordView record = fileScan.getRecordView(scratch);
+        int key = *((int *)(record.data + attrByteOffset));
         void* keyPtr = &key;
-        insertEntry(keyPtr, rid);
+        insertEntry(keyPtr, rid, record.data);
       }catch(EndOfFileException&){
-	break;
+        break;
       }
     }
   }
+}
+
+BTreeIndex::BTreeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType,
+		const unsigned numThreads,
+		const std::size_t memoryBudget,
+		const int learnedError)
+{
+  bufMgr = bufMgrIn;
+  BTreeIndex::attrByteOffset = attrByteOffset;
+  if(openIndexFile(relationName, outIndexName)){
+    BTreeIndex::learnedError = learnedError;
+    parallelBuild(relationName, numThreads, memoryBudget);
+  }
+}
+
+BTreeIndex::BTreeIndex(const std::string & indexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset)
+{
+  bufMgr = bufMgrIn;
+  BTreeIndex::attrByteOffset = attrByteOffset;
+  payloadLength = 0;
+  if(badgerdb::File::exists(indexName)){
+    badgerdb::File::remove(indexName);
+  }
+  openNamedIndexFile(indexName, "");
+}
+
+bool BTreeIndex::openIndexFile(const std::string & relationName, std::string & outIndexName)
+{
+  //Construct index file name, covering indexes list their included attributes
+  std::ostringstream idxStr;
+  idxStr << relationName << '.' << attrByteOffset;
+  payloadLength = 0;
+  for(size_t i = 0; i < includedAttrs.size(); i++){
+    idxStr << '+' << includedAttrs[i].attrByteOffset;
+    payloadLength += includedAttrs[i].length;
+  }
+  std::string indexName = idxStr.str(); 
   outIndexName = indexName;
+  return openNamedIndexFile(indexName, relationName);
+}
+
+bool BTreeIndex::openNamedIndexFile(const std::string & indexName, const std::string & relationName)
+{
+  //Leaf fan-out for this schema, the entries end where the sibling pointer starts
+  leafOccupancy = offsetof(LeafNodeInt, rightSibPageNo) / (sizeof(int) + sizeof(PackedRecordId) + payloadLength);
+  nodeOccupancy = INTARRAYNONLEAFSIZE;
+  if(leafOccupancy < 4){
+    throw BadIndexInfoException("Included attributes leave no room for entries in a leaf.");
+  }
+  payloadBuffer.assign(payloadLength, 0);
+ 
+  //setup instance vars
+  rootPageNum = 0;
+  currentPageNum = 0;
+  nextEntry = -1;
+  scanExecuting = false;
+  maxKeyInt = INT_MIN;
+  appendStreak = 0;
+  rightLeafNum = 0;
+
+  learnedError = 0;
+  model = NULL;
+  firstLeafNum = 0;
+  modelPageNum = 0;
+
+  //A filter saved next to an index that is created anew belongs to an index that was removed
+  filter = NULL;
+  filterName = indexName + ".filter";
+  headerPageNum = 1;
+  if(badgerdb::File::exists(indexName)){
+    file = new BlobFile(indexName, false);
+    Page *metaPage;
+    bufMgr->readPage(file, headerPageNum, metaPage);
+    IndexMetaInfo meta = *reinterpret_cast<IndexMetaInfo*>(metaPage);
+    bufMgr->unPinPage(file, headerPageNum, false);
+    if(meta.formatVersion != INDEX_FORMAT_VERSION || meta.leafOccupancy != leafOccupancy){
+      bufMgr->flushFile(file);
+      delete file;
+      throw BadIndexInfoException("Index file " + indexName + " has another format, build it again.");
+    }
+    if(relationName.compare(0, sizeof(meta.relationName) - 1, meta.relationName) != 0 ||
+        meta.attrByteOffset != attrByteOffset){
+      bufMgr->flushFile(file);
+      delete file;
+      throw BadIndexInfoException("Index file " + indexName + " is for another relation or attribute.");
+    }
+
+    //Appends are only taken for keys above the largest one, the last key of the rightmost leaf
+    rootPageNum = meta.rootPageNo;
+    if(rootPageNum != 0){
+      loadRightPath();
+      Page *leafPage;
+      bufMgr->readPage(file, rightLeafNum, leafPage);
+      LeafNodeInt *leaf = (struct LeafNodeInt*)leafPage;
+      int count = 0;
+      while(count < leafOccupancy && leaf->keyArray[count] != INT_MAX) count++;
+      if(count > 0) maxKeyInt = leaf->keyArray[count - 1];
+      bufMgr->unPinPage(file, rightLeafNum, false);
+    }
+    if(meta.modelPageNo != 0){
+      modelPageNum = meta.modelPageNo;
+      firstLeafNum = meta.firstLeafNo;
+      model = LearnedModel::load(bufMgr, file, modelPageNum);
+    }
+    filter = BloomFilter::load(filterName, bufMgr);
+    return false;
+  }
+  if(badgerdb::File::exists(filterName)){
+    badgerdb::File::remove(filterName);
+  }
+  file = new BlobFile(indexName, true);
+
+  //The meta page comes first, the tree starts on page 2
+  IndexMetaInfo meta;
+  memset(&meta, 0, sizeof(meta));
+  meta.formatVersion = INDEX_FORMAT_VERSION;
+  strncpy(meta.relationName, relationName.c_str(), sizeof(meta.relationName) - 1);
+  meta.attrByteOffset = attrByteOffset;
+  meta.attrType = INTEGER;
+  meta.rootPageNo = 0;
+  meta.leafOccupancy = leafOccupancy;
+  meta.modelPageNo = 0;
+  meta.firstLeafNo = 0;
+  Page *metaPage;
+  bufMgr->allocPage(file, headerPageNum, metaPage);
+  *reinterpret_cast<IndexMetaInfo*>(metaPage) = meta;
+  bufMgr->unPinPage(file, headerPageNum, true);
+  return true;
+}
+
+void BTreeIndex::writeMeta()
+{
+  Page *metaPage;
+  bufMgr->readPage(file, headerPageNum, metaPage);
+  IndexMetaInfo *meta = reinterpret_cast<IndexMetaInfo*>(metaPage);
+  meta->rootPageNo = rootPageNum;
+  meta->modelPageNo = modelPageNum;
+  meta->firstLeafNo = firstLeafNum;
+  bufMgr->unPinPage(file, headerPageNum, true);
 }
 
 
@@ -86,22 +264,80 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 
 BTreeIndex::~BTreeIndex()
 {
+  try{
+    close();
+  }catch(const BadgerDbException &){
+    //Nothing to report to, close() leaves the file open when it fails
+  }
+  delete filter;
+  delete model;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::close
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::close()
+{
+  if(file == NULL) return;
+
   //Stops any scan if one is occuring
   if(scanExecuting){
     endScan();
   } 
   
-  //Flushes and deconstructs file
+  //Flushes and deconstructs file, the meta page is already up to date
   bufMgr->flushFile(file);
   delete file;
+  file = NULL;
+
+  if(filter != NULL){
+    filter->save(filterName, bufMgr);
+  }
 }
 
 // -----------------------------------------------------------------------------
 // BTreeIndex::insertEntry
 // -----------------------------------------------------------------------------
 
-void BTreeIndex::insertEntry(const void *key, const RecordId rid) 
+void BTreeIndex::insertEntry(const void *key, const RecordId rid, const char *record) 
 {
+  //A covering index keeps the included attributes of the record next to the key
+  const char *payload = NULL;
+  if(payloadLength > 0){
+    if(record == NULL){
+      throw BadIndexInfoException("Covering index needs the record of every entry.");
+    }
+    char *out = &payloadBuffer[0];
+    for(size_t i = 0; i < includedAttrs.size(); i++){
+      memcpy(out, record + includedAttrs[i].attrByteOffset, includedAttrs[i].length);
+      out += includedAttrs[i].length;
+    }
+    payload = &payloadBuffer[0];
+  }
+
+  //A split changes several pages, log them as one atomic action
+  bufMgr->beginAction();
+  const PageId oldRootNum = rootPageNum;
+
+  //Keys arriving in increasing order go straight to the rightmost leaf
+  int keyVal = *((int*)key);
+  if(filter != NULL) filter->insert(keyVal);
+  dropModel();
+  if(keyVal > maxKeyInt){
+    appendStreak++;
+  }else{
+    appendStreak = 0;
+  }
+  if(rootPageNum != 0 && appendStreak > 1){
+    appendRightmost(keyVal, rid, payload);
+    maxKeyInt = keyVal;
+    if(rootPageNum != oldRootNum) writeMeta();
+    bufMgr->commitAction();
+    return;
+  }
+  if(keyVal > maxKeyInt) maxKeyInt = keyVal;
+
   //Case if root has not been initialized
   if(rootPageNum == 0){
     //Create leaf page which will host the key,rid
@@ -115,12 +351,11 @@ void BTreeIndex::insertEntry(const void *key, const RecordId rid)
     LeafNodeInt *leafLeft = (struct LeafNodeInt*)leftLeafPage;
 
     //Initialize leaf keys to max int for scanning purposes
-    for(int i = 0; i < INTARRAYLEAFSIZE; i++){
+    for(int i = 0; i < leafOccupancy; i++){
       leafRight->keyArray[i] =  INT_MAX;
       leafLeft->keyArray[i] = INT_MAX;
     }
-    leafRight->keyArray[0] = *((int*)key);
-    leafRight->ridArray[0] = rid;
+    setLeafEntry(leafRight, 0, *((int*)key), rid, payload);
     leafRight->rightSibPageNo = 0;
     leafLeft->rightSibPageNo = pageNum;
     bufMgr->unPinPage(file, pageNum, true);
@@ -145,11 +380,115 @@ void BTreeIndex::insertEntry(const void *key, const RecordId rid)
     
   }else{ //Case where a root exists, nodes are recursively checked
     int propKey; PageId propPageNo;
-    insertHelper(rootPageNum, key, rid, propKey, propPageNo);
+    insertHelper(rootPageNum, key, rid, payload, propKey, propPageNo);
   }
+  if(rootPageNum != oldRootNum) writeMeta();
+  bufMgr->commitAction();
 }
 
-bool BTreeIndex::insertHelper(PageId currentNum, const void *key, const RecordId rid, int &propKey, PageId &propPageNo){
+void BTreeIndex::appendRightmost(int key, const RecordId rid, const char *payload){
+  if(rightPath.empty()) loadRightPath();
+
+  Page *leafPage;
+  bufMgr->readPage(file, rightLeafNum, leafPage);
+  LeafNodeInt *leaf = (struct LeafNodeInt*)leafPage;
+  int count = 0;
+  while(count < leafOccupancy && leaf->keyArray[count] != INT_MAX) count++;
+
+  //Room left, key goes after every other key
+  if(count < leafOccupancy){
+    setLeafEntry(leaf, count, key, rid, payload);
+    bufMgr->unPinPage(file, rightLeafNum, true);
+    return;
+  }
+
+  //Leaf is full, start a new rightmost leaf holding only this key
+  PageId sibPageNo; Page *sibPage;
+  bufMgr->allocPage(file, sibPageNo, sibPage);
+  LeafNodeInt *sibLeaf = (struct LeafNodeInt*)sibPage;
+  for(int i = 0; i < leafOccupancy; i++){
+    sibLeaf->keyArray[i] = INT_MAX;
+  }
+  setLeafEntry(sibLeaf, 0, key, rid, payload);
+  sibLeaf->rightSibPageNo = leaf->rightSibPageNo;
+  leaf->rightSibPageNo = sibPageNo;
+  bufMgr->unPinPage(file, rightLeafNum, true);
+  bufMgr->unPinPage(file, sibPageNo, true);
+  rightLeafNum = sibPageNo;
+
+  //Propagate the new page upwards along the cached path
+  PageId newChild = sibPageNo;
+  for(int d = (int)rightPath.size() - 1; d >= 0; d--){
+    Page *page;
+    bufMgr->readPage(file, rightPath[d], page);
+    NonLeafNodeInt *node = (struct NonLeafNodeInt*)page;
+    int keys = 0;
+    while(keys < INTARRAYNONLEAFSIZE && node->keyArray[keys] != INT_MAX) keys++;
+
+    if(keys < INTARRAYNONLEAFSIZE){
+      node->keyArray[keys] = key;
+      node->pageNoArray[keys+1] = newChild;
+      bufMgr->unPinPage(file, rightPath[d], true);
+      return;
+    }
+    const int level = node->level;
+    bufMgr->unPinPage(file, rightPath[d], false);
+
+    //Node is full, new sibling starts with the new child as its only pointer
+    PageId sibNodeNo; Page *sibNodePage;
+    bufMgr->allocPage(file, sibNodeNo, sibNodePage);
+    NonLeafNodeInt *sibNode = (struct NonLeafNodeInt*)sibNodePage;
+    for(int i = 0; i < INTARRAYNONLEAFSIZE; i++){
+      sibNode->keyArray[i] = INT_MAX;
+    }
+    sibNode->pageNoArray[INTARRAYNONLEAFSIZE] = INT_MAX;
+    sibNode->pageNoArray[0] = newChild;
+    sibNode->level = level;
+    bufMgr->unPinPage(file, sibNodeNo, true);
+    rightPath[d] = sibNodeNo;
+    newChild = sibNodeNo;
+  }
+
+  //Root was full as well, grow the tree by one level
+  PageId rootNo; Page *rootP;
+  bufMgr->allocPage(file, rootNo, rootP);
+  NonLeafNodeInt *root = (struct NonLeafNodeInt*)rootP;
+  for(int i = 0; i < INTARRAYNONLEAFSIZE; i++){
+    root->keyArray[i] = INT_MAX;
+  }
+  root->pageNoArray[INTARRAYNONLEAFSIZE] = INT_MAX;
+  root->keyArray[0] = key;
+  root->pageNoArray[0] = rootPageNum;
+  root->pageNoArray[1] = newChild;
+  root->level = 0;
+  rootPageNum = rootNo;
+  bufMgr->unPinPage(file, rootNo, true);
+  rightPath.insert(rightPath.begin(), rootNo);
+}
+
+void BTreeIndex::loadRightPath(){
+  rightPath.clear();
+  PageId currentNum = rootPageNum;
+  while(true){
+    Page *page;
+    bufMgr->readPage(file, currentNum, page);
+    NonLeafNodeInt *node = (struct NonLeafNodeInt*)page;
+    int keys = 0;
+    while(keys < INTARRAYNONLEAFSIZE && node->keyArray[keys] != INT_MAX) keys++;
+    PageId childNum = node->pageNoArray[keys];
+    int level = node->level;
+    bufMgr->unPinPage(file, currentNum, false);
+
+    rightPath.push_back(currentNum);
+    if(level == 1){
+      rightLeafNum = childNum;
+      return;
+    }
+    currentNum = childNum;
+  }
+}
+
+bool BTreeIndex::insertHelper(PageId currentNum, const void *key, const RecordId rid, const char *payload, int &propKey, PageId &propPageNo){
   Page *page;
   bufMgr->readPage(file, currentNum, page);
   bufMgr->unPinPage(file, currentNum, false);
@@ -170,14 +509,14 @@ bool BTreeIndex::insertHelper(PageId currentNum, const void *key, const RecordId
 
   //If next level is a leaf then check it, otherwise recurse
   if(node->level == 1){
-    if(insertToLeaf(childNum, key, rid)){
+    if(insertToLeaf(childNum, key, rid, payload)){
       return true; //Case if leaf has space, insertion occurs, all is done
     }
     //Case if leaf needs to split
     Page *child; 
     bufMgr->readPage(file, childNum, child);
     LeafNodeInt *childNode = (struct LeafNodeInt*)child;
-    splitLeaf(childNode, childNum, key, rid, propKey, propPageNo);
+    splitLeaf(childNode, childNum, key, rid, payload, propKey, propPageNo);
     bufMgr->unPinPage(file, childNum, true);
     //propogate key upwards
     bufMgr->readPage(file, currentNum, page);
@@ -196,7 +535,7 @@ bool BTreeIndex::insertHelper(PageId currentNum, const void *key, const RecordId
       return false;
     }
   }else{//recurse further down on first pass, split if needed on seconds pass upwards
-    if(insertHelper(childNum, key, rid, propKey, propPageNo)){
+    if(insertHelper(childNum, key, rid, payload, propKey, propPageNo)){
       return true;
     }
    
@@ -227,18 +566,18 @@ bool BTreeIndex::insertHelper(PageId currentNum, const void *key, const RecordId
   return false;
 }
 
-bool BTreeIndex::insertToLeaf(const PageId pageNum, const void *key, const RecordId rid){
+bool BTreeIndex::insertToLeaf(const PageId pageNum, const void *key, const RecordId rid, const char *payload){
       Page *leafPage;
       bufMgr->readPage(file, pageNum, leafPage);
       LeafNodeInt *leaf = (struct LeafNodeInt*)leafPage;
 
       //Check if space is available to insert into leaf
       //Insert if so, otherwise split
-      if(leaf->keyArray[INTARRAYLEAFSIZE - 1] == INT_MAX){ 
+      if(leaf->keyArray[leafOccupancy - 1] == INT_MAX){ 
         
 	//Find the correct index to insert to
 	int insertIndex;
-        for(int i = 0; i < INTARRAYLEAFSIZE; i++){
+        for(int i = 0; i < leafOccupancy; i++){
           if(*((int*)key) < leaf->keyArray[i]){
             insertIndex = i;
 	    break;
@@ -246,14 +585,12 @@ bool BTreeIndex::insertToLeaf(const PageId pageNum, const void *key, const Recor
         }
 
 	//Shift any elements that may be to the right of the insert index
-	for(int i = INTARRAYLEAFSIZE - 1; i > insertIndex; i--){
-          leaf->keyArray[i] = leaf->keyArray[i-1];
-	  leaf->ridArray[i] = leaf->ridArray[i-1];
+	for(int i = leafOccupancy - 1; i > insertIndex; i--){
+          moveLeafEntry(leaf, i, leaf, i-1);
 	}
 
 	//Insert key,rid
-	leaf->keyArray[insertIndex] = *((int*)key);
-	leaf->ridArray[insertIndex] = rid;
+	setLeafEntry(leaf, insertIndex, *((int*)key), rid, payload);
 	currentPageNum = 0;
 	bufMgr->unPinPage(file, pageNum, true);
 	return true;
@@ -263,10 +600,29 @@ bool BTreeIndex::insertToLeaf(const PageId pageNum, const void *key, const Recor
 
 }
 
-void BTreeIndex::splitLeaf(LeafNodeInt *child, PageId childNo, const void *key, const RecordId rid, int &propKey, PageId &propPageNo){
+void BTreeIndex::moveLeafEntry(LeafNodeInt *to, int toSlot, LeafNodeInt *from, int fromSlot){
+  to->keyArray[toSlot] = from->keyArray[fromSlot];
+  leafRids(to)[toSlot] = leafRids(from)[fromSlot];
+  if(payloadLength > 0){
+    memmove(leafPayloads(to) + toSlot * payloadLength, leafPayloads(from) + fromSlot * payloadLength, payloadLength);
+  }
+}
+
+void BTreeIndex::setLeafEntry(LeafNodeInt *leaf, int slot, int key, const RecordId &rid, const char *payload){
+  leaf->keyArray[slot] = key;
+  leafRids(leaf)[slot] = rid;
+  if(payloadLength > 0){
+    memcpy(leafPayloads(leaf) + slot * payloadLength, payload, payloadLength);
+  }
+}
+
+void BTreeIndex::splitLeaf(LeafNodeInt *child, PageId childNo, const void *key, const RecordId rid, const char *payload, int &propKey, PageId &propPageNo){
  
+  //Rightmost path may change, look it up again on the next append
+   rightPath.clear();
+
   //Splits node at child level into two
-   int mid = (int)(INTARRAYLEAFSIZE/2); //mid index
+   int mid = (int)(leafOccupancy/2); //mid index
    int propogateKey = child->keyArray[mid];
 
    //Create new leaf
@@ -275,13 +631,12 @@ void BTreeIndex::splitLeaf(LeafNodeInt *child, PageId childNo, const void *key,
    LeafNodeInt *sibLeaf = (struct LeafNodeInt*)sibPage;
    
    //set to max
-   for(int i = 0; i < INTARRAYLEAFSIZE; i++){
+   for(int i = 0; i < leafOccupancy; i++){
      sibLeaf->keyArray[i] = INT_MAX;
    }
    //Copy over data
-   for(int i = mid, j = 0; i < INTARRAYLEAFSIZE; i++,j++){
-     sibLeaf->keyArray[j] = child->keyArray[i];
-     sibLeaf->ridArray[j] = child->ridArray[i];
+   for(int i = mid, j = 0; i < leafOccupancy; i++,j++){
+     moveLeafEntry(sibLeaf, j, child, i);
      child->keyArray[i] = INT_MAX;
    }
    sibLeaf->rightSibPageNo = child->rightSibPageNo;
@@ -289,9 +644,9 @@ void BTreeIndex::splitLeaf(LeafNodeInt *child, PageId childNo, const void *key,
 
    //Insert the key and rid, now that the two pages have space
    if(*((int*)key) < propogateKey){
-     insertToLeaf(childNo, key, rid);
+     insertToLeaf(childNo, key, rid, payload);
    }else{
-     insertToLeaf(sibPageNo, key, rid);
+     insertToLeaf(sibPageNo, key, rid, payload);
    }  
    bufMgr->unPinPage(file, sibPageNo, true);
    propPageNo = sibPageNo;
@@ -299,6 +654,7 @@ void BTreeIndex::splitLeaf(LeafNodeInt *child, PageId childNo, const void *key,
 }
 
 void BTreeIndex::splitNonLeaf(NonLeafNodeInt *child, const void *key, PageId pageNo, int &propKey, PageId &propPageNo, bool root){
+  rightPath.clear();
   int mid = (int)(INTARRAYNONLEAFSIZE/2);
   int propogateKey = child->keyArray[mid];
 
@@ -373,6 +729,407 @@ void BTreeIndex::insertNonLeaf(NonLeafNodeInt *node, const void *key, PageId pag
   node->pageNoArray[selectIndex+1] = pageNo;
 }
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertBatch
+// -----------------------------------------------------------------------------
+
+static bool compareBatchKeys(const std::pair<int, RecordId> &a, const std::pair<int, RecordId> &b){
+  return a.first < b.first;
+}
+
+void BTreeIndex::insertBatch(const std::vector<std::pair<int, RecordId> > &entries)
+{
+  if(payloadLength > 0){
+    throw BadIndexInfoException("Covering index needs the record of every entry.");
+  }
+
+  if(filter != NULL){
+    for(size_t i = 0; i < entries.size(); i++) filter->insert(entries[i].first);
+  }
+
+  //Sort a copy of the batch, equal keys keep their relative order
+  std::vector<std::pair<int, RecordId> > sorted(entries);
+  std::stable_sort(sorted.begin(), sorted.end(), compareBatchKeys);
+
+  //The whole batch is applied atomically when a log is attached
+  bufMgr->beginAction();
+  dropModel();
+
+  size_t next = 0;
+  //An empty tree has no leaves yet, let insertEntry create them
+  if(rootPageNum == 0 && next < sorted.size()){
+    insertEntry(&sorted[next].first, sorted[next].second);
+    next++;
+  }
+
+  while(next < sorted.size()){
+    //One descent per leaf, every key below the bound belongs to this leaf
+    PageId leafNo; int upperBound;
+    findLeaf(sorted[next].first, leafNo, upperBound);
+    size_t runEnd = next;
+    while(runEnd < sorted.size() && sorted[runEnd].first < upperBound) runEnd++;
+
+    Page *leafPage;
+    bufMgr->readPage(file, leafNo, leafPage);
+    LeafNodeInt *leaf = (struct LeafNodeInt*)leafPage;
+    int count = 0;
+    while(count < leafOccupancy && leaf->keyArray[count] != INT_MAX) count++;
+
+    //Merge as much of the run as fits, walking backwards so each entry moves once
+    PackedRecordId *rids = leafRids(leaf);
+    int take = (int)std::min(runEnd - next, (size_t)(leafOccupancy - count));
+    int src = count - 1;
+    int dst = count + take - 1;
+    for(int in = (int)next + take - 1; in >= (int)next; dst--){
+      if(src >= 0 && leaf->keyArray[src] > sorted[in].first){
+        leaf->keyArray[dst] = leaf->keyArray[src];
+        rids[dst] = rids[src];
+        src--;
+      }else{
+        leaf->keyArray[dst] = sorted[in].first;
+        rids[dst] = sorted[in].second;
+        in--;
+      }
+    }
+    bufMgr->unPinPage(file, leafNo, take > 0);
+    next += take;
+
+    //Leaf is full but the run is not done, split it through the single key path
+    if(next < runEnd){
+      insertEntry(&sorted[next].first, sorted[next].second);
+      next++;
+    }
+  }
+
+  //Keys merged above bypass insertEntry, keep the append state in line with them
+  if(!sorted.empty() && sorted.back().first > maxKeyInt) maxKeyInt = sorted.back().first;
+  appendStreak = 0;
+  bufMgr->commitAction();
+}
+
+void BTreeIndex::loadSorted(const std::vector<std::pair<int, RecordId> > &entries)
+{
+  if(rootPageNum != 0 || payloadLength > 0){
+    throw BadIndexInfoException("Only an empty index without included attributes can be loaded.");
+  }
+  size_t next = 0;
+  bulkLoad([&](std::pair<int, RecordId> &entry){
+    if(next == entries.size()) return false;
+    entry = entries[next++];
+    return true;
+  });
+}
+
+void BTreeIndex::findLeaf(int key, PageId &leafNo, int &upperBound){
+  upperBound = INT_MAX;
+  PageId currentNum = rootPageNum;
+  while(true){
+    Page *page;
+    bufMgr->readPage(file, currentNum, page);
+    NonLeafNodeInt *node = (struct NonLeafNodeInt*)page;
+
+    //Same child selection as insertHelper: the first separator greater than the key, empty slots hold INT_MAX
+    int i = std::upper_bound(node->keyArray, node->keyArray + INTARRAYNONLEAFSIZE, key) - node->keyArray;
+    PageId childNum = node->pageNoArray[i];
+    if(i < INTARRAYNONLEAFSIZE) upperBound = std::min(upperBound, node->keyArray[i]);
+    int level = node->level;
+    bufMgr->unPinPage(file, currentNum, false);
+
+    if(level == 1){
+      leafNo = childNum;
+      return;
+    }
+    currentNum = childNum;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::parallelBuild
+// -----------------------------------------------------------------------------
+
+//Sorted runs spilled during a parallel build are BlobFiles of pages cast to this structure
+struct SortRunPage{
+  std::uint32_t count;
+  std::pair<int, RecordId> entries[(Page::SIZE - sizeof(std::uint32_t)) / sizeof(std::pair<int, RecordId>)];
+};
+static_assert(sizeof(SortRunPage) <= Page::SIZE, "Sort run page must fit a page.");
+static const std::size_t SORTRUNPAGESIZE = sizeof(SortRunPage::entries) / sizeof(SortRunPage::entries[0]);
+
+//Orders entries by key, then by record id, so builds are deterministic
+static bool compareEntries(const std::pair<int, RecordId> &a, const std::pair<int, RecordId> &b){
+  if(a.first != b.first) return a.first < b.first;
+  if(a.second.page_number != b.second.page_number) return a.second.page_number < b.second.page_number;
+  return a.second.slot_number < b.second.slot_number;
+}
+
+//A sorted run being merged: a block of entries in memory, refilled page by page if the run was spilled
+struct BuildRun{
+  std::vector<std::pair<int, RecordId> > block;
+  size_t pos;
+  BlobFile *file;
+  std::string fileName;
+  std::vector<PageId> pages;
+  size_t nextPage;
+};
+
+void BTreeIndex::parallelBuild(const std::string & relationName, const unsigned numThreads, const std::size_t memoryBudget)
+{
+  //Each worker sorts its share of the budget at a time, at least one run page
+  const size_t runEntries = std::max(memoryBudget / numThreads / sizeof(std::pair<int, RecordId>), SORTRUNPAGESIZE);
+  std::vector<std::vector<std::pair<int, RecordId> > > buffers(numThreads);
+  std::vector<std::vector<BuildRun*> > spilled(numThreads);
+  for(unsigned i = 0; i < numThreads; i++){
+    buffers[i].reserve(runEntries);
+  }
+  std::mutex fileMutex;
+
+  //Workers extract keys from disjoint pages; a full buffer is sorted and spilled as a run
+  {
+    ParallelFileScan scan(relationName, bufMgr);
+    scan.run(numThreads, [&](unsigned worker, Page *page){
+      int keys[PageHeader::MAX_SLOTS];
+      SlotId slots[PageHeader::MAX_SLOTS];
+      size_t count = page->gatherAttribute(attrByteOffset, sizeof(int), (char*)keys, slots);
+      std::vector<std::pair<int, RecordId> > &buffer = buffers[worker];
+      for(size_t i = 0; i < count; i++){
+        if(buffer.size() == runEntries){
+          std::sort(buffer.begin(), buffer.end(), compareEntries);
+          BuildRun *run = new BuildRun();
+          std::ostringstream runName;
+          runName << file->filename() << ".run." << worker << '.' << spilled[worker].size();
+          run->fileName = runName.str();
+          {
+            //The table of open files is not threadsafe
+            std::lock_guard<std::mutex> lock(fileMutex);
+            try{
+              File::remove(run->fileName);
+            }catch(FileNotFoundException&){
+            }
+            run->file = new BlobFile(run->fileName, true);
+          }
+          for(size_t first = 0; first < buffer.size(); first += SORTRUNPAGESIZE){
+            PageId pageNo; Page *runPage;
+            bufMgr->allocPage(run->file, pageNo, runPage);
+            SortRunPage *out = (struct SortRunPage*)runPage;
+            out->count = std::min(SORTRUNPAGESIZE, buffer.size() - first);
+            std::copy(buffer.begin() + first, buffer.begin() + first + out->count, out->entries);
+            bufMgr->unPinPage(run->file, pageNo, true);
+            run->pages.push_back(pageNo);
+          }
+          //Written out and evicted, so the runs do not crowd the buffer pool
+          bufMgr->flushFile(run->file);
+          spilled[worker].push_back(run);
+          buffer.clear();
+        }
+        RecordId rid = {page->page_number(), slots[i], 0};
+        buffer.push_back(std::make_pair(keys[i], rid));
+      }
+    });
+  }
+
+  //Sort what is left in each buffer in parallel
+  std::vector<std::thread> sorters;
+  for(unsigned i = 0; i < numThreads; i++){
+    sorters.push_back(std::thread([&buffers, i](){
+      std::sort(buffers[i].begin(), buffers[i].end(), compareEntries);
+    }));
+  }
+  for(unsigned i = 0; i < numThreads; i++){
+    sorters[i].join();
+  }
+
+  //Gather all runs, in memory and spilled
+  std::vector<BuildRun*> runs;
+  for(unsigned i = 0; i < numThreads; i++){
+    for(size_t j = 0; j < spilled[i].size(); j++){
+      runs.push_back(spilled[i][j]);
+    }
+    BuildRun *run = new BuildRun();
+    run->block.swap(buffers[i]);
+    run->file = NULL;
+    runs.push_back(run);
+  }
+  for(size_t i = 0; i < runs.size(); i++){
+    runs[i]->pos = 0;
+    runs[i]->nextPage = 0;
+  }
+
+  //Refills the block of a spilled run from its next page, false once the run is exhausted
+  BufMgr *bufMgrRef = bufMgr;
+  std::function<bool(BuildRun*)> advance = [bufMgrRef](BuildRun *run){
+    if(run->pos < run->block.size()) return true;
+    if(run->file == NULL || run->nextPage == run->pages.size()) return false;
+    Page *runPage;
+    bufMgrRef->readPage(run->file, run->pages[run->nextPage], runPage);
+    SortRunPage *in = (struct SortRunPage*)runPage;
+    run->block.assign(in->entries, in->entries + in->count);
+    bufMgrRef->unPinPage(run->file, run->pages[run->nextPage], false);
+    run->nextPage++;
+    run->pos = 0;
+    return true;
+  };
+
+  //k-way merge: a heap holds the smallest remaining entry of every run
+  typedef std::pair<std::pair<int, RecordId>, size_t> HeapEntry;
+  std::function<bool(const HeapEntry&, const HeapEntry&)> heapOrder = [](const HeapEntry &a, const HeapEntry &b){
+    return compareEntries(b.first, a.first);
+  };
+  std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::function<bool(const HeapEntry&, const HeapEntry&)> > heap(heapOrder);
+  for(size_t i = 0; i < runs.size(); i++){
+    if(advance(runs[i])){
+      heap.push(HeapEntry(runs[i]->block[runs[i]->pos++], i));
+    }
+  }
+  bulkLoad([&](std::pair<int, RecordId> &entry){
+    if(heap.empty()) return false;
+    HeapEntry top = heap.top();
+    heap.pop();
+    entry = top.first;
+    BuildRun *run = runs[top.second];
+    if(advance(run)){
+      heap.push(HeapEntry(run->block[run->pos++], top.second));
+    }
+    return true;
+  });
+
+  for(size_t i = 0; i < runs.size(); i++){
+    if(runs[i]->file != NULL){
+      bufMgr->flushFile(runs[i]->file);
+      delete runs[i]->file;
+      File::remove(runs[i]->fileName);
+    }
+    delete runs[i];
+  }
+}
+
+void BTreeIndex::bulkLoad(const std::function<bool(std::pair<int, RecordId>&)> &next)
+{
+  //First key and page number of every node of the level being built
+  std::vector<std::pair<int, PageId> > level;
+
+  //Entries of the leaf being filled
+  int keys[INTARRAYLEAFSIZE];
+  RecordId rids[INTARRAYLEAFSIZE];
+  int count = 0;
+  PageId prevLeafNum = 0;
+
+  //First position of every key for the learned model, kept only while the leaves are on consecutive pages
+  std::vector<std::pair<int, std::uint32_t> > points;
+  bool consecutive = learnedError > 0;
+  std::size_t numLeaves = 0;
+
+  std::pair<int, RecordId> entry;
+  bool more = next(entry);
+  while(count > 0 || more){
+    //Fill the leaf, then write it out keeping a trailing run of equal keys for the next leaf
+    while(count < leafOccupancy && more){
+      keys[count] = entry.first;
+      rids[count] = entry.second;
+      count++;
+      more = next(entry);
+    }
+    int cut = count;
+    if(more && count == leafOccupancy && entry.first == keys[count - 1]){
+      while(cut > 0 && keys[cut - 1] == entry.first) cut--;
+      if(cut == 0) cut = count;
+    }
+
+    PageId leafNum; Page *leafPage;
+    bufMgr->allocPage(file, leafNum, leafPage);
+    LeafNodeInt *leaf = (struct LeafNodeInt*)leafPage;
+    for(int i = 0; i < leafOccupancy; i++){
+      leaf->keyArray[i] = i < cut ? keys[i] : INT_MAX;
+    }
+    std::copy(rids, rids + cut, leafRids(leaf));
+    leaf->rightSibPageNo = 0;
+    bufMgr->unPinPage(file, leafNum, true);
+    level.push_back(std::make_pair(keys[0], leafNum));
+
+    if(numLeaves == 0) firstLeafNum = leafNum;
+    consecutive = consecutive && leafNum == firstLeafNum + numLeaves;
+    if(consecutive){
+      for(int i = 0; i < cut; i++){
+        if(points.empty() || points.back().first != keys[i]){
+          points.push_back(std::make_pair(keys[i], (std::uint32_t)(numLeaves * leafOccupancy + i)));
+        }
+      }
+    }
+    numLeaves++;
+    maxKeyInt = keys[cut - 1];
+
+    if(prevLeafNum != 0){
+      Page *prevPage;
+      bufMgr->readPage(file, prevLeafNum, prevPage);
+      ((struct LeafNodeInt*)prevPage)->rightSibPageNo = leafNum;
+      bufMgr->unPinPage(file, prevLeafNum, true);
+    }
+    prevLeafNum = leafNum;
+
+    std::copy(keys + cut, keys + count, keys);
+    std::copy(rids + cut, rids + count, rids);
+    count -= cut;
+  }
+  if(level.empty()) return;
+
+  //Non-leaf levels, each node taking as many children as fit, until one root is left
+  int nodeLevel = 1;
+  do{
+    std::vector<std::pair<int, PageId> > upper;
+    for(size_t first = 0; first < level.size(); first += INTARRAYNONLEAFSIZE + 1){
+      size_t children = std::min(level.size() - first, (size_t)INTARRAYNONLEAFSIZE + 1);
+      PageId nodeNum; Page *nodePage;
+      bufMgr->allocPage(file, nodeNum, nodePage);
+      NonLeafNodeInt *node = (struct NonLeafNodeInt*)nodePage;
+      for(int i = 0; i < INTARRAYNONLEAFSIZE; i++){
+        node->keyArray[i] = INT_MAX;
+      }
+      node->pageNoArray[INTARRAYNONLEAFSIZE] = INT_MAX;
+      node->level = nodeLevel;
+      node->pageNoArray[0] = level[first].second;
+      for(size_t i = 1; i < children; i++){
+        node->keyArray[i - 1] = level[first + i].first;
+        node->pageNoArray[i] = level[first + i].second;
+      }
+      bufMgr->unPinPage(file, nodeNum, true);
+      upper.push_back(std::make_pair(level[first].first, nodeNum));
+    }
+    level.swap(upper);
+    nodeLevel = 0;
+  }while(level.size() > 1);
+
+  rootPageNum = level[0].second;
+  rightPath.clear();
+  appendStreak = 0;
+
+  if(consecutive) trainModel(points, numLeaves);
+  writeMeta();
+}
+
+void BTreeIndex::trainModel(const std::vector<std::pair<int, std::uint32_t> > &points, const std::size_t numLeaves)
+{
+  //The model should take less memory than the non-leaf nodes, about 8 bytes per leaf
+  dropModel();
+  const std::size_t maxSegments = std::max((std::size_t)1, numLeaves / 2);
+  //The error doubles until the model fits, the last try allowing half a leaf
+  const int maxError = leafOccupancy / 2;
+  int error = learnedError;
+  while(model == NULL && error <= maxError){
+    model = LearnedModel::train(points, error, maxSegments);
+    error = error < maxError ? std::min(error * 2, maxError) : maxError + 1;
+  }
+  if(model != NULL) modelPageNum = model->save(bufMgr, file);
+}
+
+void BTreeIndex::dropModel()
+{
+  delete model;
+  model = NULL;
+  if(modelPageNum != 0){
+    modelPageNum = 0;
+    writeMeta();
+  }
+}
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::startScan
 // -----------------------------------------------------------------------------
@@ -403,6 +1160,18 @@ void BTreeIndex::startScan(const void* lowValParm,
   if(highOp == GT || highOp == GTE){
     throw BadOpcodesException();
   }
+
+  //An empty tree has no root to descend from
+  if(rootPageNum == 0){
+    throw NoSuchKeyFoundException();
+  }
+
+  //A range holding a single key is ruled out by the filter without a descent
+  long long first = lowOp == GT ? (long long)lowValInt + 1 : lowValInt;
+  long long last = highOp == LT ? (long long)highValInt - 1 : highValInt;
+  if(first == last && !mayContain((int)first)){
+    throw NoSuchKeyFoundException();
+  }
  
   if(currentPageNum == 0) currentPageNum = rootPageNum;
 
@@ -429,7 +1198,7 @@ void BTreeIndex::startScan(const void* lowValParm,
     LeafNodeInt *leaf = (struct LeafNodeInt*)currentPageData;
 
     //Verify leaf contains key
-    for(int i = 0; i < INTARRAYLEAFSIZE; i++){
+    for(int i = 0; i < leafOccupancy; i++){
 
       //if current leaf is empty, check the next leaf to see if it has valid values
       if(leaf->keyArray[i] == INT_MAX){
@@ -480,6 +1249,11 @@ bool BTreeIndex::verifyKey(int key){
 // -----------------------------------------------------------------------------
 
 void BTreeIndex::scanNext(RecordId& outRid) 
+{
+  scanNext(outRid, NULL);
+}
+
+void BTreeIndex::scanNext(RecordId& outRid, void *outPayload) 
 {
   if(!scanExecuting){
     throw ScanNotInitializedException();
@@ -492,13 +1266,16 @@ void BTreeIndex::scanNext(RecordId& outRid)
   //verify current key is within paramaters
   LeafNodeInt *leaf = (struct LeafNodeInt*)currentPageData;
   if(verifyKey(leaf->keyArray[nextEntry])){
-    outRid = leaf->ridArray[nextEntry];		
+    outRid = leafRids(leaf)[nextEntry];		
+    if(outPayload != NULL){
+      memcpy(outPayload, leafPayloads(leaf) + nextEntry * payloadLength, payloadLength);
+    }
   }else{
     throw IndexScanCompletedException();
   }
  
   //Increment next entry
-  if(nextEntry < INTARRAYLEAFSIZE - 1){
+  if(nextEntry < leafOccupancy - 1){
     nextEntry++;
   }else{
     //Case where end of full page has been reached.
@@ -546,4 +1323,245 @@ void BTreeIndex::endScan()
   scanExecuting = false;
 }
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookup
+// -----------------------------------------------------------------------------
+
+//Stores the first max record ids and counts all of them
+struct LookupArray{
+  RecordId *out;
+  std::size_t max;
+  std::size_t count;
+  void operator()(const RecordId &rid){
+    if(count < max) out[count] = rid;
+    count++;
+  }
+};
+
+//Appends every record id
+struct LookupVector{
+  std::vector<RecordId> &out;
+  void operator()(const RecordId &rid){
+    out.push_back(rid);
+  }
+};
+
+//Prefetches the cache lines read by the first three probes of a binary search over n keys
+static inline void prefetchSearch(const int *keys, const int n){
+  for(int parts = 2; parts <= 8; parts *= 2){
+    for(int i = 1; i < parts; i += 2){
+      __builtin_prefetch(keys + n * i / parts);
+    }
+  }
+}
+
+//Lookups descend with the key before the one searched for, which leads left of a separator equal to the key,
+//to the first leaf that can hold it when equal keys straddle leaves
+static inline int lookupProbe(const int key){
+  return key == INT_MIN ? key : key - 1;
+}
+
+std::size_t BTreeIndex::lookup(const int key, RecordId *out, const std::size_t max)
+{
+  LookupArray emit = {out, max, 0};
+  //INT_MAX marks empty slots and cannot be a key
+  if(rootPageNum == 0 || key == INT_MAX || !mayContain(key)) return 0;
+  if(model != NULL){
+    learnedMatches(key, emit);
+    return emit.count;
+  }
+
+  PageId leafNum;
+  int upperBound;
+  findLeaf(lookupProbe(key), leafNum, upperBound);
+  Page *page;
+  bufMgr->readPage(file, leafNum, page);
+  leafMatches(leafNum, page, key, emit);
+  return emit.count;
+}
+
+std::size_t BTreeIndex::lookupBatch(const std::vector<int> &keys, std::vector<RecordId> &outRids,
+		std::vector<std::size_t> &outOffsets)
+{
+  //Number of keys descended together
+  static const std::size_t GROUP = 16;
+
+  outRids.clear();
+  outOffsets.assign(1, 0);
+  if(rootPageNum == 0){
+    outOffsets.resize(keys.size() + 1, 0);
+    return 0;
+  }
+
+  LookupVector emit = {outRids};
+  if(model != NULL){
+    for(std::size_t i = 0; i < keys.size(); i++){
+      if(keys[i] != INT_MAX && mayContain(keys[i])) learnedMatches(keys[i], emit);
+      outOffsets.push_back(outRids.size());
+    }
+    return outRids.size();
+  }
+
+  PageId pageNums[GROUP];
+  Page *pages[GROUP];
+  std::size_t members[GROUP];
+  std::size_t next = 0;
+  while(next < keys.size()){
+    //Keys ruled out by the filter, and INT_MAX which marks empty slots, have no entries and join no group
+    std::size_t count = 0;
+    std::size_t end = next;
+    for(; end < keys.size() && count < GROUP; end++){
+      if(keys[end] != INT_MAX && mayContain(keys[end])) members[count++] = end;
+    }
+    for(std::size_t i = 0; i < count; i++) pageNums[i] = rootPageNum;
+
+    //One level of the whole group at a time, down to the leaves. Keys on the same node as the key before
+    //them, always the case at the root, share its pin.
+    bool leaves = count == 0;
+    while(!leaves){
+      for(std::size_t i = 0; i < count; i++){
+        if(i > 0 && pageNums[i] == pageNums[i - 1]){
+          pages[i] = pages[i - 1];
+          continue;
+        }
+        bufMgr->readPage(file, pageNums[i], pages[i]);
+        prefetchSearch(((struct NonLeafNodeInt*)pages[i])->keyArray, INTARRAYNONLEAFSIZE);
+      }
+      for(std::size_t i = 0; i < count; i++){
+        NonLeafNodeInt *node = (struct NonLeafNodeInt*)pages[i];
+        int child = std::upper_bound(node->keyArray, node->keyArray + INTARRAYNONLEAFSIZE,
+                                     lookupProbe(keys[members[i]])) - node->keyArray;
+        leaves = node->level == 1;
+        if(i + 1 == count || pages[i + 1] != pages[i]){
+          bufMgr->unPinPage(file, pageNums[i], false);
+        }
+        pageNums[i] = node->pageNoArray[child];
+      }
+    }
+
+    for(std::size_t i = 0; i < count; i++){
+      bufMgr->readPage(file, pageNums[i], pages[i]);
+      prefetchSearch(((struct LeafNodeInt*)pages[i])->keyArray, leafOccupancy);
+    }
+    for(std::size_t m = 0; next < end; next++){
+      if(m < count && members[m] == next){
+        leafMatches(pageNums[m], pages[m], keys[next], emit);
+        m++;
+      }
+      outOffsets.push_back(outRids.size());
+    }
+  }
+  return outRids.size();
+}
+
+template <class Emit>
+void BTreeIndex::learnedMatches(const int key, Emit &emit)
+{
+  //The model was trained on every key in the leaves
+  if(key < model->minKey() || key > model->maxKey()) return;
+
+  //The first entry of a key is at most the error bound, plus rounding, away from the prediction. Start in
+  //the leaf of the prediction, and move left within the bound while that leaf starts at or after the key.
+  std::size_t position = model->predict(key);
+  std::size_t window = model->maxError() + 1;
+  std::size_t leaf = position / leafOccupancy;
+  std::size_t firstLeaf = (position > window ? position - window : 0) / leafOccupancy;
+  PageId leafNum = firstLeafNum + leaf;
+  Page *page;
+  bufMgr->readPage(file, leafNum, page);
+  while(leaf > firstLeaf && ((struct LeafNodeInt*)page)->keyArray[0] >= key){
+    bufMgr->unPinPage(file, leafNum, false);
+    leaf--;
+    leafNum--;
+    bufMgr->readPage(file, leafNum, page);
+  }
+  leafMatches(leafNum, page, key, emit);
+}
+
+template <class Emit>
+void BTreeIndex::leafMatches(PageId leafNum, Page *page, const int key, Emit &emit)
+{
+  while(true){
+    LeafNodeInt *leaf = (struct LeafNodeInt*)page;
+    const PackedRecordId *rids = leafRids(leaf);
+    int i = std::lower_bound(leaf->keyArray, leaf->keyArray + leafOccupancy, key) - leaf->keyArray;
+    for(; i < leafOccupancy && leaf->keyArray[i] == key; i++){
+      emit(rids[i]);
+    }
+
+    //Equal keys may go on in the right sibling, which may also be where the key starts
+    PageId sibNum = leaf->rightSibPageNo;
+    bool more = sibNum != 0 && (i == leafOccupancy || leaf->keyArray[i] == INT_MAX);
+    bufMgr->unPinPage(file, leafNum, false);
+    if(!more) return;
+    leafNum = sibNum;
+    bufMgr->readPage(file, leafNum, page);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::buildFilter
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::buildFilter(const int bitsPerKey)
+{
+  //Keys of the leaf chain, from the leftmost leaf
+  std::vector<int> keys;
+  if(rootPageNum != 0){
+    PageId leafNum;
+    int upperBound;
+    findLeaf(INT_MIN, leafNum, upperBound);
+    while(leafNum != 0){
+      Page *page;
+      bufMgr->readPage(file, leafNum, page);
+      LeafNodeInt *leaf = (struct LeafNodeInt*)page;
+      for(int i = 0; i < leafOccupancy && leaf->keyArray[i] != INT_MAX; i++){
+        keys.push_back(leaf->keyArray[i]);
+      }
+      PageId sibNum = leaf->rightSibPageNo;
+      bufMgr->unPinPage(file, leafNum, false);
+      leafNum = sibNum;
+    }
+  }
+
+  delete filter;
+  filter = new BloomFilter(keys.size(), bitsPerKey);
+  for(size_t i = 0; i < keys.size(); i++) filter->insert(keys[i]);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getTreeStats
+// -----------------------------------------------------------------------------
+
+TreeStats BTreeIndex::getTreeStats()
+{
+  TreeStats stats = {0, 0, 0};
+  if(rootPageNum == 0) return stats;
+
+  //Non-leaf nodes a level at a time, counting the children of the level above the leaves as leaves
+  std::vector<PageId> nodes(1, rootPageNum);
+  while(!nodes.empty()){
+    stats.height++;
+    stats.nonLeafPages += nodes.size();
+    std::vector<PageId> children;
+    bool leaves = false;
+    for(size_t n = 0; n < nodes.size(); n++){
+      Page *page;
+      bufMgr->readPage(file, nodes[n], page);
+      NonLeafNodeInt *node = (struct NonLeafNodeInt*)page;
+      int count = std::lower_bound(node->keyArray, node->keyArray + INTARRAYNONLEAFSIZE, INT_MAX) - node->keyArray;
+      leaves = node->level == 1;
+      if(leaves){
+        stats.leafPages += count + 1;
+      }else{
+        children.insert(children.end(), node->pageNoArray, node->pageNoArray + count + 1);
+      }
+      bufMgr->unPinPage(file, nodes[n], false);
+    }
+    if(leaves) stats.height++;
+    nodes.swap(children);
+  }
+  return stats;
+}
+
 }
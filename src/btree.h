@@ -11,42 +11,31 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <vector>
+#include <utility>
+#include <functional>
 
 #include "types.h"
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
+#include "bloom_filter.h"
+#include "learned_model.h"
 
 namespace badgerdb
 {
 
 /**
- * @brief Datatype enumeration type.
- */
-enum Datatype
-{
-	INTEGER = 0,
-	DOUBLE = 1,
-	STRING = 2
-};
-
-/**
- * @brief Scan operations enumeration. Passed to BTreeIndex::startScan() method.
+ * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-enum Operator
-{ 
-	LT, 	/* Less Than */
-	LTE,	/* Less Than or Equal to */
-	GTE,	/* Greater Than or Equal to */
-	GT		/* Greater Than */
-};
-
+//                                                  sibling ptr             key               rid
+const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PackedRecordId ) );
 
 /**
- * @brief Number of key slots in B+Tree leaf for INTEGER key.
+ * @brief Version of the index file format, stored in the meta page. Version 2 packs the record ids of
+ * the leaves into 6 bytes and keeps the root in the meta page. Version 3 saves the learned model.
  */
-//                                                  sibling ptr             key               rid
-const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+const  int INDEX_FORMAT_VERSION = 3;
 
 /**
  * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
@@ -89,26 +78,33 @@ public:
 /**
  * @brief Overloaded operator to compare the key values of two rid-key pairs
  * and if they are the same compares to see if the first pair has
- * a smaller rid.pageNo value.
+ * a smaller rid.pageNo value, then a smaller rid.slotNo value.
 */
 template <class T>
 bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
 {
 	if( r1.key != r2.key )
 		return r1.key < r2.key;
-	else
+	else if( r1.rid.page_number != r2.rid.page_number )
 		return r1.rid.page_number < r2.rid.page_number;
+	else
+		return r1.rid.slot_number < r2.rid.slot_number;
 }
 
 /**
  * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
  * to the following structure to store or retrieve information from it.
- * Contains the relation name for which the index is created, the byte offset
- * of the key value on which the index is made, the type of the key and the page no
- * of the root page. Root page starts as page 2 but since a split can occur
+ * Contains the format version, the relation name for which the index is created, the byte offset
+ * of the key value on which the index is made, the type of the key, the page no
+ * of the root page and the number of entries in a leaf. Root page starts as page 2 but since a split can occur
  * at the root the root page may get moved up and get a new page no.
 */
 struct IndexMetaInfo{
+  /**
+   * Format of the index file, INDEX_FORMAT_VERSION.
+   */
+	int formatVersion;
+
   /**
    * Name of base relation.
    */
@@ -128,6 +124,57 @@ struct IndexMetaInfo{
    * Page number of root page of the B+ Tree inside the file index file.
    */
 	PageId rootPageNo;
+
+  /**
+   * Number of entries in a leaf, which the included attributes of a covering index lower.
+   */
+	int leafOccupancy;
+
+  /**
+   * First page of the saved learned model, 0 if the index has none.
+   */
+	PageId modelPageNo;
+
+  /**
+   * Page number of the leftmost leaf, where the positions of the learned model start.
+   */
+	PageId firstLeafNo;
+};
+
+/**
+ * @brief Shape of a B+ tree, as reported by BTreeIndex::getTreeStats.
+*/
+struct TreeStats{
+  /**
+   * Number of levels, the leaves included.
+   */
+	int height;
+
+  /**
+   * Number of non-leaf pages.
+   */
+	std::size_t nonLeafPages;
+
+  /**
+   * Number of leaf pages.
+   */
+	std::size_t leafPages;
+};
+
+/**
+ * @brief Fixed-width attribute of the relation that a covering index stores in its leaves next to the key,
+ * so index-only scans can return it without reading the record.
+*/
+struct IncludedAttr{
+  /**
+   * Offset of the attribute inside the records.
+   */
+	int attrByteOffset;
+
+  /**
+   * Length of the attribute in bytes.
+   */
+	int length;
 };
 
 /*
@@ -160,6 +207,9 @@ struct NonLeafNodeInt{
 
 /**
  * @brief Structure for all leaf nodes when the key is of INTEGER type.
+ * A covering index fits fewer entries in a leaf: only the first leafOccupancy slots of keyArray are used,
+ * its record ids follow right after them, and the included attributes of every entry after the record ids.
+ * BTreeIndex::leafRids and BTreeIndex::leafPayloads find them for any index.
 */
 struct LeafNodeInt{
   /**
@@ -168,9 +218,9 @@ struct LeafNodeInt{
 	int keyArray[ INTARRAYLEAFSIZE ];
 
   /**
-   * Stores RecordIds.
+   * Stores RecordIds, packed without their padding.
    */
-	RecordId ridArray[ INTARRAYLEAFSIZE ];
+	PackedRecordId ridArray[ INTARRAYLEAFSIZE ];
 
   /**
    * Page number of the leaf on the right side.
@@ -186,6 +236,11 @@ struct LeafNodeInt{
 */
 class BTreeIndex {
 
+  /**
+   * Walks the leaf chain directly for the join operators.
+   */
+  friend class IndexLeafCursor;
+
  private:
 
   /**
@@ -219,7 +274,7 @@ class BTreeIndex {
 	int 		attrByteOffset;
 
   /**
-   * Number of keys in leaf node, depending upon the type of key.
+   * Number of keys in leaf node, depending upon the type of key and the included attributes.
    */
 	int			leafOccupancy;
 
@@ -228,6 +283,92 @@ class BTreeIndex {
    */
 	int			nodeOccupancy;
 
+  /**
+   * Attributes stored next to the key in every leaf entry, empty unless the index is covering.
+   */
+	std::vector<IncludedAttr>	includedAttrs;
+
+  /**
+   * Total length of the included attributes of an entry.
+   */
+	int			payloadLength;
+
+  /**
+   * Included attributes of the entry being inserted.
+   */
+	std::vector<char>	payloadBuffer;
+
+  /**
+   * Membership filter over the keys, NULL unless buildFilter was called or a saved filter was found.
+   */
+	BloomFilter	*filter;
+
+  /**
+   * Name of the file the filter is saved to, next to the index file.
+   */
+	std::string	filterName;
+
+  /**
+   * Target error of the learned model, zero if the index does not train one when it is bulk loaded.
+   */
+	int			learnedError;
+
+  /**
+   * Model predicting the position of a key among the leaf slots, NULL if there is none. Position p is slot
+   * p % leafOccupancy of the leaf on page firstLeafNum + p / leafOccupancy.
+   */
+	LearnedModel	*model;
+
+  /**
+   * Page number of the leftmost leaf, the leaves of a bulk load are on consecutive pages.
+   */
+	PageId	firstLeafNum;
+
+  /**
+   * First page the learned model is saved on, 0 if there is no model.
+   */
+	PageId	modelPageNum;
+
+  /**
+   * Returns the record ids of a leaf, which follow its leafOccupancy keys.
+   */
+	PackedRecordId* leafRids(LeafNodeInt *leaf) const
+	{
+		return reinterpret_cast<PackedRecordId*>(reinterpret_cast<char*>(leaf) + leafOccupancy * sizeof(int));
+	}
+
+  /**
+   * Returns the included attributes of a leaf, payloadLength bytes per entry after its record ids.
+   */
+	char* leafPayloads(LeafNodeInt *leaf) const
+	{
+		return reinterpret_cast<char*>(leafRids(leaf) + leafOccupancy);
+	}
+
+
+	// MEMBERS SPECIFIC TO APPENDING
+
+  /**
+   * Largest INTEGER key inserted so far.
+   */
+	int			maxKeyInt;
+
+  /**
+   * Number of consecutive inserts whose key was larger than every key before it.
+   */
+	int			appendStreak;
+
+  /**
+   * Page number of the rightmost leaf. Only meaningful while rightPath is not empty.
+   */
+	PageId	rightLeafNum;
+
+  /**
+   * Non-leaf pages from the root down to the parent of the rightmost leaf.
+   * Empty when it has to be looked up again, which happens after any split done by the regular insert path.
+   */
+	std::vector<PageId>	rightPath;
+
 
 	// MEMBERS SPECIFIC TO SCANNING
 
@@ -308,17 +449,76 @@ class BTreeIndex {
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
 						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+
+  /**
+   * BTreeIndex Constructor which builds a new index in parallel.
+	 * Opens the index file if it exists, like the constructor above. Otherwise numThreads workers scan disjoint
+	 * pages of the relation, extract the keys and sort them. Whenever a worker's share of the memory budget
+	 * fills up, its sorted run is spilled to a temporary BlobFile. The runs are then merged k-way and the
+	 * tree is written bottom-up: full leaves first, then each level of non-leaf nodes above them.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @param numThreads					Number of worker threads scanning and sorting the relation
+   * @param memoryBudget				Bytes of keys and record ids held in memory at a time while building
+   * @param learnedError				If positive, also trains a learned model of the leaves with this error bound, see
+   *                          getLearnedModel
+   */
+	BTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const unsigned numThreads, const std::size_t memoryBudget, const int learnedError = 0);
+
+  /**
+   * BTreeIndex Constructor for a covering index.
+	 * Like the first constructor, but every leaf entry also stores the values of the included attributes of
+	 * its record, which scanNext can return without reading the record. The leaf fan-out shrinks to what fits
+	 * with them. The name of the index file lists the included offsets after the key offset.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @param includedAttrs				Attributes to store in the leaves, in the order scanNext returns them
+   * @throws  BadIndexInfoException     If the included attributes do not leave room for a few entries per leaf.
+   */
+	BTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const std::vector<IncludedAttr> &includedAttrs);
+
+  /**
+   * BTreeIndex Constructor for an empty index over part of a relation.
+	 * The caller names the index file, which replaces any file of that name, and adds the entries with
+	 * loadSorted, insertEntry or insertBatch.
+   *
+   * @param indexName						Name of the index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of the INTEGER attribute, over which index is to be built, in the record
+   */
+	BTreeIndex(const std::string & indexName, BufMgr *bufMgrIn, const int attrByteOffset);
 	
 
   /**
    * BTreeIndex Destructor. 
-	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
-	 * and delete file instance thereby closing the index file.
+	 * Closes the index file if close() was not called.
 	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself. 
+	 * An index that cannot be flushed keeps its file open, so no frame is left pointing at a deleted file.
 	 * */
 	~BTreeIndex();
 
 
+  /**
+	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
+	 * and delete file instance thereby closing the index file. Saves the filter if the index has one.
+	 * Does nothing if the index is already closed.
+	 * @throws PagePinnedException if a page of the index is still pinned
+	 **/
+	void close();
+
+
   /**
 	 * Insert a new entry using the pair <value,rid>. 
 	 * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
@@ -327,8 +527,29 @@ class BTreeIndex {
 	 * Make sure to unpin pages as soon as you can.
    * @param key			Key to insert, pointer to integer/double/char string
    * @param rid			Record ID of a record whose entry is getting inserted into the index.
+   * @param record	The record, from which a covering index copies its included attributes. May be NULL otherwise.
+   * @throws  BadIndexInfoException     If the index is covering and no record is given.
+	**/
+	void insertEntry(const void* key, const RecordId rid, const char *record = NULL);
+
+	/**
+	 * Insert a batch of <key,rid> pairs.
+	 * The batch is sorted by key and then applied one leaf at a time: the tree is descended once for each
+	 * leaf that receives keys, and the run of keys which belongs to that leaf is merged into it in a single pass.
+	 * When a leaf fills up before its run is exhausted, the next key goes through insertEntry so the leaf is
+	 * split in the usual way, and the rest of the run is applied after descending again.
+	 * @param entries		Pairs of integer key and Record ID to insert. Need not be sorted.
+   * @throws  BadIndexInfoException     If the index is covering, as the entries carry no records.
 	**/
-	void insertEntry(const void* key, const RecordId rid);
+	void insertBatch(const std::vector<std::pair<int, RecordId> > &entries);
+
+	/**
+	 * Load an empty index from <key,rid> pairs sorted by key.
+	 * The tree is written bottom-up with full leaves, like the parallel constructor does.
+	 * @param entries		Pairs of integer key and Record ID to insert, in key order.
+   * @throws  BadIndexInfoException     If the index is not empty or is covering.
+	**/
+	void loadSorted(const std::vector<std::pair<int, RecordId> > &entries);
         
 	/**
 	 *A helper method for insertion
@@ -337,7 +558,97 @@ class BTreeIndex {
          *@param rid Record ID of a record whose entry is getting inserted into the index.
 	 *@returns true if the entry was successfully inserted, false if the leaf is full and a split needs to occur.
 	 */
-        bool insertHelper(PageId currentNum, const void *key, const RecordId rid, int &propKey, PageId &propPageNo);
+        bool insertHelper(PageId currentNum, const void *key, const RecordId rid, const char *payload, int &propKey, PageId &propPageNo);
+
+	/**
+	 *Helper method for insert Entry.
+	 *Appends a key that is larger than every key in the tree directly to the rightmost leaf, without
+	 *descending from the root. When the leaf is full the key starts a new leaf on its own (a 100/0 split)
+	 *so sequentially loaded leaves stay full, and full non-leaf nodes on the rightmost path split the same way.
+	 *@param key - Key to insert, must be greater than maxKeyInt
+	 *@param rid - rid to insert
+	 *@param payload - included attributes of the entry, NULL if the index is not covering
+	 **/
+	void appendRightmost(int key, const RecordId rid, const char *payload);
+
+	/**
+	 *Helper method for appendRightmost.
+	 *Walks down the rightmost pointers from the root and caches the path in rightPath and rightLeafNum.
+	 **/
+	void loadRightPath();
+
+	/**
+	 *Helper method for the constructors.
+	 *Sets up the members and opens the index file, creating it if it does not exist.
+	 *@param relationName - name of the base relation
+	 *@param outIndexName - (value returned via reference)name of the index file
+	 *@return - true if the index file was created and has to be built
+	 **/
+	bool openIndexFile(const std::string & relationName, std::string & outIndexName);
+
+	/**
+	 *Helper method for openIndexFile.
+	 *Sets up the members for the included attributes already chosen and opens the named index file,
+	 *creating it if it does not exist.
+	 *An existing index file is checked against the meta page and its root restored.
+	 *@param indexName - name of the index file
+	 *@param relationName - name of the base relation, recorded in the meta page
+	 *@return - true if the index file was created and has to be built
+	 *@throws BadIndexInfoException if the existing file has another format, relation or attribute
+	 **/
+	bool openNamedIndexFile(const std::string & indexName, const std::string & relationName);
+
+	/**
+	 *Writes the current root and learned model to the meta page.
+	 *Called whenever either changes, inside the logged action changing it, so recovery restores them with the tree.
+	 **/
+	void writeMeta();
+
+	/**
+	 *Helper method for the serial constructors.
+	 *Inserts an entry for every record of the relation, read with a FileScan.
+	 *@param relationName - name of the base relation
+	 **/
+	void buildFromScan(const std::string & relationName);
+
+	/**
+	 *Helper method for leaf changes.
+	 *Copies the key, rid and included attributes of one leaf entry over another.
+	 **/
+	void moveLeafEntry(LeafNodeInt *to, int toSlot, LeafNodeInt *from, int fromSlot);
+
+	/**
+	 *Helper method for leaf changes.
+	 *Sets the key, rid and included attributes of a leaf entry.
+	 *@param payload - included attributes of the entry, NULL if the index is not covering
+	 **/
+	void setLeafEntry(LeafNodeInt *leaf, int slot, int key, const RecordId &rid, const char *payload);
+
+	/**
+	 *Helper method for the parallel constructor.
+	 *Extracts and sorts the keys of the relation with numThreads workers within the memory budget,
+	 *then merges the sorted runs into bulkLoad.
+	 **/
+	void parallelBuild(const std::string & relationName, const unsigned numThreads, const std::size_t memoryBudget);
+
+	/**
+	 *Helper method for parallelBuild.
+	 *Writes the tree bottom-up from entries in key order: leaves filled completely and linked left to right,
+	 *then non-leaf levels until a single root remains. A run of equal keys is not split across two leaves
+	 *unless it fills a whole leaf, so that scans starting at such a key find all of it.
+	 *@param next - called for each entry in key order, returns false when there are none left
+	 **/
+	void bulkLoad(const std::function<bool(std::pair<int, RecordId>&)> &next);
+
+	/**
+	 *Helper method for batch insertion.
+	 *Descends from the root to the leaf which should hold the key.
+	 *@param key - the key to search for
+	 *@param leafNo - (value returned via reference)page number of the leaf
+	 *@param upperBound - (value returned via reference)smallest separator key greater than key along the path,
+	 *                    INT_MAX if the leaf is the rightmost one. Every key of the leaf is less than this bound.
+	 **/
+	void findLeaf(int key, PageId &leafNo, int &upperBound);
 
 	/**
 	 *Helper method for insert Entry.
@@ -346,9 +657,10 @@ class BTreeIndex {
 	 *@param currentPageNum - the page number to scan
 	 *@param key - Key to insert
 	 *@param rid - rid to insert
+	 *@param payload - included attributes of the entry, NULL if the index is not covering
 	 *@return - true if the entry was successfully inserted, false if the leaf is full and a split needs to occur.
 	 **/
-	bool insertToLeaf(const PageId currentPageNum, const void *key, const RecordId rid);
+	bool insertToLeaf(const PageId currentPageNum, const void *key, const RecordId rid, const char *payload);
 
 	        /**
          *Helper method to split a leaf into two leaves when it is full.
@@ -356,10 +668,11 @@ class BTreeIndex {
 	 *param childNo - the page number of the child leaf
          *@param key - Key to insert after the leaf has split
          *@param rid - rid to insert after the leaf has split
+         *@param payload - included attributes to insert after the leaf has split, NULL if the index is not covering
          *@param propKey - (value returned via poitner)the middle key of the leaf before splitting which needs to be inserted in parent node
 	 *@param propPageNo - (value returned via pointer)the newly created leafs page number which needs to be inserted in parent node
          **/
-	void splitLeaf(LeafNodeInt *child, PageId childNo, const void *key, const RecordId rid, int &propKey, PageId &propPageNo);
+	void splitLeaf(LeafNodeInt *child, PageId childNo, const void *key, const RecordId rid, const char *payload, int &propKey, PageId &propPageNo);
 
                 /**
          *Helper method to split a nonleaf into two nonleaves when it is full.
@@ -414,12 +727,117 @@ class BTreeIndex {
 	**/
 	void scanNext(RecordId& outRid);  // returned record id
 
+  /**
+	 * Fetch the record id and the included attributes of the next index entry that matches the scan.
+	 * Same as scanNext above, which this is for covering indexes.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outPayload	Receives getPayloadLength() bytes: the included attributes, one after the other
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	void scanNext(RecordId& outRid, void *outPayload);
+
+  /**
+	 * Returns the total length of the included attributes, zero if the index is not covering.
+	**/
+	int getPayloadLength() const { return payloadLength; }
+
 
   /**
 	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	**/
 	void endScan();
+
+  /**
+	 * Finds the entries with the given key without starting a scan: one descent from the root and a binary
+	 * search in the leaf, moving right only while equal keys continue in the next leaf. A running scan is
+	 * not affected.
+   * @param key		The key to look up
+   * @param out		Receives the record ids of the first max matching entries, in index order
+   * @param max		Capacity of out
+   * @return	Number of entries with the key, which may be larger than max
+	**/
+	std::size_t lookup(const int key, RecordId *out, const std::size_t max);
+
+  /**
+	 * Looks up many keys at once. The keys are descended in groups a level at a time: the nodes of the whole
+	 * group are pinned and the cache lines of their first binary search probes prefetched before any of them
+	 * is searched, so the cache misses of different keys overlap instead of following each other.
+   * @param keys		The keys to look up, in any order
+   * @param outRids	Receives the record ids of all matching entries, those of keys[i] from outOffsets[i] to
+   *                outOffsets[i + 1]
+   * @param outOffsets	Receives keys.size() + 1 offsets into outRids
+   * @return	Total number of matching entries
+	**/
+	std::size_t lookupBatch(const std::vector<int> &keys, std::vector<RecordId> &outRids,
+						std::vector<std::size_t> &outOffsets);
+
+  /**
+	 * Builds a Bloom filter over the keys of the index from its leaves, replacing any filter it had.
+	 * From then on insertEntry and insertBatch add their keys to it, lookup, lookupBatch and startScan on a
+	 * single key skip keys it rules out without reading any page, and the destructor saves it in a file
+	 * named after the index with ".filter" appended. Opening the index again loads that file.
+   * @param bitsPerKey	Bits of filter per key in the index; 10 gives about 1% false positives
+	**/
+	void buildFilter(const int bitsPerKey);
+
+  /**
+	 * Returns false if the filter rules the key out, true if it may be in the index or there is no filter.
+	**/
+	bool mayContain(const int key) const { return filter == NULL || filter->mayContain(key); }
+
+  /**
+	 * Returns the filter, NULL if the index has none.
+	**/
+	const BloomFilter* getFilter() const { return filter; }
+
+  /**
+	 * Returns the learned model of the leaves, NULL if there is none.
+	 * A model is trained by the bulk load of the parallel constructor when asked for. It maps a key to a
+	 * position among the leaf slots within its error bound, so lookup and lookupBatch go straight to the leaf
+	 * without reading any non-leaf node. If the keys need more segments than half the number of leaves the
+	 * bound is doubled, up to half a leaf; past that no model is kept and lookups use the tree. Any insert
+	 * drops the model, as it only describes the leaves of the bulk load.
+	 * The model is saved in the index file and loaded again when the index is opened. The pages of a
+	 * dropped model stay unused in the file.
+	**/
+	const LearnedModel* getLearnedModel() const { return model; }
+
+  /**
+	 * Walks the non-leaf levels and returns the height and the number of pages of the tree.
+	**/
+	TreeStats getTreeStats();
+
+ private:
+  /**
+	 * Helper method for lookup and lookupBatch.
+	 * Passes the record id of every entry with the key to emit, starting in the given leaf and moving right.
+	 * The leaf must be pinned, and every leaf visited is unpinned.
+	**/
+	template <class Emit>
+	void leafMatches(PageId leafNum, Page *page, const int key, Emit &emit);
+
+  /**
+	 * Helper method for lookup and lookupBatch.
+	 * Passes the record id of every entry with the key to emit, starting from the leaf the learned model
+	 * predicts for it.
+	**/
+	template <class Emit>
+	void learnedMatches(const int key, Emit &emit);
+
+  /**
+	 * Helper method for bulkLoad.
+	 * Trains the learned model on the first position of every key, doubling the error bound from
+	 * learnedError until the model is small enough, and saves it in the index file.
+	 **/
+	void trainModel(const std::vector<std::pair<int, std::uint32_t> > &points, const std::size_t numLeaves);
+
+  /**
+	 * Drops the learned model, which no longer describes the leaves once an entry is inserted, and
+	 * removes it from the meta page.
+	 **/
+	void dropModel();
 	
 };
 
@@ -6,8 +6,15 @@
  */
 
 #include <memory>
+#include <functional>
+#include <new>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <pthread.h>
+#include <sched.h>
 #include "buffer.h"
+#include "log_manager.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
@@ -16,144 +23,522 @@
 
 namespace badgerdb { 
 
+/**
+ * Frames the background writer copies per round, to keep the pool lock short
+ */
+static const std::uint32_t WRITER_BATCH = 8;
+
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
-	bufDescTable = new BufDesc[bufs];
-
-  for (FrameId i = 0; i < bufs; i++) 
+BufMgr::BufMgr(std::uint32_t bufs, LogManager *log, const PoolOptions &options)
+	: numBufs(bufs), logMgr(log), shadowPool(NULL), ioWaiters(0), stopWriting(false), cleanTarget(0), checkpointInterval(0) {
+	poolMemory = new PoolMemory((std::size_t)bufs * sizeof(Page), options.huge_pages);
+	descMemory = new PoolMemory((std::size_t)bufs * sizeof(BufDesc), options.huge_pages);
+	bufPool = reinterpret_cast<Page*>(poolMemory->data());
+	bufDescTable = reinterpret_cast<BufDesc*>(descMemory->data());
+
+  // One partition per NUMA node, split on huge page boundaries of the pool
+  const std::uint32_t numNodes = options.numa ? std::max(1, std::min<int>(PoolMemory::numNodes(), bufs)) : 1;
+  const std::uint32_t framesPerHugePage = PoolMemory::HUGE_PAGE_SIZE / sizeof(Page);
+  nodeFirstFrame.push_back(0);
+  for (std::uint32_t node = 1; node < numNodes; node++)
   {
-  	bufDescTable[i].frameNo = i;
-  	bufDescTable[i].valid = false;
+    FrameId first = (std::uint64_t)bufs * node / numNodes;
+    nodeFirstFrame.push_back(first - first % framesPerHugePage);
   }
+  nodeFirstFrame.push_back(bufs);
 
-  bufPool = new Page[bufs];
+  // Each node's partition is first touched by a thread on that node, which places it there
+  std::vector<std::thread> threads;
+  for (std::uint32_t node = 0; node < numNodes; node++)
+  {
+    const FrameId first = nodeFirstFrame[node];
+    const FrameId end = nodeFirstFrame[node + 1];
+    std::function<void()> init = [this, first, end]() {
+      for (FrameId i = first; i < end; i++)
+      {
+        new (&bufDescTable[i]) BufDesc();
+        bufDescTable[i].frameNo = i;
+        new (&bufPool[i]) Page();
+      }
+    };
+    nodeClockHands.push_back(end > first ? end - 1 : first);
+    nodeFreeFrames.push_back(end - first);
+    if (numNodes == 1)
+    {
+      init();
+      continue;
+    }
+    poolMemory->bindToNode(first * sizeof(Page), (end - first) * sizeof(Page), node);
+    descMemory->bindToNode(first * sizeof(BufDesc), (end - first) * sizeof(BufDesc), node);
+    threads.push_back(PoolMemory::startOnNode(node, init));
+  }
+  for (std::size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
 
   int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
   hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
 
   clockHand = bufs - 1;
+
+  if (logMgr != NULL)
+  {
+    shadowPool = new Page[bufs];
+    File::setLogManager(logMgr);
+  }
 }
 
 
 BufMgr::~BufMgr() {
+  stopWriter();
+
   //Flush out all unwritten pages
+  std::lock_guard<std::mutex> lock(poolMutex);
+  std::vector<FrameId> frames;
   for (std::uint32_t i = 0; i < numBufs; i++) 
   {
   	BufDesc* tmpbuf = &(bufDescTable[i]);
   	if (tmpbuf->valid == true && tmpbuf->dirty == true)
 		{
-			tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
+			frames.push_back(i);
   	}
   }
+  writeFrames(frames);
 
+  if (logMgr != NULL)
+  {
+    File::setLogManager(NULL);
+    delete [] shadowPool;
+  }
 	delete hashTable;
-  delete [] bufDescTable;
-  delete [] bufPool;
+  for (std::uint32_t i = 0; i < numBufs; i++)
+  {
+    bufDescTable[i].~BufDesc();
+    bufPool[i].~Page();
+  }
+  delete descMemory;
+  delete poolMemory;
 }
 
 void BufMgr::allocBuf(FrameId & frame) 
 {
   // perform first part of clock algorithm to search for 
-  // open buffer frame
-  // Assumes non-concurrent access to buffer manager
-  std::uint32_t numScanned = 0;
+  // open buffer frame, in the partition of the caller's NUMA node first
+  // Called with poolMutex held, which is released while a dirty victim is written
+  const std::uint32_t numNodes = nodeClockHands.size();
+  std::uint32_t startNode = numNodes > 1 ? PoolMemory::currentNode() % numNodes : 0;
   bool found = 0;
+  bool writing = false;
 
-  while (numScanned < 2*numBufs)	//Need to scn twice
+  // a free frame on another node beats evicting a page on this one
+  for (std::uint32_t n = 0; n < numNodes && nodeFreeFrames[startNode] == 0; n++)
   {
-    // advance the clock
-    advanceClock();
-    numScanned++;
+    if (nodeFreeFrames[(startNode + n) % numNodes] > 0)
+      startNode = (startNode + n) % numNodes;
+  }
 
-    // if invalid, use frame
-    if (! bufDescTable[clockHand].valid)
-    {
-      break;
-    }
+  for (std::uint32_t n = 0; n < numNodes && !found; n++)
+  {
+    const std::uint32_t node = (startNode + n) % numNodes;
+    const FrameId first = nodeFirstFrame[node];
+    const FrameId end = nodeFirstFrame[node + 1];
+    clockHand = nodeClockHands[node];
+    std::uint32_t numScanned = 0;
 
-    // is valid, check referenced bit
-    if (! bufDescTable[clockHand].refbit)
+    while (numScanned < 2*(end - first))	//Need to scn twice
     {
-      // check to see if someone has it pinned
-      if (bufDescTable[clockHand].pinCnt == 0)
+      // advance the clock
+      advanceClock(first, end);
+      numScanned++;
+
+      // if invalid, use frame
+      if (! bufDescTable[clockHand].valid)
       {
-        // hasn't been referenced and is not pinned, use it
-        // remove previous entry from hash table
-        hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
+        if (nodeFreeFrames[node] > 0)
+          nodeFreeFrames[node]--;
         found = true;
         break;
       }
+
+      // frames being written are not available until the write is done
+      if (bufDescTable[clockHand].writing)
+      {
+        writing = true;
+      }
+      // is valid, check referenced bit
+      else if (! bufDescTable[clockHand].refbit)
+      {
+        // check to see if someone has it pinned
+        if (bufDescTable[clockHand].pinCnt == 0)
+        {
+          // hasn't been referenced and is not pinned, use it
+          found = true;
+          break;
+        }
+      }
+      else
+      {
+        // has been referenced, clear the bit
+        bufStats.accesses++;
+        bufDescTable[clockHand].refbit = false;
+      }
     }
-    else
-    {
-      // has been referenced, clear the bit
-      bufStats.accesses++;
-      bufDescTable[clockHand].refbit = false;
-    }
+    nodeClockHands[node] = clockHand;
   }
   
   // check for full buffer pool
-  if (!found && numScanned >= 2*numBufs)
+  if (!found)
   {
+    if (writing)
+    {
+      writeDoneCond.wait(poolMutex);
+      allocBuf(frame);
+      return;
+    }
     throw BufferExceededException();
   }
   
-  // flush any existing changes to disk if necessary
-  if (bufDescTable[clockHand].dirty)
+  // flush any existing changes to disk if necessary, without the pool lock;
+  // the page stays in the hash table, and can be pinned again, meanwhile
+  const FrameId victim = clockHand;
+  if (bufDescTable[victim].dirty)
   {
     bufStats.diskwrites++;
-    //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-    bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+    std::vector<FrameId> frames(1, victim);
+    writeFrames(frames, true);
+    // the background writer, if any, is falling behind
+    writerCond.notify_one();
+
+    // used again while it was written, look for another victim
+    BufDesc* tmpbuf = &(bufDescTable[victim]);
+    if (!tmpbuf->valid || tmpbuf->pinCnt > 0 || tmpbuf->refbit || tmpbuf->dirty)
+    {
+      allocBuf(frame);
+      return;
+    }
   }
 
+  // remove previous entry from hash table
+  if (bufDescTable[victim].valid)
+    hashTable->remove(bufDescTable[victim].file, bufDescTable[victim].pageNo);
+
 	//Reset all the BufDesc entry for the frame before returning the frame
-  bufDescTable[clockHand].Clear();
+  bufDescTable[victim].Clear();
 
   // return new frame number
-  frame = clockHand;
+  frame = victim;
 } // end allocBuf
 
+void BufMgr::freeFrame(FrameId frame)
+{
+  const std::uint32_t node = std::upper_bound(nodeFirstFrame.begin(), nodeFirstFrame.end(), frame) - nodeFirstFrame.begin() - 1;
+  bufDescTable[frame].Clear();
+  nodeFreeFrames[node]++;
+}
+
+namespace {
+
+/**
+ * Copy of a frame taken for writing outside of the pool lock.
+ */
+struct FrameCopy
+{
+  File* file;
+  PageId pageNo;
+  FrameId frameNo;
+  Lsn pageLsn;
+  Page page;
+};
+
+bool compareFrameCopies(const FrameCopy* a, const FrameCopy* b)
+{
+  if (a->file != b->file)
+    return a->file->filename() < b->file->filename();
+  return a->pageNo < b->pageNo;
+}
+
+}
+
+std::uint32_t BufMgr::writeFrames(std::vector<FrameId> &frames, bool foreground)
+{
+  if (frames.empty())
+    return 0;
+
+  // Copy the frames; users may pin and change them again while the copies are written
+  std::vector<FrameCopy> copies(frames.size());
+  std::vector<FrameCopy*> order(frames.size());
+  Lsn maxLsn = 0;
+  for (std::uint32_t i = 0; i < frames.size(); i++)
+  {
+    BufDesc* tmpbuf = &(bufDescTable[frames[i]]);
+    copies[i].file = tmpbuf->file;
+    copies[i].pageNo = tmpbuf->pageNo;
+    copies[i].frameNo = frames[i];
+    copies[i].pageLsn = tmpbuf->pageLsn;
+    // a pinned page may hold changes that are not logged yet
+    copies[i].page = (tmpbuf->pinCnt > 0 && shadowPool != NULL) ? shadowPool[frames[i]] : bufPool[frames[i]];
+    maxLsn = std::max(maxLsn, tmpbuf->pageLsn);
+    if (tmpbuf->pinCnt == 0)
+      tmpbuf->dirty = false;
+    tmpbuf->writing = true;
+    order[i] = &copies[i];
+  }
+  std::sort(order.begin(), order.end(), compareFrameCopies);
+
+  poolMutex.unlock();
+  try
+  {
+    // WAL rule: the log records of a page reach the disk before the page does
+    if (logMgr != NULL)
+      logMgr->flush(maxLsn);
+    for (std::uint32_t i = 0; i < order.size(); i++)
+    {
+      if (foreground)
+      {
+        std::unique_lock<std::mutex> io = foregroundIo();
+        order[i]->file->writeBufferedPage(order[i]->pageNo, order[i]->page);
+        continue;
+      }
+      // foreground reads and writes go first; they are what users wait for
+      while (ioWaiters > 0)
+        std::this_thread::yield();
+      std::lock_guard<std::mutex> io(ioMutex);
+      order[i]->file->writeBufferedPage(order[i]->pageNo, order[i]->page);
+    }
+  }
+  catch (...)
+  {
+    // the caller holds the lock again, the frames stay dirty
+    poolMutex.lock();
+    for (std::uint32_t i = 0; i < frames.size(); i++)
+    {
+      bufDescTable[frames[i]].writing = false;
+      bufDescTable[frames[i]].dirty = true;
+    }
+    writeDoneCond.notify_all();
+    throw;
+  }
+  poolMutex.lock();
+
+  for (std::uint32_t i = 0; i < frames.size(); i++)
+    bufDescTable[frames[i]].writing = false;
+  writeDoneCond.notify_all();
+  return frames.size();
+}
+
+void BufMgr::writerLoop()
+{
+  std::unique_lock<std::mutex> lock(poolMutex);
+  std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+  std::vector<FrameId> frames;
+  bool more = false;
+  while (!stopWriting)
+  {
+    if (!more)
+      writerCond.wait_for(lock, std::chrono::milliseconds(1));
+    if (stopWriting)
+      break;
+
+    if (checkpointInterval > 0 && logMgr != NULL &&
+        std::chrono::steady_clock::now() - lastCheckpoint >= std::chrono::milliseconds(checkpointInterval))
+    {
+      lock.unlock();
+      checkpoint();
+      lock.lock();
+      lastCheckpoint = std::chrono::steady_clock::now();
+    }
+
+    // Walk ahead of the clock hand of every partition and clean the frames it will reach next, until enough
+    // clean victims wait there
+    frames.clear();
+    for (std::uint32_t n = 0; n < nodeClockHands.size() && frames.size() < WRITER_BATCH; n++)
+    {
+      const FrameId first = nodeFirstFrame[n];
+      const FrameId end = nodeFirstFrame[n + 1];
+      const std::uint32_t target = std::min<std::uint32_t>(cleanTarget, end - first);
+      const std::uint32_t queued = frames.size();
+      std::uint32_t clean = 0;
+      FrameId frame = nodeClockHands[n];
+      for (std::uint32_t i = 0; i < end - first && clean + frames.size() - queued < target && frames.size() < WRITER_BATCH; i++)
+      {
+        frame = (frame >= first && frame + 1 < end) ? frame + 1 : first;
+        BufDesc* tmpbuf = &(bufDescTable[frame]);
+        if (!tmpbuf->valid)
+          clean++;
+        else if (tmpbuf->pinCnt == 0 && !tmpbuf->writing)
+        {
+          if (tmpbuf->dirty)
+            frames.push_back(frame);
+          else
+            clean++;
+        }
+      }
+    }
+    more = frames.size() == WRITER_BATCH;
+    bufStats.backgroundwrites += writeFrames(frames);
+  }
+}
+
+void BufMgr::startWriter(std::uint32_t target, std::uint32_t interval)
+{
+  stopWriter();
+  std::lock_guard<std::mutex> lock(poolMutex);
+  cleanTarget = std::min(target, numBufs);
+  checkpointInterval = interval;
+  stopWriting = false;
+  writerThread = std::thread(&BufMgr::writerLoop, this);
+
+  // Run the writer only when the CPU would otherwise be idle, so it never delays a foreground request
+  sched_param param;
+  param.sched_priority = 0;
+  pthread_setschedparam(writerThread.native_handle(), SCHED_IDLE, &param);
+}
+
+void BufMgr::stopWriter()
+{
+  if (!writerThread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    stopWriting = true;
+  }
+  writerCond.notify_one();
+  writerThread.join();
+}
+
+void BufMgr::checkpoint()
+{
+  if (logMgr == NULL)
+    return;
+
+  // Every change before this LSN is in the buffer pool or on disk once the checkpoint starts
+  const Lsn redoLsn = logMgr->checkpointLsn();
+
+  std::unique_lock<std::mutex> lock(poolMutex);
+  // Copies already in flight may be older than the pages now; let them land first
+  bool writing = true;
+  while (writing)
+  {
+    writing = false;
+    for (std::uint32_t i = 0; i < numBufs; i++)
+      writing = writing || bufDescTable[i].writing;
+    if (writing)
+      writeDoneCond.wait(lock);
+  }
+
+  std::vector<FrameId> frames;
+  for (std::uint32_t i = 0; i < numBufs; i++)
+  {
+    if (bufDescTable[i].valid && bufDescTable[i].dirty)
+      frames.push_back(i);
+  }
+  bufStats.backgroundwrites += writeFrames(frames);
+  lock.unlock();
+
+  {
+    std::lock_guard<std::mutex> io(ioMutex);
+    File::syncAll();
+  }
+  logMgr->logCheckpoint(redoLsn);
+}
+
+std::unique_lock<std::mutex> BufMgr::foregroundIo()
+{
+  ioWaiters++;
+  std::unique_lock<std::mutex> io(ioMutex);
+  ioWaiters--;
+  return io;
+}
+
+void BufMgr::takeShadow(FrameId frame)
+{
+  if (shadowPool != NULL)
+    shadowPool[frame] = bufPool[frame];
+}
+
+void BufMgr::logChanges(FrameId frame)
+{
+  BufDesc* tmpbuf = &(bufDescTable[frame]);
+
+  // Only PageFile pages keep a PageHeader on disk; index pages use the whole page
+  const bool hasPageLsn = dynamic_cast<PageFile*>(tmpbuf->file) != NULL;
+  const Lsn lsn = logMgr->logPageUpdate(tmpbuf->file, tmpbuf->pageNo, hasPageLsn, shadowPool[frame], bufPool[frame]);
+  if (lsn == 0)
+    return;
+
+  tmpbuf->pageLsn = lsn;
+  if (hasPageLsn)
+  {
+    bufPool[frame].set_page_lsn(lsn);
+    shadowPool[frame].set_page_lsn(lsn);
+  }
+}
+
 	
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
+  std::lock_guard<std::mutex> lock(poolMutex);
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
   FrameId frameNo = 0;
 	try
 	{
   	hashTable->lookup(file, pageNo, frameNo);
-
-    // set the referenced bit
-    bufDescTable[frameNo].refbit = true;
-    bufDescTable[frameNo].pinCnt++;
-    page = &bufPool[frameNo];
   }
   catch(const HashNotFoundException &e) //not in the buffer pool, must allocate a new page
   {
     // alloc a new frame
-    allocBuf(frameNo);
+    FrameId newFrame = 0;
+    allocBuf(newFrame);
 
-    // read the page into the new frame
-    bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+    try
+    {
+      // allocBuf may release the lock to wait for or write a victim, and another
+      // thread may have read the page in meanwhile; the new frame goes back then
+      hashTable->lookup(file, pageNo, frameNo);
+      freeFrame(newFrame);
+    }
+    catch(const HashNotFoundException &e)
+    {
+      // read the page into the new frame
+      bufStats.diskreads++;
+      //status = file->readPage(pageNo, &bufPool[newFrame]);
+      try
+      {
+        std::unique_lock<std::mutex> io = foregroundIo();
+        bufPool[newFrame] = file->readPage(pageNo);
+      }
+      catch(...)
+      {
+        freeFrame(newFrame);
+        throw;
+      }
 
-    // set up the entry properly
-    bufDescTable[frameNo].Set(file, pageNo);
-    page = &bufPool[frameNo];
+      // set up the entry properly
+      bufDescTable[newFrame].Set(file, pageNo);
+      page = &bufPool[newFrame];
+      takeShadow(newFrame);
 
-    // insert in the hash table
-    hashTable->insert(file, pageNo, frameNo);
+      // insert in the hash table
+      hashTable->insert(file, pageNo, newFrame);
+      return;
+    }
   }
+
+  // set the referenced bit
+  bufDescTable[frameNo].refbit = true;
+  if (bufDescTable[frameNo].pinCnt == 0)
+    takeShadow(frameNo);
+  bufDescTable[frameNo].pinCnt++;
+  page = &bufPool[frameNo];
 }
 
 
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
+  std::lock_guard<std::mutex> lock(poolMutex);
   // lookup in hashtable
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
@@ -166,10 +551,14 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
   	throw PageNotPinnedException(file->filename(), pageNo, frameNo);
   }
   else bufDescTable[frameNo].pinCnt--;
+
+  if (dirty == true && logMgr != NULL)
+    logChanges(frameNo);
 }
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
+  std::lock_guard<std::mutex> lock(poolMutex);
   FrameId frameNo;
 
   // alloc a new frame
@@ -177,11 +566,15 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 
   // allocate a new page in the file
 	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
-  bufPool[frameNo] = file->allocatePage(pageNo);
+  {
+    std::unique_lock<std::mutex> io = foregroundIo();
+    bufPool[frameNo] = file->allocatePage(pageNo);
+  }
   page = &bufPool[frameNo];
 
   // set up the entry properly
   bufDescTable[frameNo].Set(file, pageNo);
+  takeShadow(frameNo);
 
   // insert in the hash table
   hashTable->insert(file, pageNo, frameNo);
@@ -189,23 +582,40 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 
 void BufMgr::flushFile(const File* file) 
 {
+  std::unique_lock<std::mutex> lock(poolMutex);
+  // write the file's dirty pages without the pool lock, until none is left
+  // and no copy of one is still being written
+  while (true)
+  {
+    std::vector<FrameId> frames;
+    bool writing = false;
+    for (std::uint32_t i = 0; i < numBufs; i++)
+    {
+      BufDesc* tmpbuf = &(bufDescTable[i]);
+      if (!tmpbuf->valid || tmpbuf->file != file)
+        continue;
+      if (tmpbuf->pinCnt > 0)
+        throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
+      if (tmpbuf->writing)
+        writing = true;
+      else if (tmpbuf->dirty)
+        frames.push_back(i);
+    }
+    if (!frames.empty())
+      writeFrames(frames, true);
+    else if (writing)
+      writeDoneCond.wait(lock);
+    else
+      break;
+  }
+
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
   	if(tmpbuf->file && tmpbuf->valid == true && tmpbuf->file == file)
 		{
-	    if (tmpbuf->pinCnt > 0)
-  			throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
-
-	    if (tmpbuf->dirty == true)
-			{
-				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
-				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-				tmpbuf->dirty = false;
-    	}
-
     	hashTable->remove(file,tmpbuf->pageNo);
-    	tmpbuf->Clear();
+    	freeFrame(i);
   	}
 		else if (tmpbuf->valid == false && tmpbuf->file == file)
   		throw BadBufferException(tmpbuf->frameNo, tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit);
@@ -214,20 +624,36 @@ void BufMgr::flushFile(const File* file)
 
 void BufMgr::disposePage(File* file, const PageId pageNo)
 {
+  std::lock_guard<std::mutex> lock(poolMutex);
 	//Deallocate from file altogether
   //See if it is in the buffer pool
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
+  while (bufDescTable[frameNo].writing)
+    writeDoneCond.wait(poolMutex);
 
 	// clear the page
-	bufDescTable[frameNo].Clear();
+	freeFrame(frameNo);
 
 	hashTable->remove(file, pageNo);
 
   // deallocate it in the file	
+  std::unique_lock<std::mutex> io = foregroundIo();
   file->deletePage(pageNo);
 }
 
+void BufMgr::beginAction()
+{
+  if (logMgr != NULL)
+    logMgr->beginAction();
+}
+
+void BufMgr::commitAction()
+{
+  if (logMgr != NULL)
+    logMgr->commitAction();
+}
+
 void BufMgr::printSelf(void) 
 {
   BufDesc* tmpbuf;
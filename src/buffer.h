@@ -9,7 +9,13 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "pool_memory.h"
 #include <iostream>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace badgerdb {
 
@@ -17,6 +23,7 @@ namespace badgerdb {
 * forward declaration of BufMgr class 
 */
 class BufMgr;
+class LogManager;
 
 /**
 * @brief Class for maintaining information about buffer pool frames
@@ -61,6 +68,16 @@ class BufDesc {
 	 */
   bool refbit;
 
+	/**
+   * LSN of the last logged change to the page in this frame
+	 */
+  Lsn pageLsn;
+
+	/**
+   * True while a copy of the page is being written by the background writer or a checkpoint
+	 */
+  bool writing;
+
 	/**
    * Initialize buffer frame for a new user
 	 */
@@ -72,6 +89,8 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+		pageLsn = 0;
+		writing = false;
   };
 
 	/**
@@ -89,6 +108,8 @@ class BufDesc {
     dirty = false;
     valid = true;
     refbit = true;
+    pageLsn = 0;
+    writing = false;
   }
 
   void Print()
@@ -133,16 +154,21 @@ struct BufStats
   int diskreads;
 
 	/**
-   * Number of pages written back to disk
+   * Number of pages written back to disk by the thread that needed their frame
 	 */
   int diskwrites;
 
+	/**
+   * Number of pages written back to disk by the background writer
+	 */
+  int backgroundwrites;
+
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = diskreads = diskwrites = backgroundwrites = 0;
   }
       
 	/**
@@ -162,10 +188,32 @@ class BufMgr
 {
  private:
 	/**
-   * Current position of clockhand in our buffer pool
+   * Frame the clock hand of the partition allocBuf last scanned points to
 	 */
   FrameId clockHand;
 
+	/**
+   * First frame of the partition of every NUMA node, followed by numBufs. A single partition unless the
+   * pool was created NUMA-aware.
+	 */
+  std::vector<FrameId> nodeFirstFrame;
+
+	/**
+   * Position of the clock hand within the partition of every NUMA node
+	 */
+  std::vector<FrameId> nodeClockHands;
+
+	/**
+   * Number of frames holding no page in the partition of every NUMA node
+	 */
+  std::vector<std::uint32_t> nodeFreeFrames;
+
+	/**
+   * Mappings holding bufPool and bufDescTable
+	 */
+  PoolMemory *poolMemory;
+  PoolMemory *descMemory;
+
 	/**
    * Number of frames in the buffer pool
 	 */
@@ -187,11 +235,66 @@ class BufMgr
   BufStats bufStats;
 
 	/**
-   * Advance clock to next frame in the buffer pool
+   * Write-ahead log, NULL if changes are not logged
+	 */
+  LogManager *logMgr;
+
+	/**
+   * Copy of every frame as of its last logged change, NULL if changes are not logged
+	 */
+  Page *shadowPool;
+
+	/**
+   * Protects the frame descriptors, the hash table and the clock hand
+	 */
+  std::mutex poolMutex;
+
+	/**
+   * Serializes all reads and writes of files made through this buffer manager
+	 */
+  std::mutex ioMutex;
+
+	/**
+   * Number of foreground reads and writes waiting for ioMutex; the background writer lets them go first
+	 */
+  std::atomic<int> ioWaiters;
+
+	/**
+   * Signalled when frames being written become available again
+	 */
+  std::condition_variable_any writeDoneCond;
+
+	/**
+   * Wakes the background writer early, e.g. when a victim had to be written in the foreground
+	 */
+  std::condition_variable_any writerCond;
+
+	/**
+   * The background writer, not joinable if none is running
+	 */
+  std::thread writerThread;
+
+	/**
+   * Set to make the background writer exit
+	 */
+  bool stopWriting;
+
+	/**
+   * Number of clean, unpinned frames the background writer keeps ahead of the clock hand of every partition
+	 */
+  std::uint32_t cleanTarget;
+
+	/**
+   * Milliseconds between checkpoints taken by the background writer, zero for none
+	 */
+  std::uint32_t checkpointInterval;
+
+	/**
+   * Advance clock to next frame in the partition of the buffer pool from first up to end
 	 */
-  void advanceClock()
+  void advanceClock(FrameId first, FrameId end)
   {
-		clockHand = (clockHand + 1) % numBufs;
+		clockHand = (clockHand >= first && clockHand + 1 < end) ? clockHand + 1 : first;
   }
 
 	/**
@@ -202,6 +305,47 @@ class BufMgr
 	 */
   void allocBuf(FrameId & frame);
 
+	/**
+	 * Clears a frame that holds a page, making it free.
+	 *
+	 * @param frame   	Frame ID of the frame
+	 */
+  void freeFrame(FrameId frame);
+
+	/**
+	 * Copies the given dirty frames, writes the copies sorted by (file, page) and releases the frames again.
+	 * Called with poolMutex held; the mutex is released while the log is forced and the copies are written.
+	 *
+	 * @param frames   	Frames to write; pinned frames are written as of their last logged change
+	 * @param foreground  True if a user waits for the writes, which then go ahead of the background writer's
+	 * @return  Number of pages written
+	 */
+  std::uint32_t writeFrames(std::vector<FrameId> &frames, bool foreground = false);
+
+	/**
+	 * Body of the background writer.
+	 */
+  void writerLoop();
+
+	/**
+	 * Locks ioMutex for a read or write made on behalf of a user of the buffer pool.
+	 */
+  std::unique_lock<std::mutex> foregroundIo();
+
+	/**
+	 * Takes the shadow copy of a frame that changes are logged against. Called when the frame gets pinned.
+	 *
+	 * @param frame   	Frame ID of the frame
+	 */
+  void takeShadow(FrameId frame);
+
+	/**
+	 * Logs the changes made to a frame since its shadow copy was taken.
+	 *
+	 * @param frame   	Frame ID of the frame
+	 */
+  void logChanges(FrameId frame);
+
  public:
 	/**
    * Actual buffer pool from which frames are allocated
@@ -210,8 +354,14 @@ class BufMgr
 
 	/**
    * Constructor of BufMgr class
+	 *
+	 * @param bufs    	Number of frames in the buffer pool
+	 * @param log     	Write-ahead log for the changes made through this buffer manager, NULL for none.
+	 *                	The log is attached to all files as well, see File::setLogManager.
+	 * @param options 	Memory backing the frames: huge pages, and partitions placed on the NUMA nodes.
+	 *                	A thread needing a frame takes a victim from the partition of its own node if it can.
 	 */
-  BufMgr(std::uint32_t bufs);
+  BufMgr(std::uint32_t bufs, LogManager *log = NULL, const PoolOptions &options = PoolOptions());
 	
 	/**
    * Destructor of BufMgr class
@@ -270,10 +420,68 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Starts a background writer that writes dirty, unpinned frames in the order the clock hand will reach
+	 * them, so that allocBuf finds clean victims instead of writing one itself. Each batch is written sorted
+	 * by (file, page). With a log attached the writer also takes a checkpoint periodically.
+	 * While the writer runs, files must only be accessed through this buffer manager, and not be opened or closed.
+	 *
+	 * @param target   	Number of clean, unpinned frames to keep ahead of the clock hand of every partition
+	 * @param interval  Milliseconds between checkpoints, zero for none
+	 */
+  void startWriter(std::uint32_t target, std::uint32_t interval = 0);
+
+	/**
+	 * Stops the background writer, if one is running.
+	 */
+  void stopWriter();
+
+	/**
+	 * Takes a fuzzy checkpoint: writes every dirty frame without blocking the users of the buffer pool,
+	 * syncs the files and logs the LSN that redo has to start from after a crash. Pinned frames are
+	 * written as of their last logged change. Does nothing if no log is attached.
+	 */
+  void checkpoint();
+
+	/**
+	 * Starts an atomic action. All changes logged until the matching commitAction are undone together
+	 * if the process crashes before the commit. Does nothing if no log is attached.
+	 */
+  void beginAction();
+
+	/**
+	 * Commits the current atomic action. Does nothing if no log is attached.
+	 */
+  void commitAction();
+
+	/**
+   * Returns the write-ahead log, NULL if none is attached.
+	 */
+  LogManager* getLogManager()
+  {
+		return logMgr;
+  }
+
+	/**
    * Print member variable values. 
 	 */
   void  printSelf();
 
+	/**
+   * Returns the kind of pages backing the frames
+	 */
+  PoolBacking getPoolBacking() const
+  {
+		return poolMemory->backing();
+  }
+
+	/**
+   * Returns the number of partitions the frames are split into, one per NUMA node
+	 */
+  std::uint32_t getNumPartitions() const
+  {
+		return nodeClockHands.size();
+  }
+
 	/**
    * Get buffer pool usage statistics
 	 */
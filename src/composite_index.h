@@ -0,0 +1,806 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Key made of several fixed-width attributes, compared lexicographically.
+ * The attribute types are template parameters, so the comparison for a key layout is generated by the
+ * compiler: each attribute is compared with its own operator< and the recursion is inlined.
+ * For instance CompositeKey<int, double> orders by an int first and by a double among equal ints.
+*/
+template <typename Head, typename... Tail>
+struct CompositeKey{
+  /**
+   * Number of attributes of the key.
+   */
+	static const int ATTRIBUTES = 1 + sizeof...(Tail);
+
+  /**
+   * First attribute.
+   */
+	Head head;
+
+  /**
+   * Remaining attributes.
+   */
+	CompositeKey<Tail...> tail;
+
+  /**
+   * Sets the attributes, in order.
+   */
+	void assign(const Head &h, const Tail&... t)
+	{
+		head = h;
+		tail.assign(t...);
+	}
+
+  /**
+   * Copies the attributes out of a record.
+   * @param record		The record
+   * @param offsets		Byte offset of every attribute in the record, in order
+   */
+	void extract(const char *record, const int *offsets)
+	{
+		memcpy(&head, record + offsets[0], sizeof(Head));
+		tail.extract(record, offsets + 1);
+	}
+
+  /**
+   * Compares the first attributes of two keys.
+   * @param attributes	Number of attributes to compare, from the first one
+   * @return	Negative, zero or positive as a sorts before, together with or after b
+   */
+	static int compare(const CompositeKey &a, const CompositeKey &b, const int attributes)
+	{
+		if(a.head < b.head) return -1;
+		if(b.head < a.head) return 1;
+		return attributes > 1 ? CompositeKey<Tail...>::compare(a.tail, b.tail, attributes - 1) : 0;
+	}
+};
+
+/**
+ * @brief Last attribute of a CompositeKey.
+*/
+template <typename Head>
+struct CompositeKey<Head>{
+	static const int ATTRIBUTES = 1;
+
+	Head head;
+
+	void assign(const Head &h)
+	{
+		head = h;
+	}
+
+	void extract(const char *record, const int *offsets)
+	{
+		memcpy(&head, record + offsets[0], sizeof(Head));
+	}
+
+	static int compare(const CompositeKey &a, const CompositeKey &b, const int attributes)
+	{
+		if(a.head < b.head) return -1;
+		if(b.head < a.head) return 1;
+		return 0;
+	}
+};
+
+/**
+ * @brief Builds a CompositeKey from its attribute values.
+*/
+template <typename Head, typename... Tail>
+CompositeKey<Head, Tail...> makeCompositeKey(const Head &h, const Tail&... t)
+{
+	CompositeKey<Head, Tail...> key;
+	key.assign(h, t...);
+	return key;
+}
+
+/**
+ * @brief Most attributes a composite key may have.
+*/
+const int MAXCOMPOSITEATTRS = 8;
+
+/**
+ * @brief The first page of a composite index file holds this structure.
+*/
+struct CompositeIndexMeta{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Number of attributes of the key.
+   */
+	int attributes;
+
+  /**
+   * Offsets of the attributes inside the records.
+   */
+	int attrByteOffsets[MAXCOMPOSITEATTRS];
+
+  /**
+   * Size of a key in bytes, to detect a different key layout.
+   */
+	int keySize;
+
+  /**
+   * Page number of the root.
+   */
+	PageId rootPageNo;
+};
+
+/**
+ * @brief Leaf node of a composite index. Unlike LeafNodeInt it counts its entries, since a key has no
+ * value left over to mark an empty slot.
+*/
+template <class Key>
+struct CompositeLeafNode{
+	/**
+	 * Number of entries that fit a page, leaving 16 bytes for the count, the sibling and alignment padding.
+	 */
+	static const int CAPACITY = (Page::SIZE - 16) / (sizeof(Key) + sizeof(RecordId));
+
+  /**
+   * Number of entries.
+   */
+	int count;
+
+  /**
+   * Stores keys.
+   */
+	Key keyArray[CAPACITY];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[CAPACITY];
+
+  /**
+   * Page number of the leaf on the right side, 0 for the last leaf.
+   */
+	PageId rightSibPageNo;
+};
+
+/**
+ * @brief Non-leaf node of a composite index. keyArray[i] is the first key of child i + 1; the keys in
+ * child i are greater than or equal to keyArray[i - 1] and less than or equal to keyArray[i], so equal
+ * keys may straddle two children.
+*/
+template <class Key>
+struct CompositeNonLeafNode{
+	/**
+	 * Number of keys that fit a page, leaving 16 bytes for the level, the count, the last child and padding.
+	 */
+	static const int CAPACITY = (Page::SIZE - 16) / (sizeof(Key) + sizeof(PageId));
+
+  /**
+   * 1 if the children are leaves, 0 otherwise.
+   */
+	int level;
+
+  /**
+   * Number of keys, one less than the number of children.
+   */
+	int count;
+
+  /**
+   * Stores keys.
+   */
+	Key keyArray[CAPACITY];
+
+  /**
+   * Page numbers of the children.
+   */
+	PageId pageNoArray[CAPACITY + 1];
+};
+
+/**
+ * @brief B+ tree index on several attributes of a relation, with keys of type Key, a CompositeKey.
+ * A scan may restrict the leading attributes only (a prefix range scan), for instance every key whose
+ * first attribute lies in a range whatever the others are. This index supports only one scan at a time.
+*/
+template <class Key>
+class CompositeIndex {
+
+ private:
+	typedef CompositeLeafNode<Key> Leaf;
+	typedef CompositeNonLeafNode<Key> NonLeaf;
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * page number of root page of B+ tree inside index file.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * Offsets of the key attributes inside records.
+   */
+	std::vector<int>	attrByteOffsets;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Index of next entry to be scanned in current leaf being scanned, -1 once the scan is past the last leaf.
+   */
+	int			nextEntry;
+
+  /**
+   * Page number of current page being scanned.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Current Page being scanned.
+   */
+	Page		*currentPageData;
+
+  /**
+   * Bounds of the scan and the number of leading attributes they apply to.
+   */
+	Key			lowVal;
+	Key			highVal;
+	Operator	lowOp;
+	Operator	highOp;
+	int			scanAttributes;
+
+ public:
+
+  /**
+   * Opens the index file of the relation on the given attributes if it exists. Otherwise creates it
+   * and fills it from a FileScan of the relation: the entries are sorted and the tree written bottom-up.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param offsets							Offset of every key attribute in the records, in key order
+   * @throws  BadIndexInfoException     If the number of offsets does not match the key, or an existing index
+   *                                    file was built for other attributes.
+   */
+	CompositeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn, const std::vector<int> &offsets);
+
+  /**
+   * Ends any scan, flushes the index file and closes it.
+   */
+	~CompositeIndex();
+
+  /**
+   * Inserts a new entry, splitting nodes on the way back up as needed.
+   * @param key			Key to insert
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+   */
+	void insertEntry(const Key &key, const RecordId rid);
+
+  /**
+   * Begins a scan of the entries whose key lies in the range. Only the first prefixAttributes attributes
+   * of the keys are compared, so a prefix of the key can be restricted while the rest is left open.
+   * @param lowVal	Low value of range
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range
+   * @param highOp	High operator (LT/LTE)
+   * @param prefixAttributes	Number of leading attributes the range applies to
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+   * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+   */
+	void startScan(const Key &lowVal, const Operator lowOp, const Key &highVal, const Operator highOp,
+						const int prefixAttributes = Key::ATTRIBUTES);
+
+  /**
+   * Fetch the record id and the key of the next entry that matches the scan.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outKey	Key of that entry
+   * @throws ScanNotInitializedException If no scan has been initialized.
+   * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+   */
+	void scanNext(RecordId& outRid, Key &outKey);
+
+  /**
+   * Same as above, without the key.
+   */
+	void scanNext(RecordId& outRid)
+	{
+		Key key;
+		scanNext(outRid, key);
+	}
+
+  /**
+   * Terminate the current scan. Unpin any pinned pages.
+   * @throws ScanNotInitializedException If no scan has been initialized.
+   */
+	void endScan();
+
+ private:
+  /**
+   * Writes the tree bottom-up from the sorted entries and returns its root.
+   */
+	PageId bulkLoad(const std::vector<std::pair<Key, RecordId> > &entries);
+
+  /**
+   * Inserts into the subtree rooted at a non-leaf node.
+   * @return true if the node split, in which case propKey and propPageNo describe its new right sibling
+   */
+	bool insertHelper(const PageId nodeNum, const Key &key, const RecordId rid, Key &propKey, PageId &propPageNo);
+
+  /**
+   * Stores the root page number in the meta page.
+   */
+	void writeRoot();
+
+  /**
+   * Moves the scan to the right sibling of the current leaf, skipping empty leaves.
+   * @return false if the current leaf was the last one
+   */
+	bool nextLeaf();
+
+	bool aboveLow(const Key &key) const
+	{
+		int c = Key::compare(key, lowVal, scanAttributes);
+		return lowOp == GT ? c > 0 : c >= 0;
+	}
+
+	bool belowHigh(const Key &key) const
+	{
+		int c = Key::compare(key, highVal, scanAttributes);
+		return highOp == LT ? c < 0 : c <= 0;
+	}
+
+  /**
+   * Orders entries by key and then by record id.
+   */
+	static bool compareEntries(const std::pair<Key, RecordId> &a, const std::pair<Key, RecordId> &b)
+	{
+		int c = Key::compare(a.first, b.first, Key::ATTRIBUTES);
+		if(c != 0) return c < 0;
+		if(a.second.page_number != b.second.page_number) return a.second.page_number < b.second.page_number;
+		return a.second.slot_number < b.second.slot_number;
+	}
+};
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::CompositeIndex -- Constructor
+// -----------------------------------------------------------------------------
+
+template <class Key>
+CompositeIndex<Key>::CompositeIndex(const std::string & relationName, std::string & outIndexName,
+		BufMgr *bufMgrIn, const std::vector<int> &offsets)
+{
+  static_assert(sizeof(Leaf) <= Page::SIZE, "Composite leaf must fit a page.");
+  static_assert(sizeof(NonLeaf) <= Page::SIZE, "Composite node must fit a page.");
+  static_assert(Key::ATTRIBUTES <= MAXCOMPOSITEATTRS, "Too many key attributes.");
+
+  bufMgr = bufMgrIn;
+  attrByteOffsets = offsets;
+  scanExecuting = false;
+  nextEntry = -1;
+  currentPageNum = 0;
+  currentPageData = NULL;
+  if((int)offsets.size() != Key::ATTRIBUTES){
+    throw BadIndexInfoException("Number of offsets does not match the composite key.");
+  }
+
+  //Index file name lists the attribute offsets in key order
+  std::ostringstream idxStr;
+  idxStr << relationName;
+  for(size_t i = 0; i < offsets.size(); i++){
+    idxStr << '.' << offsets[i];
+  }
+  outIndexName = idxStr.str();
+
+  //Existing index: check that the meta page describes the same key
+  if(File::exists(outIndexName)){
+    file = new BlobFile(outIndexName, false);
+    headerPageNum = 1;
+    Page *page;
+    bufMgr->readPage(file, headerPageNum, page);
+    CompositeIndexMeta *meta = (struct CompositeIndexMeta*)page;
+    bool same = meta->attributes == Key::ATTRIBUTES && meta->keySize == (int)sizeof(Key) &&
+                std::equal(offsets.begin(), offsets.end(), meta->attrByteOffsets);
+    rootPageNum = meta->rootPageNo;
+    bufMgr->unPinPage(file, headerPageNum, false);
+    if(!same){
+      bufMgr->flushFile(file);
+      delete file;
+      throw BadIndexInfoException("Index file " + outIndexName + " has a different key.");
+    }
+    return;
+  }
+
+  file = new BlobFile(outIndexName, true);
+  Page *page;
+  bufMgr->allocPage(file, headerPageNum, page);
+  CompositeIndexMeta *meta = (struct CompositeIndexMeta*)page;
+  memset(meta, 0, sizeof(CompositeIndexMeta));
+  strncpy(meta->relationName, relationName.c_str(), sizeof(meta->relationName) - 1);
+  meta->attributes = Key::ATTRIBUTES;
+  std::copy(offsets.begin(), offsets.end(), meta->attrByteOffsets);
+  meta->keySize = sizeof(Key);
+  bufMgr->unPinPage(file, headerPageNum, true);
+
+  //Collect the entries of the relation, sort them, and write the tree
+  std::vector<std::pair<Key, RecordId> > entries;
+  {
+    FileScan fileScan(relationName, bufMgr);
+    std::string scratch;
+    try{
+      RecordId rid;
+      while(true){
+        fileScan.scanNext(rid);
+        const char *record = fileScan.getRecordView(scratch).data;
+        Key key;
+        key.extract(record, &attrByteOffsets[0]);
+        entries.push_back(std::make_pair(key, rid));
+      }
+    }catch(EndOfFileException&){
+    }
+  }
+  std::sort(entries.begin(), entries.end(), compareEntries);
+  rootPageNum = bulkLoad(entries);
+  writeRoot();
+}
+
+template <class Key>
+CompositeIndex<Key>::~CompositeIndex()
+{
+  if(scanExecuting){
+    endScan();
+  }
+  bufMgr->flushFile(file);
+  delete file;
+}
+
+template <class Key>
+void CompositeIndex<Key>::writeRoot()
+{
+  Page *page;
+  bufMgr->readPage(file, headerPageNum, page);
+  ((struct CompositeIndexMeta*)page)->rootPageNo = rootPageNum;
+  bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::bulkLoad
+// -----------------------------------------------------------------------------
+
+template <class Key>
+PageId CompositeIndex<Key>::bulkLoad(const std::vector<std::pair<Key, RecordId> > &entries)
+{
+  //First key and page number of every node of the level being built
+  std::vector<std::pair<Key, PageId> > level;
+
+  //Full leaves linked left to right; an empty relation still gets one leaf
+  PageId prevLeafNum = 0;
+  size_t first = 0;
+  do{
+    size_t count = std::min(entries.size() - first, (size_t)Leaf::CAPACITY);
+    PageId leafNum; Page *leafPage;
+    bufMgr->allocPage(file, leafNum, leafPage);
+    Leaf *leaf = (Leaf*)leafPage;
+    leaf->count = count;
+    for(size_t i = 0; i < count; i++){
+      leaf->keyArray[i] = entries[first + i].first;
+      leaf->ridArray[i] = entries[first + i].second;
+    }
+    leaf->rightSibPageNo = 0;
+    bufMgr->unPinPage(file, leafNum, true);
+    level.push_back(std::make_pair(count > 0 ? entries[first].first : Key(), leafNum));
+
+    if(prevLeafNum != 0){
+      Page *prevPage;
+      bufMgr->readPage(file, prevLeafNum, prevPage);
+      ((Leaf*)prevPage)->rightSibPageNo = leafNum;
+      bufMgr->unPinPage(file, prevLeafNum, true);
+    }
+    prevLeafNum = leafNum;
+    first += count;
+  }while(first < entries.size());
+
+  //Non-leaf levels until one root is left; the root is never a leaf
+  int nodeLevel = 1;
+  do{
+    std::vector<std::pair<Key, PageId> > upper;
+    for(size_t first = 0; first < level.size(); first += NonLeaf::CAPACITY + 1){
+      size_t children = std::min(level.size() - first, (size_t)NonLeaf::CAPACITY + 1);
+      PageId nodeNum; Page *nodePage;
+      bufMgr->allocPage(file, nodeNum, nodePage);
+      NonLeaf *node = (NonLeaf*)nodePage;
+      node->level = nodeLevel;
+      node->count = children - 1;
+      node->pageNoArray[0] = level[first].second;
+      for(size_t i = 1; i < children; i++){
+        node->keyArray[i - 1] = level[first + i].first;
+        node->pageNoArray[i] = level[first + i].second;
+      }
+      bufMgr->unPinPage(file, nodeNum, true);
+      upper.push_back(std::make_pair(level[first].first, nodeNum));
+    }
+    level.swap(upper);
+    nodeLevel = 0;
+  }while(level.size() > 1);
+  return level[0].second;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::insertEntry
+// -----------------------------------------------------------------------------
+
+template <class Key>
+void CompositeIndex<Key>::insertEntry(const Key &key, const RecordId rid)
+{
+  bufMgr->beginAction();
+  Key propKey; PageId propPageNo;
+  if(insertHelper(rootPageNum, key, rid, propKey, propPageNo)){
+    //Root split, grow the tree by one level
+    PageId rootNo; Page *rootPage;
+    bufMgr->allocPage(file, rootNo, rootPage);
+    NonLeaf *root = (NonLeaf*)rootPage;
+    root->level = 0;
+    root->count = 1;
+    root->keyArray[0] = propKey;
+    root->pageNoArray[0] = rootPageNum;
+    root->pageNoArray[1] = propPageNo;
+    bufMgr->unPinPage(file, rootNo, true);
+    rootPageNum = rootNo;
+    writeRoot();
+  }
+  bufMgr->commitAction();
+}
+
+template <class Key>
+bool CompositeIndex<Key>::insertHelper(const PageId nodeNum, const Key &key, const RecordId rid,
+		Key &propKey, PageId &propPageNo)
+{
+  Page *page;
+  bufMgr->readPage(file, nodeNum, page);
+  NonLeaf *node = (NonLeaf*)page;
+
+  //Equal keys go after the ones already there
+  int child = 0;
+  while(child < node->count && Key::compare(node->keyArray[child], key, Key::ATTRIBUTES) <= 0) child++;
+  PageId childNum = node->pageNoArray[child];
+
+  Key newKey; PageId newPageNo;
+  bool split;
+  if(node->level == 1){
+    Page *leafPage;
+    bufMgr->readPage(file, childNum, leafPage);
+    Leaf *leaf = (Leaf*)leafPage;
+    int pos = 0;
+    while(pos < leaf->count && Key::compare(leaf->keyArray[pos], key, Key::ATTRIBUTES) <= 0) pos++;
+    split = leaf->count == Leaf::CAPACITY;
+    if(split){
+      //Move the upper half to a new right sibling, then insert into the half the key belongs to
+      PageId sibNum; Page *sibPage;
+      bufMgr->allocPage(file, sibNum, sibPage);
+      Leaf *sib = (Leaf*)sibPage;
+      int mid = Leaf::CAPACITY / 2;
+      sib->count = leaf->count - mid;
+      std::copy(leaf->keyArray + mid, leaf->keyArray + leaf->count, sib->keyArray);
+      std::copy(leaf->ridArray + mid, leaf->ridArray + leaf->count, sib->ridArray);
+      sib->rightSibPageNo = leaf->rightSibPageNo;
+      leaf->rightSibPageNo = sibNum;
+      leaf->count = mid;
+      Leaf *target = leaf;
+      if(pos > mid){
+        target = sib;
+        pos -= mid;
+      }
+      std::copy_backward(target->keyArray + pos, target->keyArray + target->count, target->keyArray + target->count + 1);
+      std::copy_backward(target->ridArray + pos, target->ridArray + target->count, target->ridArray + target->count + 1);
+      target->keyArray[pos] = key;
+      target->ridArray[pos] = rid;
+      target->count++;
+      newKey = sib->keyArray[0];
+      newPageNo = sibNum;
+      bufMgr->unPinPage(file, sibNum, true);
+    }else{
+      std::copy_backward(leaf->keyArray + pos, leaf->keyArray + leaf->count, leaf->keyArray + leaf->count + 1);
+      std::copy_backward(leaf->ridArray + pos, leaf->ridArray + leaf->count, leaf->ridArray + leaf->count + 1);
+      leaf->keyArray[pos] = key;
+      leaf->ridArray[pos] = rid;
+      leaf->count++;
+    }
+    bufMgr->unPinPage(file, childNum, true);
+  }else{
+    split = insertHelper(childNum, key, rid, newKey, newPageNo);
+  }
+  if(!split){
+    bufMgr->unPinPage(file, nodeNum, false);
+    return false;
+  }
+
+  //Child split: add its new sibling after it, splitting this node if it is full
+  if(node->count < NonLeaf::CAPACITY){
+    std::copy_backward(node->keyArray + child, node->keyArray + node->count, node->keyArray + node->count + 1);
+    std::copy_backward(node->pageNoArray + child + 1, node->pageNoArray + node->count + 1, node->pageNoArray + node->count + 2);
+    node->keyArray[child] = newKey;
+    node->pageNoArray[child + 1] = newPageNo;
+    node->count++;
+    bufMgr->unPinPage(file, nodeNum, true);
+    return false;
+  }
+
+  //Full node: lay out all keys and children, keep the lower half, move the upper half, push the middle key up
+  std::vector<Key> keys(node->keyArray, node->keyArray + node->count);
+  std::vector<PageId> children(node->pageNoArray, node->pageNoArray + node->count + 1);
+  keys.insert(keys.begin() + child, newKey);
+  children.insert(children.begin() + child + 1, newPageNo);
+  int mid = keys.size() / 2;
+
+  PageId sibNum; Page *sibPage;
+  bufMgr->allocPage(file, sibNum, sibPage);
+  NonLeaf *sib = (NonLeaf*)sibPage;
+  sib->level = node->level;
+  sib->count = keys.size() - mid - 1;
+  std::copy(keys.begin() + mid + 1, keys.end(), sib->keyArray);
+  std::copy(children.begin() + mid + 1, children.end(), sib->pageNoArray);
+  node->count = mid;
+  std::copy(keys.begin(), keys.begin() + mid, node->keyArray);
+  std::copy(children.begin(), children.begin() + mid + 1, node->pageNoArray);
+  propKey = keys[mid];
+  propPageNo = sibNum;
+  bufMgr->unPinPage(file, sibNum, true);
+  bufMgr->unPinPage(file, nodeNum, true);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::startScan
+// -----------------------------------------------------------------------------
+
+template <class Key>
+void CompositeIndex<Key>::startScan(const Key &lowValParm, const Operator lowOpParm,
+		const Key &highValParm, const Operator highOpParm, const int prefixAttributes)
+{
+  if(scanExecuting) endScan();
+  if((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)){
+    throw BadOpcodesException();
+  }
+  scanAttributes = std::max(1, std::min(prefixAttributes, (int)Key::ATTRIBUTES));
+  if(Key::compare(lowValParm, highValParm, scanAttributes) > 0){
+    throw BadScanrangeException();
+  }
+  lowVal = lowValParm;
+  highVal = highValParm;
+  lowOp = lowOpParm;
+  highOp = highOpParm;
+
+  //Descend to the leftmost child that can hold a key above the low bound
+  PageId nodeNum = rootPageNum;
+  while(true){
+    Page *page;
+    bufMgr->readPage(file, nodeNum, page);
+    NonLeaf *node = (NonLeaf*)page;
+    int child = 0;
+    while(child < node->count && !aboveLow(node->keyArray[child])) child++;
+    PageId childNum = node->pageNoArray[child];
+    int level = node->level;
+    bufMgr->unPinPage(file, nodeNum, false);
+    nodeNum = childNum;
+    if(level == 1) break;
+  }
+
+  currentPageNum = nodeNum;
+  bufMgr->readPage(file, currentPageNum, currentPageData);
+  nextEntry = 0;
+  scanExecuting = true;
+  while(true){
+    Leaf *leaf = (Leaf*)currentPageData;
+    while(nextEntry < leaf->count && !aboveLow(leaf->keyArray[nextEntry])) nextEntry++;
+    if(nextEntry < leaf->count) break;
+    if(!nextLeaf()) break;
+  }
+  Leaf *leaf = (Leaf*)currentPageData;
+  if(nextEntry == -1 || !belowHigh(leaf->keyArray[nextEntry])){
+    endScan();
+    throw NoSuchKeyFoundException();
+  }
+}
+
+template <class Key>
+bool CompositeIndex<Key>::nextLeaf()
+{
+  while(true){
+    PageId sibNum = ((Leaf*)currentPageData)->rightSibPageNo;
+    if(sibNum == 0){
+      nextEntry = -1;
+      return false;
+    }
+    bufMgr->unPinPage(file, currentPageNum, false);
+    currentPageNum = sibNum;
+    bufMgr->readPage(file, currentPageNum, currentPageData);
+    nextEntry = 0;
+    if(((Leaf*)currentPageData)->count > 0) return true;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::scanNext
+// -----------------------------------------------------------------------------
+
+template <class Key>
+void CompositeIndex<Key>::scanNext(RecordId& outRid, Key &outKey)
+{
+  if(!scanExecuting){
+    throw ScanNotInitializedException();
+  }
+  if(nextEntry == -1){
+    throw IndexScanCompletedException();
+  }
+  Leaf *leaf = (Leaf*)currentPageData;
+  if(!belowHigh(leaf->keyArray[nextEntry])){
+    throw IndexScanCompletedException();
+  }
+  outRid = leaf->ridArray[nextEntry];
+  outKey = leaf->keyArray[nextEntry];
+  if(++nextEntry == leaf->count){
+    nextLeaf();
+  }
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::endScan
+// -----------------------------------------------------------------------------
+
+template <class Key>
+void CompositeIndex<Key>::endScan()
+{
+  if(!scanExecuting){
+    throw ScanNotInitializedException();
+  }
+  bufMgr->unPinPage(file, currentPageNum, false);
+  currentPageNum = 0;
+  scanExecuting = false;
+}
+
+}
@@ -0,0 +1,724 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "compressed_index.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+
+namespace badgerdb {
+
+static_assert(sizeof(CompressedIndexMeta) <= Page::SIZE,
+              "Compressed index meta page must fit a page.");
+
+namespace {
+
+const std::size_t HEADER_WORDS = (sizeof(CompressedLeafHeader) + 7) / 8;
+
+// Words taken by count values of the given width.
+std::size_t packedWords(const int count, const int bits) {
+  return (static_cast<std::size_t>(count) * bits + 63) / 64;
+}
+
+// Words taken by the page numbers and ends of the given number of groups.
+std::size_t groupWords(const int groups) {
+  return (static_cast<std::size_t>(groups) *
+              (sizeof(PageId) + sizeof(std::uint16_t)) +
+          7) / 8;
+}
+
+// Bits needed for values from 0 to range.
+int bitsFor(const std::uint32_t range) {
+  return range == 0 ? 0 : 32 - __builtin_clz(range);
+}
+
+void packBits(std::uint64_t* words, const std::size_t index, const int bits,
+              const std::uint32_t value) {
+  if (bits == 0) {
+    return;
+  }
+  const std::size_t bit = index * bits;
+  const int shift = bit % 64;
+  words[bit / 64] |= static_cast<std::uint64_t>(value) << shift;
+  if (shift + bits > 64) {
+    words[bit / 64 + 1] |= static_cast<std::uint64_t>(value) >> (64 - shift);
+  }
+}
+
+std::uint32_t unpackOne(const std::uint64_t* words, const std::size_t index,
+                        const int bits) {
+  if (bits == 0) {
+    return 0;
+  }
+  const std::size_t bit = index * bits;
+  const int shift = bit % 64;
+  std::uint64_t value = words[bit / 64] >> shift;
+  if (shift + bits > 64) {
+    value |= words[bit / 64 + 1] << (64 - shift);
+  }
+  return static_cast<std::uint32_t>(value & ((std::uint64_t(1) << bits) - 1));
+}
+
+// Unpacks count values of the given width.
+void unpackAll(const std::uint64_t* words, const int count, const int bits,
+               std::uint32_t* out) {
+  if (bits == 0) {
+    std::fill(out, out + count, 0);
+    return;
+  }
+  const std::uint64_t mask = (std::uint64_t(1) << bits) - 1;
+  std::size_t bit = 0;
+  for (int i = 0; i < count; ++i, bit += bits) {
+    const int shift = bit % 64;
+    std::uint64_t value = words[bit / 64] >> shift;
+    if (shift + bits > 64) {
+      value |= words[bit / 64 + 1] << (64 - shift);
+    }
+    out[i] = static_cast<std::uint32_t>(value & mask);
+  }
+}
+
+// Where the sections of a compressed leaf start.
+struct LeafSections {
+  explicit LeafSections(const Page* page)
+      : header(reinterpret_cast<const CompressedLeafHeader*>(page)) {
+    keys = reinterpret_cast<const std::uint64_t*>(page) + HEADER_WORDS;
+    pages = keys + packedWords(header->count, header->key_bits);
+    group_pages = reinterpret_cast<const PageId*>(pages);
+    group_ends =
+        reinterpret_cast<const std::uint16_t*>(group_pages + header->num_groups);
+    slots = pages + (header->num_groups > 0
+                         ? groupWords(header->num_groups)
+                         : packedWords(header->count, header->page_bits));
+  }
+
+  int keyAt(const int i) const {
+    return static_cast<int>(static_cast<std::uint32_t>(header->key_base) +
+                            unpackOne(keys, i, header->key_bits));
+  }
+
+  RecordId ridAt(const int i) const {
+    RecordId rid;
+    if (header->num_groups > 0) {
+      rid.page_number =
+          group_pages[std::upper_bound(group_ends,
+                                       group_ends + header->num_groups, i) -
+                      group_ends];
+    } else {
+      rid.page_number = header->page_base + unpackOne(pages, i, header->page_bits);
+    }
+    rid.slot_number = unpackOne(slots, i, header->slot_bits);
+    rid.padding = 0;
+    return rid;
+  }
+
+  const CompressedLeafHeader* header;
+  const std::uint64_t* keys;
+  const std::uint64_t* pages;
+  const PageId* group_pages;
+  const std::uint16_t* group_ends;
+  const std::uint64_t* slots;
+};
+
+// Orders entries by key, then by record id, so builds are deterministic.
+bool compareEntries(const std::pair<int, RecordId>& a,
+                    const std::pair<int, RecordId>& b) {
+  if (a.first != b.first) {
+    return a.first < b.first;
+  }
+  if (a.second.page_number != b.second.page_number) {
+    return a.second.page_number < b.second.page_number;
+  }
+  return a.second.slot_number < b.second.slot_number;
+}
+
+// Children of a non-leaf node; unused page numbers are 0.
+int numChildren(const NonLeafNodeInt* node) {
+  return std::find(node->pageNoArray,
+                   node->pageNoArray + INTARRAYNONLEAFSIZE + 1, 0) -
+         node->pageNoArray;
+}
+
+void clearNonLeaf(NonLeafNodeInt* node, const int level) {
+  node->level = level;
+  std::fill(node->keyArray, node->keyArray + INTARRAYNONLEAFSIZE, INT_MAX);
+  std::fill(node->pageNoArray, node->pageNoArray + INTARRAYNONLEAFSIZE + 1, 0);
+}
+
+}
+
+CompressedLeafShape::CompressedLeafShape()
+    : count(0),
+      first_key(0),
+      last_key(0),
+      min_page(0),
+      max_page(0),
+      last_page(0),
+      max_slot(0),
+      groups(0) {
+}
+
+void CompressedLeafShape::add(const int key, const RecordId& rid) {
+  if (count == 0) {
+    first_key = key;
+    min_page = max_page = rid.page_number;
+  }
+  last_key = key;
+  min_page = std::min(min_page, rid.page_number);
+  max_page = std::max(max_page, rid.page_number);
+  max_slot = std::max(max_slot, rid.slot_number);
+  if (count == 0 || rid.page_number != last_page) {
+    ++groups;
+  }
+  last_page = rid.page_number;
+  ++count;
+}
+
+bool CompressedLeafShape::grouped() const {
+  return groupWords(groups) <= packedWords(count, bitsFor(max_page - min_page));
+}
+
+std::size_t CompressedLeafShape::size() const {
+  const int key_bits = bitsFor(static_cast<std::uint32_t>(last_key) -
+                               static_cast<std::uint32_t>(first_key));
+  const std::size_t page_words =
+      std::min(groupWords(groups),
+               packedWords(count, bitsFor(max_page - min_page)));
+  return 8 * (HEADER_WORDS + packedWords(count, key_bits) + page_words +
+              packedWords(count, bitsFor(max_slot)));
+}
+
+void encodeCompressedLeaf(const int* keys, const RecordId* rids,
+                          const int count, const PageId rightSibling,
+                          Page* page) {
+  CompressedLeafShape shape;
+  for (int i = 0; i < count; ++i) {
+    shape.add(keys[i], rids[i]);
+  }
+  char* data = reinterpret_cast<char*>(page);
+  std::memset(data, 0, Page::SIZE);
+  CompressedLeafHeader* header = reinterpret_cast<CompressedLeafHeader*>(data);
+  header->right_sib_page_no = rightSibling;
+  header->key_base = shape.first_key;
+  header->page_base = shape.min_page;
+  header->count = count;
+  header->num_groups = shape.grouped() ? shape.groups : 0;
+  header->key_bits = bitsFor(static_cast<std::uint32_t>(shape.last_key) -
+                             static_cast<std::uint32_t>(shape.first_key));
+  header->page_bits = bitsFor(shape.max_page - shape.min_page);
+  header->slot_bits = bitsFor(shape.max_slot);
+
+  std::uint64_t* words = reinterpret_cast<std::uint64_t*>(data) + HEADER_WORDS;
+  for (int i = 0; i < count; ++i) {
+    packBits(words, i, header->key_bits,
+             static_cast<std::uint32_t>(keys[i]) -
+                 static_cast<std::uint32_t>(header->key_base));
+  }
+  words += packedWords(count, header->key_bits);
+
+  if (header->num_groups > 0) {
+    PageId* group_pages = reinterpret_cast<PageId*>(words);
+    std::uint16_t* group_ends =
+        reinterpret_cast<std::uint16_t*>(group_pages + header->num_groups);
+    int group = -1;
+    for (int i = 0; i < count; ++i) {
+      if (i == 0 || rids[i].page_number != rids[i - 1].page_number) {
+        group_pages[++group] = rids[i].page_number;
+      }
+      group_ends[group] = i + 1;
+    }
+    words += groupWords(header->num_groups);
+  } else {
+    for (int i = 0; i < count; ++i) {
+      packBits(words, i, header->page_bits,
+               rids[i].page_number - header->page_base);
+    }
+    words += packedWords(count, header->page_bits);
+  }
+
+  for (int i = 0; i < count; ++i) {
+    packBits(words, i, header->slot_bits, rids[i].slot_number);
+  }
+}
+
+int decodeCompressedLeaf(const Page* page, int* keys, RecordId* rids) {
+  const LeafSections leaf(page);
+  const int count = leaf.header->count;
+
+  // Frame of reference: unpack the deltas, then add the base to all of them,
+  // four at a time where SSE2 is available.
+  std::uint32_t* deltas = reinterpret_cast<std::uint32_t*>(keys);
+  unpackAll(leaf.keys, count, leaf.header->key_bits, deltas);
+  int i = 0;
+#if defined(__SSE2__)
+  const __m128i base = _mm_set1_epi32(leaf.header->key_base);
+  for (; i + 4 <= count; i += 4) {
+    __m128i* block = reinterpret_cast<__m128i*>(deltas + i);
+    _mm_storeu_si128(block, _mm_add_epi32(_mm_loadu_si128(block), base));
+  }
+#endif
+  for (; i < count; ++i) {
+    deltas[i] += static_cast<std::uint32_t>(leaf.header->key_base);
+  }
+
+  std::uint32_t pages[COMPRESSED_LEAF_MAX_ENTRIES];
+  std::uint32_t slots[COMPRESSED_LEAF_MAX_ENTRIES];
+  if (leaf.header->num_groups > 0) {
+    for (int g = 0, first = 0; g < leaf.header->num_groups; ++g) {
+      std::fill(pages + first, pages + leaf.group_ends[g],
+                leaf.group_pages[g]);
+      first = leaf.group_ends[g];
+    }
+  } else {
+    unpackAll(leaf.pages, count, leaf.header->page_bits, pages);
+    for (int j = 0; j < count; ++j) {
+      pages[j] += leaf.header->page_base;
+    }
+  }
+  unpackAll(leaf.slots, count, leaf.header->slot_bits, slots);
+  for (int j = 0; j < count; ++j) {
+    rids[j].page_number = pages[j];
+    rids[j].slot_number = static_cast<SlotId>(slots[j]);
+    rids[j].padding = 0;
+  }
+  return count;
+}
+
+CompressedIndex::CompressedIndex(const std::string& relationName,
+                                 std::string& outIndexName, BufMgr* bufMgr,
+                                 const int attrByteOffset,
+                                 const Datatype attrType)
+    : file_(NULL),
+      bufMgr_(bufMgr),
+      meta_page_no_(1),
+      keys_(COMPRESSED_LEAF_MAX_ENTRIES),
+      rids_(COMPRESSED_LEAF_MAX_ENTRIES),
+      count_(0),
+      right_sib_no_(0),
+      insert_keys_(COMPRESSED_LEAF_MAX_ENTRIES + 1),
+      insert_rids_(COMPRESSED_LEAF_MAX_ENTRIES + 1),
+      scan_executing_(false),
+      next_entry_(0),
+      scan_last_(0) {
+  if (attrType != INTEGER) {
+    throw BadIndexInfoException(
+        "Compressed indexes support INTEGER keys only.");
+  }
+  std::ostringstream name;
+  name << relationName << '.' << attrByteOffset << ".compressed";
+  outIndexName = name.str();
+
+  if (File::exists(outIndexName)) {
+    file_ = new BlobFile(outIndexName, false);
+    Page* page;
+    bufMgr_->readPage(file_, meta_page_no_, page);
+    meta_ = *reinterpret_cast<CompressedIndexMeta*>(page);
+    bufMgr_->unPinPage(file_, meta_page_no_, false);
+    if (relationName.compare(0, sizeof(meta_.relation_name) - 1,
+                             meta_.relation_name) != 0 ||
+        meta_.attr_byte_offset != attrByteOffset) {
+      bufMgr_->flushFile(file_);
+      delete file_;
+      throw BadIndexInfoException("Index file " + outIndexName +
+                                  " is for another relation or attribute.");
+    }
+    return;
+  }
+
+  file_ = new BlobFile(outIndexName, true);
+  std::memset(&meta_, 0, sizeof(meta_));
+  std::strncpy(meta_.relation_name, relationName.c_str(),
+               sizeof(meta_.relation_name) - 1);
+  meta_.attr_byte_offset = attrByteOffset;
+  Page* page;
+  bufMgr_->allocPage(file_, meta_page_no_, page);
+  bufMgr_->unPinPage(file_, meta_page_no_, true);
+
+  std::vector<std::pair<int, RecordId> > entries;
+  {
+    FileScan scan(relationName, bufMgr_);
+    std::string scratch;
+    try {
+      RecordId rid;
+      while (true) {
+        scan.scanNext(rid);
+        const RecordView record = scan.getRecordView(scratch);
+        int key;
+        std::memcpy(&key, record.data + attrByteOffset, sizeof(key));
+        entries.push_back(std::make_pair(key, rid));
+      }
+    } catch (const EndOfFileException&) {
+    }
+  }
+  std::sort(entries.begin(), entries.end(), compareEntries);
+  bulkLoad(entries);
+  writeMeta();
+}
+
+CompressedIndex::~CompressedIndex() {
+  scan_executing_ = false;
+  writeMeta();
+  bufMgr_->flushFile(file_);
+  delete file_;
+}
+
+void CompressedIndex::bulkLoad(
+    const std::vector<std::pair<int, RecordId> >& entries) {
+  std::vector<int> keys(entries.size());
+  std::vector<RecordId> rids(entries.size());
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    keys[i] = entries[i].first;
+    rids[i] = entries[i].second;
+  }
+  meta_.num_entries = entries.size();
+
+  // First key and page number of every node of the level being built.
+  std::vector<std::pair<int, PageId> > level;
+  PageId prev_leaf_no = 0;
+  std::size_t first = 0;
+  while (first < entries.size()) {
+    // As many entries as fit.
+    CompressedLeafShape shape;
+    std::size_t end = first;
+    while (end < entries.size() && shape.count < COMPRESSED_LEAF_MAX_ENTRIES) {
+      CompressedLeafShape grown = shape;
+      grown.add(keys[end], rids[end]);
+      if (grown.size() > Page::SIZE) {
+        break;
+      }
+      shape = grown;
+      ++end;
+    }
+
+    PageId leaf_no;
+    Page* page;
+    bufMgr_->allocPage(file_, leaf_no, page);
+    encodeCompressedLeaf(&keys[first], &rids[first], end - first, 0, page);
+    bufMgr_->unPinPage(file_, leaf_no, true);
+    level.push_back(std::make_pair(keys[first], leaf_no));
+    ++meta_.num_leaves;
+
+    if (prev_leaf_no != 0) {
+      bufMgr_->readPage(file_, prev_leaf_no, page);
+      reinterpret_cast<CompressedLeafHeader*>(page)->right_sib_page_no =
+          leaf_no;
+      bufMgr_->unPinPage(file_, prev_leaf_no, true);
+    }
+    prev_leaf_no = leaf_no;
+    first = end;
+  }
+  if (level.empty()) {
+    return;
+  }
+
+  // Non-leaf levels, each node taking as many children as fit, until one
+  // root is left.
+  int node_level = 1;
+  do {
+    std::vector<std::pair<int, PageId> > upper;
+    for (std::size_t first_child = 0; first_child < level.size();
+         first_child += INTARRAYNONLEAFSIZE + 1) {
+      const std::size_t children =
+          std::min(level.size() - first_child,
+                   static_cast<std::size_t>(INTARRAYNONLEAFSIZE + 1));
+      PageId node_no;
+      Page* page;
+      bufMgr_->allocPage(file_, node_no, page);
+      NonLeafNodeInt* node = reinterpret_cast<NonLeafNodeInt*>(page);
+      clearNonLeaf(node, node_level);
+      node->pageNoArray[0] = level[first_child].second;
+      for (std::size_t i = 1; i < children; ++i) {
+        node->keyArray[i - 1] = level[first_child + i].first;
+        node->pageNoArray[i] = level[first_child + i].second;
+      }
+      bufMgr_->unPinPage(file_, node_no, true);
+      upper.push_back(std::make_pair(level[first_child].first, node_no));
+      ++meta_.num_non_leaves;
+    }
+    level.swap(upper);
+    node_level = 0;
+  } while (level.size() > 1);
+  meta_.root_page_no = level[0].second;
+}
+
+PageId CompressedIndex::findLeaf(const int key, std::vector<PageId>* path) {
+  PageId node_no = meta_.root_page_no;
+  while (true) {
+    Page* page;
+    bufMgr_->readPage(file_, node_no, page);
+    const NonLeafNodeInt* node = reinterpret_cast<NonLeafNodeInt*>(page);
+    if (path != NULL) {
+      path->push_back(node_no);
+    }
+    // The child left of the first separator not below the key; a key of
+    // INT_MAX can run into the empty slots.
+    int i = std::lower_bound(node->keyArray,
+                             node->keyArray + INTARRAYNONLEAFSIZE, key) -
+            node->keyArray;
+    while (i > 0 && node->pageNoArray[i] == 0) {
+      --i;
+    }
+    const PageId child = node->pageNoArray[i];
+    const int level = node->level;
+    bufMgr_->unPinPage(file_, node_no, false);
+    if (level == 1) {
+      return child;
+    }
+    node_no = child;
+  }
+}
+
+void CompressedIndex::loadLeaf(const PageId leafNo) {
+  Page* page;
+  bufMgr_->readPage(file_, leafNo, page);
+  count_ = decodeCompressedLeaf(page, &keys_[0], &rids_[0]);
+  right_sib_no_ =
+      reinterpret_cast<CompressedLeafHeader*>(page)->right_sib_page_no;
+  bufMgr_->unPinPage(file_, leafNo, false);
+}
+
+void CompressedIndex::insertEntry(const int key, const RecordId rid) {
+  ++meta_.num_entries;
+  if (meta_.root_page_no == 0) {
+    // The first entry gets a leaf and a root above it.
+    PageId leaf_no;
+    Page* page;
+    bufMgr_->allocPage(file_, leaf_no, page);
+    encodeCompressedLeaf(&key, &rid, 1, 0, page);
+    bufMgr_->unPinPage(file_, leaf_no, true);
+    bufMgr_->allocPage(file_, meta_.root_page_no, page);
+    NonLeafNodeInt* root = reinterpret_cast<NonLeafNodeInt*>(page);
+    clearNonLeaf(root, 1);
+    root->pageNoArray[0] = leaf_no;
+    bufMgr_->unPinPage(file_, meta_.root_page_no, true);
+    meta_.num_leaves = 1;
+    meta_.num_non_leaves = 1;
+    return;
+  }
+
+  std::vector<PageId> path;
+  const PageId leaf_no = findLeaf(key, &path);
+  Page* page;
+  bufMgr_->readPage(file_, leaf_no, page);
+  int* keys = &insert_keys_[0];
+  RecordId* rids = &insert_rids_[0];
+  const int count = decodeCompressedLeaf(page, keys, rids);
+  const PageId right_sib =
+      reinterpret_cast<CompressedLeafHeader*>(page)->right_sib_page_no;
+  const int slot = std::upper_bound(keys, keys + count, key) - keys;
+  std::copy_backward(keys + slot, keys + count, keys + count + 1);
+  std::copy_backward(rids + slot, rids + count, rids + count + 1);
+  keys[slot] = key;
+  rids[slot] = rid;
+
+  CompressedLeafShape shape;
+  for (int i = 0; i <= count; ++i) {
+    shape.add(keys[i], rids[i]);
+  }
+  if (shape.count <= COMPRESSED_LEAF_MAX_ENTRIES &&
+      shape.size() <= Page::SIZE) {
+    encodeCompressedLeaf(keys, rids, count + 1, right_sib, page);
+    bufMgr_->unPinPage(file_, leaf_no, true);
+    return;
+  }
+
+  // Split in the middle; either half packs no worse than the whole.
+  const int mid = (count + 1) / 2;
+  PageId new_leaf_no;
+  Page* new_page;
+  bufMgr_->allocPage(file_, new_leaf_no, new_page);
+  encodeCompressedLeaf(keys + mid, rids + mid, count + 1 - mid, right_sib,
+                       new_page);
+  encodeCompressedLeaf(keys, rids, mid, new_leaf_no, page);
+  bufMgr_->unPinPage(file_, new_leaf_no, true);
+  bufMgr_->unPinPage(file_, leaf_no, true);
+  ++meta_.num_leaves;
+  insertIntoParent(path, leaf_no, keys[mid], new_leaf_no);
+}
+
+void CompressedIndex::insertIntoParent(std::vector<PageId>& path,
+                                       const PageId left, const int key,
+                                       const PageId right) {
+  const PageId node_no = path.back();
+  path.pop_back();
+  Page* page;
+  bufMgr_->readPage(file_, node_no, page);
+  NonLeafNodeInt* node = reinterpret_cast<NonLeafNodeInt*>(page);
+  const int children = numChildren(node);
+  const int at =
+      std::find(node->pageNoArray, node->pageNoArray + children, left) -
+      node->pageNoArray;
+
+  if (children < INTARRAYNONLEAFSIZE + 1) {
+    std::copy_backward(node->keyArray + at, node->keyArray + children - 1,
+                       node->keyArray + children);
+    std::copy_backward(node->pageNoArray + at + 1,
+                       node->pageNoArray + children,
+                       node->pageNoArray + children + 1);
+    node->keyArray[at] = key;
+    node->pageNoArray[at + 1] = right;
+    bufMgr_->unPinPage(file_, node_no, true);
+    return;
+  }
+
+  // Split the full node, the middle separator moves up.
+  std::vector<int> keys(node->keyArray, node->keyArray + children - 1);
+  std::vector<PageId> pages(node->pageNoArray, node->pageNoArray + children);
+  keys.insert(keys.begin() + at, key);
+  pages.insert(pages.begin() + at + 1, right);
+  const int mid = keys.size() / 2;
+  const int level = node->level;
+
+  clearNonLeaf(node, level);
+  std::copy(keys.begin(), keys.begin() + mid, node->keyArray);
+  std::copy(pages.begin(), pages.begin() + mid + 1, node->pageNoArray);
+  PageId new_node_no;
+  Page* new_page;
+  bufMgr_->allocPage(file_, new_node_no, new_page);
+  NonLeafNodeInt* new_node = reinterpret_cast<NonLeafNodeInt*>(new_page);
+  clearNonLeaf(new_node, level);
+  std::copy(keys.begin() + mid + 1, keys.end(), new_node->keyArray);
+  std::copy(pages.begin() + mid + 1, pages.end(), new_node->pageNoArray);
+  bufMgr_->unPinPage(file_, new_node_no, true);
+  bufMgr_->unPinPage(file_, node_no, true);
+  ++meta_.num_non_leaves;
+
+  if (!path.empty()) {
+    insertIntoParent(path, node_no, keys[mid], new_node_no);
+    return;
+  }
+  // The root split, a new root goes above both halves.
+  PageId root_no;
+  bufMgr_->allocPage(file_, root_no, page);
+  NonLeafNodeInt* root = reinterpret_cast<NonLeafNodeInt*>(page);
+  clearNonLeaf(root, 0);
+  root->keyArray[0] = keys[mid];
+  root->pageNoArray[0] = node_no;
+  root->pageNoArray[1] = new_node_no;
+  bufMgr_->unPinPage(file_, root_no, true);
+  meta_.root_page_no = root_no;
+  ++meta_.num_non_leaves;
+}
+
+std::size_t CompressedIndex::lookup(const int key, RecordId* out,
+                                    const std::size_t max) {
+  if (meta_.root_page_no == 0) {
+    return 0;
+  }
+  std::size_t found = 0;
+  PageId leaf_no = findLeaf(key, NULL);
+  while (leaf_no != 0) {
+    Page* page;
+    bufMgr_->readPage(file_, leaf_no, page);
+    const LeafSections leaf(page);
+    const int count = leaf.header->count;
+
+    // Binary search on the packed keys.
+    int low = 0;
+    int high = count;
+    while (low < high) {
+      const int mid = (low + high) / 2;
+      if (leaf.keyAt(mid) < key) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    int i = low;
+    for (; i < count && leaf.keyAt(i) == key; ++i) {
+      if (found < max) {
+        out[found] = leaf.ridAt(i);
+      }
+      ++found;
+    }
+    const PageId next = leaf.header->right_sib_page_no;
+    bufMgr_->unPinPage(file_, leaf_no, false);
+    // Equal keys can go on in the next leaf only if this one ran out.
+    leaf_no = i < count ? 0 : next;
+  }
+  return found;
+}
+
+void CompressedIndex::startScan(const void* lowVal, const Operator lowOp,
+                                const void* highVal, const Operator highOp) {
+  scan_executing_ = false;
+  const int low = *reinterpret_cast<const int*>(lowVal);
+  const int high = *reinterpret_cast<const int*>(highVal);
+  if (low > high) {
+    throw BadScanrangeException();
+  }
+  if (lowOp == LT || lowOp == LTE || highOp == GT || highOp == GTE) {
+    throw BadOpcodesException();
+  }
+  const long long first = lowOp == GT ? static_cast<long long>(low) + 1 : low;
+  scan_last_ = highOp == LT ? static_cast<long long>(high) - 1 : high;
+  if (meta_.root_page_no == 0 || first > scan_last_) {
+    throw NoSuchKeyFoundException();
+  }
+
+  loadLeaf(findLeaf(static_cast<int>(first), NULL));
+  next_entry_ =
+      std::lower_bound(keys_.begin(), keys_.begin() + count_, first) -
+      keys_.begin();
+  while (next_entry_ == count_ && right_sib_no_ != 0) {
+    loadLeaf(right_sib_no_);
+    next_entry_ = 0;
+  }
+  if (next_entry_ == count_ || keys_[next_entry_] > scan_last_) {
+    throw NoSuchKeyFoundException();
+  }
+  scan_executing_ = true;
+}
+
+void CompressedIndex::scanNext(RecordId& outRid) {
+  if (!scan_executing_) {
+    throw ScanNotInitializedException();
+  }
+  if (next_entry_ == count_) {
+    if (right_sib_no_ == 0) {
+      throw IndexScanCompletedException();
+    }
+    loadLeaf(right_sib_no_);
+    next_entry_ = 0;
+  }
+  if (keys_[next_entry_] > scan_last_) {
+    throw IndexScanCompletedException();
+  }
+  outRid = rids_[next_entry_++];
+}
+
+void CompressedIndex::endScan() {
+  if (!scan_executing_) {
+    throw ScanNotInitializedException();
+  }
+  scan_executing_ = false;
+}
+
+void CompressedIndex::writeMeta() {
+  Page* page;
+  bufMgr_->readPage(file_, meta_page_no_, page);
+  *reinterpret_cast<CompressedIndexMeta*>(page) = meta_;
+  bufMgr_->unPinPage(file_, meta_page_no_, true);
+}
+
+}
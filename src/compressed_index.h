@@ -0,0 +1,278 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Most entries a compressed leaf holds, however well they pack.
+ */
+const int COMPRESSED_LEAF_MAX_ENTRIES = 4096;
+
+/**
+ * @brief Header of a compressed leaf page.
+ *
+ * The header is followed by three bit-packed sections, each starting on a
+ * 64-bit word: the key deltas from key_base, the pages of the record ids,
+ * and the slot numbers of the record ids.  The pages are either packed per
+ * entry as deltas from page_base, or, when consecutive entries share heap
+ * pages, stored once per group of entries: num_groups page numbers followed
+ * by the index one past the last entry of each group.
+ */
+struct CompressedLeafHeader {
+  /**
+   * Page number of the leaf on the right side, 0 for the last leaf.
+   */
+  PageId right_sib_page_no;
+
+  /**
+   * Smallest key of the leaf; keys are stored as deltas from it.
+   */
+  std::int32_t key_base;
+
+  /**
+   * Smallest page number of the record ids, when packed per entry.
+   */
+  PageId page_base;
+
+  std::uint16_t count;
+
+  /**
+   * Number of groups of entries on the same heap page, 0 if the pages are
+   * packed per entry.
+   */
+  std::uint16_t num_groups;
+
+  std::uint8_t key_bits;
+  std::uint8_t page_bits;
+  std::uint8_t slot_bits;
+  std::uint8_t unused;
+};
+
+/**
+ * @brief Sizes of the sections of a compressed leaf, grown an entry at a time
+ * in key order.
+ */
+struct CompressedLeafShape {
+  CompressedLeafShape();
+
+  /**
+   * Accounts for one more entry, whose key is not smaller than any before.
+   */
+  void add(const int key, const RecordId& rid);
+
+  /**
+   * Returns the bytes the leaf takes with the smaller of the two ways of
+   * storing pages.
+   */
+  std::size_t size() const;
+
+  /**
+   * Returns true if the pages are stored per group.
+   */
+  bool grouped() const;
+
+  int count;
+  int first_key;
+  int last_key;
+  PageId min_page;
+  PageId max_page;
+  PageId last_page;
+  SlotId max_slot;
+  int groups;
+};
+
+/**
+ * @brief Writes entries sorted by key to a compressed leaf page.
+ *
+ * @param keys          Keys in order.
+ * @param rids          Record ids of the entries.
+ * @param count         Number of entries, whose shape fits a page.
+ * @param rightSibling  Page number of the next leaf.
+ * @param page          Page written.
+ */
+void encodeCompressedLeaf(const int* keys, const RecordId* rids,
+                          const int count, const PageId rightSibling,
+                          Page* page);
+
+/**
+ * @brief Decodes every entry of a compressed leaf page.
+ *
+ * @param page  Page read.
+ * @param keys  Receives the keys, room for COMPRESSED_LEAF_MAX_ENTRIES.
+ * @param rids  Receives the record ids, room for the same number.
+ * @return  Number of entries.
+ */
+int decodeCompressedLeaf(const Page* page, int* keys, RecordId* rids);
+
+/**
+ * @brief First page of a compressed index file.
+ */
+struct CompressedIndexMeta {
+  /**
+   * Name of base relation.
+   */
+  char relation_name[20];
+
+  int attr_byte_offset;
+
+  /**
+   * Root of the tree, a NonLeafNodeInt, 0 if the index is empty.
+   */
+  PageId root_page_no;
+
+  std::uint64_t num_entries;
+  std::uint32_t num_leaves;
+  std::uint32_t num_non_leaves;
+};
+
+/**
+ * @brief B+tree on an INTEGER attribute whose leaves are compressed.
+ *
+ * The non-leaf nodes are those of BTreeIndex.  A leaf stores its keys as bit
+ * packed deltas from its smallest key (frame of reference) and the record
+ * ids as bit packed slot numbers with the page numbers either bit packed the
+ * same way or stored once for every run of entries on the same heap page.
+ * Leaves hold as many entries as fit, so dense keys on few heap pages take a
+ * fraction of the pages of BTreeIndex leaves.  Scans decode a whole leaf at
+ * a time; lookups binary search the packed keys in place.
+ *
+ * Unlike BTreeIndex, the root is kept in the meta page, so an index opened
+ * again is usable.
+ *
+ * @warning This class is not threadsafe.
+ */
+class CompressedIndex {
+ public:
+  /**
+   * Opens the index file of the relation on the given attribute if it exists.
+   * Otherwise creates it and bulk loads it from the records of the relation,
+   * read with a FileScan.
+   *
+   * @param relationName    Name of the relation file.
+   * @param outIndexName    Returns the name of the index file.
+   * @param bufMgr          Buffer manager the pages are read through.
+   * @param attrByteOffset  Offset of the key inside the records.
+   * @param attrType        Type of the key, which must be INTEGER.
+   * @throws  BadIndexInfoException  If the key is not INTEGER or the existing
+   *                                 index file is for another relation or
+   *                                 attribute.
+   */
+  CompressedIndex(const std::string& relationName, std::string& outIndexName,
+                  BufMgr* bufMgr, const int attrByteOffset,
+                  const Datatype attrType);
+
+  /**
+   * Ends any scan, writes the meta page, flushes the index file and closes
+   * it.
+   */
+  ~CompressedIndex();
+
+  /**
+   * Inserts an entry.  The leaf is decoded, and encoded again with the entry
+   * or split in two if it no longer fits.
+   */
+  void insertEntry(const int key, const RecordId rid);
+
+  /**
+   * Finds the entries with the given key, see BTreeIndex::lookup.
+   */
+  std::size_t lookup(const int key, RecordId* out, const std::size_t max);
+
+  /**
+   * Begins a scan of a key range, see BTreeIndex::startScan.
+   *
+   * @throws  BadOpcodesException     If an operator is not allowed.
+   * @throws  BadScanrangeException   If low is greater than high.
+   * @throws  NoSuchKeyFoundException If no key is in the range.
+   */
+  void startScan(const void* lowVal, const Operator lowOp,
+                 const void* highVal, const Operator highOp);
+
+  /**
+   * Returns the record id of the next entry of the scan.
+   *
+   * @throws  ScanNotInitializedException  If no scan has been started.
+   * @throws  IndexScanCompletedException  If the range has been scanned.
+   */
+  void scanNext(RecordId& outRid);
+
+  /**
+   * Ends the current scan.
+   *
+   * @throws  ScanNotInitializedException  If no scan has been started.
+   */
+  void endScan();
+
+  std::size_t numEntries() const { return meta_.num_entries; }
+  std::size_t numLeaves() const { return meta_.num_leaves; }
+  std::size_t numNonLeaves() const { return meta_.num_non_leaves; }
+
+ private:
+  /**
+   * Writes the tree bottom-up from entries in key order, each leaf holding
+   * as many entries as fit.
+   */
+  void bulkLoad(const std::vector<std::pair<int, RecordId> >& entries);
+
+  /**
+   * Descends to the leftmost leaf that may hold the key.
+   *
+   * @param key   Key searched for.
+   * @param path  If not NULL, receives the non-leaf pages from the root down.
+   * @return  Page number of the leaf.
+   */
+  PageId findLeaf(const int key, std::vector<PageId>* path);
+
+  /**
+   * Decodes a leaf into the scan buffers.
+   */
+  void loadLeaf(const PageId leafNo);
+
+  /**
+   * Inserts a separator and the page right of it, next to the page left of
+   * it, into the last non-leaf node on the path, splitting it and the nodes
+   * above it as needed.
+   */
+  void insertIntoParent(std::vector<PageId>& path, const PageId left,
+                        const int key, const PageId right);
+
+  void writeMeta();
+
+  BlobFile* file_;
+  BufMgr* bufMgr_;
+  PageId meta_page_no_;
+  CompressedIndexMeta meta_;
+
+  // Entries of the leaf being scanned.
+  std::vector<int> keys_;
+  std::vector<RecordId> rids_;
+  int count_;
+  PageId right_sib_no_;
+
+  // Entries of the leaf an insert changes, with room for one more.
+  std::vector<int> insert_keys_;
+  std::vector<RecordId> insert_rids_;
+
+  bool scan_executing_;
+  int next_entry_;
+  long long scan_last_;
+};
+
+}
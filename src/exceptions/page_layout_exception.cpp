@@ -0,0 +1,25 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_layout_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PageLayoutException::PageLayoutException(const PageId page_num,
+                                         const std::string& reason)
+    : BadgerDbException(""),
+      page_number_(page_num) {
+  std::stringstream ss;
+  ss << "Operation does not fit the layout of the page: " << reason
+     << " Page: " << page_number_;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,43 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an operation does not fit the
+ *        layout of a page, such as asking a slotted page for a column.
+ */
+class PageLayoutException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page layout exception for the given page.
+   *
+   * @param page_num   Number of the page.
+   * @param reason     What does not fit the layout.
+   */
+  PageLayoutException(const PageId page_num, const std::string& reason);
+
+  /**
+   * Returns the page number of the page which caused this exception.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+ protected:
+  /**
+   * Page number of the page which caused this exception.
+   */
+  const PageId page_number_;
+};
+
+}
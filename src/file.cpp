@@ -12,19 +12,25 @@
 #include <memory>
 #include <string>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
 #include "file_iterator.h"
+#include "log_manager.h"
 #include "page.h"
 
 namespace badgerdb {
 
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+std::set<std::string> File::unsynced_files_;
+LogManager* File::log_manager_ = NULL;
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
@@ -33,6 +39,9 @@ void File::remove(const std::string& filename) {
   if (isOpen(filename)) {
     throw FileOpenException(filename);
   }
+  if (log_manager_ != NULL) {
+    log_manager_->logRemove(filename);
+  }
   std::remove(filename.c_str());
 }
 
@@ -71,6 +80,8 @@ File::File(const std::string& name, const bool create_new) : filename_(name) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
                          0 /* num_free_pages */, 0 /* first_free_page */};
+    logHeader(header);
+    forceLog();
     writeHeader(header);
   }
 }
@@ -123,9 +134,71 @@ FileHeader File::readHeader() const {
 }
 
 void File::writeHeader(const FileHeader& header) {
+  if (log_manager_ != NULL) {
+    log_manager_->writePoint();
+  }
   stream_->seekp(0 /* pos */, std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
-  stream_->flush();
+  flushStream();
+}
+
+void File::flushStream() {
+  // With a log the write is already durable through its log record, which
+  // recovery replays if the write itself is lost.
+  if (log_manager_ == NULL) {
+    stream_->flush();
+  } else {
+    unsynced_files_.insert(filename_);
+  }
+}
+
+void File::readRaw(const std::streampos position, char* data,
+                   const std::size_t length) const {
+  std::memset(data, 0, length);
+  stream_->seekg(position, std::ios::beg);
+  stream_->read(data, length);
+  // Reading past the end of the file fails; those bytes stay zero.
+  stream_->clear();
+}
+
+void File::logWrite(const PageId page_number, const bool has_page_lsn,
+                    const std::streampos position, const char* data,
+                    const std::size_t length) const {
+  if (log_manager_ == NULL) {
+    return;
+  }
+  std::unique_ptr<char[]> before(new char[length]);
+  readRaw(position, before.get(), length);
+  log_manager_->logFileWrite(filename_, page_number, has_page_lsn, position,
+                             before.get(), data, length);
+}
+
+void File::logHeader(const FileHeader& header) const {
+  logWrite(Page::INVALID_NUMBER, false /* has_page_lsn */, 0 /* pos */,
+           reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+}
+
+void File::forceLog() const {
+  if (log_manager_ != NULL) {
+    log_manager_->flushAll();
+  }
+}
+
+void File::syncAll() {
+  for (StreamMap::iterator it = open_streams_.begin();
+       it != open_streams_.end(); ++it) {
+    it->second->flush();
+  }
+  for (std::set<std::string>::iterator it = unsynced_files_.begin();
+       it != unsynced_files_.end(); ++it) {
+    // Files removed since they were written no longer exist.
+    const int fd = ::open(it->c_str(), O_RDWR);
+    if (fd >= 0) {
+      ::fsync(fd);
+      ::close(fd);
+    }
+  }
+  unsynced_files_.clear();
 }
 
 
@@ -212,8 +285,11 @@ Page PageFile::allocatePage(PageId &new_page_number) {
 		else
 		{
       // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
+      // of the linked list.  The list is in page number order, so the last
+      // page of the file is the tail whenever it is in use.
+      existing_page = readPage(header.num_pages - 1, true /* allow_free */);
+      for (FileIterator iter = begin();
+           !existing_page.isUsed() && iter != end(); ++iter) {
         if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
           existing_page = *iter;
           break;
@@ -224,6 +300,14 @@ Page PageFile::allocatePage(PageId &new_page_number) {
     }
     ++header.num_pages;
   }
+  // Log all three writes and force the log once before making any of them.
+  logPage(new_page_number, new_page.header_, new_page);
+  if (existing_page.page_number() != Page::INVALID_NUMBER) {
+    logPage(existing_page.page_number(), existing_page.header_, existing_page);
+  }
+  logHeader(header);
+  forceLog();
+
   writePage(new_page_number, new_page.header_, new_page);
   if (existing_page.page_number() != Page::INVALID_NUMBER) {
     // If we updated an existing page by inserting the new page into the
@@ -258,6 +342,20 @@ Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
 }
 
 void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
+	if (log_manager_ != NULL)
+	{
+		// Written without the buffer manager, so nobody has logged it yet.
+		logPage(new_page_number, headerForWrite(new_page_number, new_page), new_page);
+		forceLog();
+	}
+	writeBufferedPage(new_page_number, new_page);
+}
+
+void PageFile::writeBufferedPage(const PageId new_page_number, const Page& new_page) {
+	writePage(new_page_number, headerForWrite(new_page_number, new_page), new_page);
+}
+
+PageHeader PageFile::headerForWrite(const PageId new_page_number, const Page& new_page) const {
 	PageHeader header = readPageHeader(new_page_number);
 	if (header.current_page_number == Page::INVALID_NUMBER)
 	{
@@ -270,7 +368,18 @@ void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
 	const PageId next_page_number = header.next_page_number;
 	header = new_page.header_;
 	header.next_page_number = next_page_number;
-	writePage(new_page_number, header, new_page);
+	return header;
+}
+
+void PageFile::logPage(const PageId page_number, const PageHeader& header,
+                       const Page& new_page) const {
+  if (log_manager_ == NULL) {
+    return;
+  }
+  Page image = new_page;
+  image.header_ = header;
+  logWrite(page_number, true /* has_page_lsn */, pagePosition(page_number),
+           reinterpret_cast<const char*>(&image), Page::SIZE);
 }
 
 void PageFile::deletePage(const PageId page_number) {
@@ -297,6 +406,12 @@ void PageFile::deletePage(const PageId page_number) {
   existing_page.set_next_page_number(header.first_free_page);
   header.first_free_page = page_number;
   ++header.num_free_pages;
+  if (previous_page.isUsed()) {
+    logPage(previous_page.page_number(), previous_page.header_, previous_page);
+  }
+  logPage(page_number, existing_page.header_, existing_page);
+  logHeader(header);
+  forceLog();
   if (previous_page.isUsed()) {
     writePage(previous_page.page_number(), previous_page.header_, previous_page);
   }
@@ -315,10 +430,13 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
+  if (log_manager_ != NULL) {
+    log_manager_->writePoint();
+  }
   stream_->seekp(pagePosition(page_number), std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
   stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  flushStream();
 }
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
@@ -372,7 +490,11 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 	++header.num_pages;
 
-	writePage(new_page_number, new_page);
+	logWrite(new_page_number, false /* has_page_lsn */, pagePosition(new_page_number),
+	         reinterpret_cast<const char*>(&new_page), Page::SIZE);
+	logHeader(header);
+	forceLog();
+	writeBufferedPage(new_page_number, new_page);
 	writeHeader(header);
 
 	return new_page;
@@ -386,9 +508,24 @@ Page BlobFile::readPage(const PageId page_number) const {
 }
 
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
+	if (log_manager_ != NULL)
+	{
+		// Written without the buffer manager, so nobody has logged it yet.
+		logWrite(new_page_number, false /* has_page_lsn */, pagePosition(new_page_number),
+		         reinterpret_cast<const char*>(&new_page), Page::SIZE);
+		forceLog();
+	}
+	writeBufferedPage(new_page_number, new_page);
+}
+
+void BlobFile::writeBufferedPage(const PageId new_page_number, const Page& new_page) {
+	if (log_manager_ != NULL)
+	{
+		log_manager_->writePoint();
+	}
 	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
 	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
-	stream_->flush();
+	flushStream();
 }
 
 //delePage should not be called for a blob_file, not supported
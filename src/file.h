@@ -11,12 +11,14 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <set>
 
 #include "page.h"
 
 namespace badgerdb {
 
 class FileIterator;
+class LogManager;
 
 /**
  * @brief Header metadata for files on disk which contain pages.
@@ -111,6 +113,17 @@ class File {
    */
   static bool exists(const std::string& filename);
 
+  /**
+   * Attaches a write-ahead log to all files.  From then on, every write a
+   * file makes on its own (page allocation and deletion, header updates,
+   * direct page writes) is logged before it reaches the disk.
+   *
+   * @param log_manager  Log to use, or NULL to stop logging.
+   */
+  static void setLogManager(LogManager* log_manager) {
+    log_manager_ = log_manager;
+  }
+
   /**
    * Destructor that automatically closes the underlying file if no other
    * File objects are using it.
@@ -210,6 +223,66 @@ class File {
    */
   void writeHeader(const FileHeader& header);
 
+  /**
+   * Pushes a write made to the stream down to the operating system.  Skipped
+   * when a log is attached, since the log already holds the write.
+   */
+  void flushStream();
+
+  /**
+   * Writes a page whose changes the buffer manager has already logged, so
+   * unlike writePage it does not log anything itself.
+   *
+   * @param page_number Number of page whose contents to replace.
+   * @param new_page    Page to write.
+   */
+  virtual void writeBufferedPage(const PageId page_number,
+                                 const Page& new_page) = 0;
+
+  /**
+   * Reads raw bytes from the file.  Bytes past the end of the file read as
+   * zero.
+   *
+   * @param position  Offset from the beginning of the file.
+   * @param data      Buffer the bytes are read into.
+   * @param length    Number of bytes to read.
+   */
+  void readRaw(const std::streampos position, char* data,
+               const std::size_t length) const;
+
+  /**
+   * Logs a write about to be made to the file, if a log is attached.  The
+   * log still has to be forced with forceLog before the write is made.
+   *
+   * @param page_number   Page being written, Page::INVALID_NUMBER for the
+   *                      file header.
+   * @param has_page_lsn  True if the page is stored with a PageHeader.
+   * @param position      Offset of the write from the beginning of the file.
+   * @param data          Bytes about to be written.
+   * @param length        Number of bytes.
+   */
+  void logWrite(const PageId page_number, const bool has_page_lsn,
+                const std::streampos position, const char* data,
+                const std::size_t length) const;
+
+  /**
+   * Logs a header write about to be made, if a log is attached.
+   *
+   * @param header  File header about to be written.
+   */
+  void logHeader(const FileHeader& header) const;
+
+  /**
+   * Forces everything logged so far to disk, if a log is attached.
+   */
+  void forceLog() const;
+
+  /**
+   * Makes every write made since the last call durable: flushes the streams
+   * of all open files and syncs every file written to in between.
+   */
+  static void syncAll();
+
   typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
   typedef std::map<std::string, int> CountMap;
 
@@ -233,7 +306,19 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Write-ahead log attached to all files, NULL if none.
+   */
+  static LogManager* log_manager_;
+
+  /**
+   * Files written to while a log is attached that have not been synced since.
+   */
+  static std::set<std::string> unsynced_files_;
+
   friend class FileIterator;
+  friend class LogManager;
+  friend class BufMgr;
 };
 
 class PageFile : public File {
@@ -341,7 +426,40 @@ class PageFile : public File {
    */
   FileIterator end();
 
+ protected:
+  /**
+   * Writes a page whose changes the buffer manager has already logged.
+   *
+   * @param page_number Number of page whose contents to replace.
+   * @param new_page    Page to write.
+   * @throws  InvalidPageException  If the page has been deleted.
+   */
+  void writeBufferedPage(const PageId page_number,
+                         const Page& new_page) override;
+
  private:
+  /**
+   * Returns the header a page is written with: the header of <new_page>,
+   * except for the next page number which is kept as it is on disk.
+   *
+   * @param page_number Number of page about to be written.
+   * @param new_page    Page about to be written.
+   * @return  Header to write.
+   * @throws  InvalidPageException  If the page has been deleted.
+   */
+  PageHeader headerForWrite(const PageId page_number,
+                            const Page& new_page) const;
+
+  /**
+   * Logs a page write about to be made, if a log is attached.
+   *
+   * @param page_number Number of page about to be written.
+   * @param header      Header the page is written with.
+   * @param new_page    Page about to be written.
+   */
+  void logPage(const PageId page_number, const PageHeader& header,
+               const Page& new_page) const;
+
 
   /**
    * Reads a page from the file.  If <allow_free> is not set, an exception
@@ -473,6 +591,16 @@ class BlobFile : public File {
    * @param page_number   Number of page to delete.
    */
   void deletePage(const PageId page_number) override;
+
+ protected:
+  /**
+   * Writes a page whose changes the buffer manager has already logged.
+   *
+   * @param page_number Number of page whose contents to replace.
+   * @param new_page    Page to write.
+   */
+  void writeBufferedPage(const PageId page_number,
+                         const Page& new_page) override;
 };
 
 }
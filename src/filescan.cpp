@@ -5,11 +5,87 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <exception>
+#include <thread>
 #include "filescan.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scan_param_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace badgerdb { 
 
+namespace {
+
+// writes the positions of the values within [low, high] to sel and returns how many there are.
+// four values are compared at a time; the selection vector is filled without branches
+std::size_t selectInts(const int* values, const std::size_t count,
+                       const int low, const int high, std::uint16_t* sel)
+{
+  std::size_t selected = 0;
+  std::size_t i = 0;
+#ifdef __SSE2__
+  const __m128i lowVec = _mm_set1_epi32(low);
+  const __m128i highVec = _mm_set1_epi32(high);
+  for (; i + 4 <= count; i += 4)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    const __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(lowVec, v), _mm_cmpgt_epi32(v, highVec));
+    const int bits = ~_mm_movemask_ps(_mm_castsi128_ps(outside));
+    for (int k = 0; k < 4; k++)
+    {
+      sel[selected] = i + k;
+      selected += (bits >> k) & 1;
+    }
+  }
+#endif
+  for (; i < count; i++)
+  {
+    sel[selected] = i;
+    selected += values[i] >= low && values[i] <= high;
+  }
+  return selected;
+}
+
+// same for doubles, two at a time, with either bound inclusive or exclusive
+std::size_t selectDoubles(const double* values, const std::size_t count,
+                          const double low, const bool lowInclusive,
+                          const double high, const bool highInclusive,
+                          std::uint16_t* sel)
+{
+  std::size_t selected = 0;
+  std::size_t i = 0;
+#ifdef __SSE2__
+  const __m128d lowVec = _mm_set1_pd(low);
+  const __m128d highVec = _mm_set1_pd(high);
+  for (; i + 2 <= count; i += 2)
+  {
+    const __m128d v = _mm_loadu_pd(values + i);
+    const __m128d aboveLow = lowInclusive ? _mm_cmpge_pd(v, lowVec) : _mm_cmpgt_pd(v, lowVec);
+    const __m128d belowHigh = highInclusive ? _mm_cmple_pd(v, highVec) : _mm_cmplt_pd(v, highVec);
+    const int bits = _mm_movemask_pd(_mm_and_pd(aboveLow, belowHigh));
+    sel[selected] = i;
+    selected += bits & 1;
+    sel[selected] = i + 1;
+    selected += (bits >> 1) & 1;
+  }
+#endif
+  for (; i < count; i++)
+  {
+    sel[selected] = i;
+    selected += (lowInclusive ? values[i] >= low : values[i] > low) &&
+        (highInclusive ? values[i] <= high : values[i] < high);
+  }
+  return selected;
+}
+
+}
+
 FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 {
   file = new PageFile(name, false);	//dont create new file
@@ -24,7 +100,7 @@ FileScan::~FileScan()
   // generally must unpin last page of the scan
   if (curPage != NULL)
   {
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
+    bufMgr->unPinPage(file, filePageIter.page_number(), curDirtyFlag);
     curPage = NULL;
 		curDirtyFlag = false;
     filePageIter = file->begin();
@@ -35,8 +111,6 @@ FileScan::~FileScan()
 
 void FileScan::scanNext(RecordId& outRid)
 {
-  std::string rec;
-
   if (filePageIter == file->end())
 	{
 		throw EndOfFileException();
@@ -53,7 +127,7 @@ void FileScan::scanNext(RecordId& outRid)
 		}
 	 
 		// read the first page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage); 
+    bufMgr->readPage(file, filePageIter.page_number(), curPage); 
 		curDirtyFlag = false;
 
 		// get the first record off the page
@@ -61,9 +135,6 @@ void FileScan::scanNext(RecordId& outRid)
 
 		if(pageRecordIter != curPage->end()) 
 		{
-		  // get pointer to record
-		  rec = *pageRecordIter;
-
 			outRid = pageRecordIter.getCurrentRecord();
 			return;
 		}
@@ -76,7 +147,7 @@ void FileScan::scanNext(RecordId& outRid)
   while (pageRecordIter == curPage->end())
   {
     // unpin the current page
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
+    bufMgr->unPinPage(file, filePageIter.page_number(), curDirtyFlag);
     curPage = NULL;
     curDirtyFlag = false;
 
@@ -88,17 +159,13 @@ void FileScan::scanNext(RecordId& outRid)
     }
 
     // read the next page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage);
+    bufMgr->readPage(file, filePageIter.page_number(), curPage);
 
     // get the first record off the page
     pageRecordIter = curPage->begin(); 
   }
 
   // curRec points at a valid record
-  // see if the record satisfies the scan's predicate 
-  // get a pointer to the record
-  rec = *pageRecordIter;
-
 	// return rid of the record
 	outRid = pageRecordIter.getCurrentRecord();
 	return;
@@ -111,10 +178,225 @@ std::string FileScan::getRecord()
   return *pageRecordIter;
 }
 
+// returns a view of the current record on the pinned page, without copying it
+RecordView FileScan::getRecordView()
+{
+  return pageRecordIter.getRecordView();
+}
+
+// returns a view of the current record, reassembling a PAX record into scratch
+RecordView FileScan::getRecordView(std::string& scratch)
+{
+  return curPage->getRecordView(pageRecordIter.getCurrentRecord(), scratch);
+}
+
+// looks at the layout of the first page; every page of a relation has the same layout
+bool FileScan::findColumn(const std::size_t recordOffset, std::size_t& column)
+{
+  FileIterator firstPageIter = file->begin();
+  if (firstPageIter == file->end())
+  {
+    return false;
+  }
+  Page* firstPage;
+  bufMgr->readPage(file, firstPageIter.page_number(), firstPage);
+  const bool found = firstPage->findColumn(recordOffset, column);
+  bufMgr->unPinPage(file, firstPageIter.page_number(), false);
+  return found;
+}
+
+// returns the minipage of the column on the next page.  page is left pinned
+// until the following call or the end of the scan
+void FileScan::scanNextColumn(const std::size_t column, ColumnView& outColumn)
+{
+  nextPage();
+  outColumn = curPage->getColumn(column);
+}
+
+void FileScan::scanNextBatch(const int attrByteOffset, const Datatype attrType,
+                             const void* lowVal, const Operator lowOp,
+                             const void* highVal, const Operator highOp,
+                             std::vector<RecordId>& outRids)
+{
+  if ((lowOp != GT && lowOp != GTE) || (highOp != LT && highOp != LTE))
+  {
+    throw BadOpcodesException();
+  }
+  if (attrType == STRING)
+  {
+    throw BadScanParamException();
+  }
+  const bool isInt = attrType == INTEGER;
+  if (isInt ? *(const int*)lowVal > *(const int*)highVal
+            : *(const double*)lowVal > *(const double*)highVal)
+  {
+    throw BadScanrangeException();
+  }
+
+  nextPage();
+  outRids.clear();
+
+  // a PAX page holding the attribute as a column of its own is filtered in place, over every slot;
+  // anything else is decoded into a batch of the used slots first
+  const std::size_t width = isInt ? sizeof(int) : sizeof(double);
+  const char* values = reinterpret_cast<const char*>(batchValues);
+  std::size_t count;
+  ColumnView column;
+  column.data = NULL;
+  std::size_t columnIndex;
+  if (curPage->findColumn(attrByteOffset, columnIndex) &&
+      curPage->getColumn(columnIndex).width == width)
+  {
+    column = curPage->getColumn(columnIndex);
+    values = column.data;
+    count = column.num_slots;
+  }
+  else
+  {
+    count = curPage->gatherAttribute(attrByteOffset, width, reinterpret_cast<char*>(batchValues), batchSlots);
+  }
+
+  std::size_t selected;
+  if (isInt)
+  {
+    // turn the range into inclusive bounds
+    const long long low = (long long)*(const int*)lowVal + (lowOp == GT);
+    const long long high = (long long)*(const int*)highVal - (highOp == LT);
+    if (low > high)
+    {
+      return;
+    }
+    selected = selectInts(reinterpret_cast<const int*>(values), count, low, high, selection);
+  }
+  else
+  {
+    selected = selectDoubles(reinterpret_cast<const double*>(values), count,
+                             *(const double*)lowVal, lowOp == GTE,
+                             *(const double*)highVal, highOp == LTE, selection);
+  }
+
+  const PageId pageNo = filePageIter.page_number();
+  for (std::size_t k = 0; k < selected; k++)
+  {
+    if (column.data == NULL)
+    {
+      outRids.push_back(RecordId{pageNo, batchSlots[selection[k]], 0});
+    }
+    else if (column.isUsed(selection[k] + 1))
+    {
+      outRids.push_back(RecordId{pageNo, (SlotId)(selection[k] + 1), 0});
+    }
+  }
+}
+
+void FileScan::nextPage()
+{
+  if (filePageIter == file->end())
+  {
+    throw EndOfFileException();
+  }
+
+  if (curPage == NULL)
+  {
+    filePageIter = file->begin();
+  }
+  else
+  {
+    bufMgr->unPinPage(file, filePageIter.page_number(), curDirtyFlag);
+    curPage = NULL;
+    curDirtyFlag = false;
+    filePageIter++;
+  }
+  if (filePageIter == file->end())
+  {
+    throw EndOfFileException();
+  }
+
+  bufMgr->readPage(file, filePageIter.page_number(), curPage);
+}
+
 // mark current page of scan dirty
 void FileScan::markDirty()
 {
   curDirtyFlag = true;
 }
 
+ParallelFileScan::ParallelFileScan(const std::string &name, BufMgr *bufferMgr)
+  : cursor(0), failed(false)
+{
+  file = new PageFile(name, false);	//dont create new file
+  bufMgr = bufferMgr;
+  for (FileIterator iter = file->begin(); iter != file->end(); ++iter)
+  {
+    pageIds.push_back(iter.page_number());
+  }
+}
+
+ParallelFileScan::~ParallelFileScan()
+{
+  bufMgr->flushFile(file);
+  delete file;
+}
+
+void ParallelFileScan::run(const unsigned numWorkers, const PageCallback &visit)
+{
+  cursor = 0;
+  failed = false;
+  std::vector<std::exception_ptr> errors(numWorkers);
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < numWorkers; i++)
+  {
+    workers.push_back(std::thread([this, i, &visit, &errors]() {
+      try
+      {
+        work(i, visit);
+      }
+      catch (...)
+      {
+        errors[i] = std::current_exception();
+        failed = true;
+      }
+    }));
+  }
+  for (unsigned i = 0; i < numWorkers; i++)
+  {
+    workers[i].join();
+  }
+  for (unsigned i = 0; i < numWorkers; i++)
+  {
+    if (errors[i])
+    {
+      std::rethrow_exception(errors[i]);
+    }
+  }
+}
+
+void ParallelFileScan::work(const unsigned worker, const PageCallback &visit)
+{
+  while (!failed)
+  {
+    const std::size_t first = cursor.fetch_add(CHUNK_PAGES);
+    if (first >= pageIds.size())
+    {
+      return;
+    }
+    const std::size_t last = std::min(first + CHUNK_PAGES, pageIds.size());
+    for (std::size_t i = first; i < last; i++)
+    {
+      Page* page;
+      bufMgr->readPage(file, pageIds[i], page);
+      try
+      {
+        visit(worker, page);
+      }
+      catch (...)
+      {
+        bufMgr->unPinPage(file, pageIds[i], false);
+        throw;
+      }
+      bufMgr->unPinPage(file, pageIds[i], false);
+    }
+  }
+}
+
 }
@@ -8,7 +8,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <string>
+#include <vector>
 #include "types.h"
 #include "page.h"
 #include "buffer.h"
@@ -31,9 +34,31 @@ class FileScan
   //return RecordId of next record that satisfies the scan 
   void scanNext(RecordId& outRid);
 
-  //read current record, returning pointer and length
+  //read current record, returning a copy
   std::string getRecord();
 
+  //read current record, returning pointer and length; valid until the scan moves to the next page
+  RecordView getRecordView();
+
+  //read current record of a page of either layout: a view into the page, or a PAX record reassembled into scratch
+  //valid until the scan moves to the next page or scratch is modified
+  RecordView getRecordView(std::string& scratch);
+
+  //true if the relation is stored in PAX pages with a column at the given byte offset of its records, which is returned in column
+  bool findColumn(const std::size_t recordOffset, std::size_t& column);
+
+  //moves the scan to the next page of a PAX relation and returns one column of it; valid until the scan moves on
+  //do not mix with scanNext in one scan
+  void scanNextColumn(const std::size_t column, ColumnView& outColumn);
+
+  //vectorized range filter: moves the scan to the next page, decodes the INTEGER or DOUBLE attribute at attrByteOffset
+  //of all its records into a batch, compares the batch against the range with SIMD instructions and returns the rids
+  //of the qualifying records; outRids is empty for a page without any.  do not mix with scanNext in one scan
+  void scanNextBatch(const int attrByteOffset, const Datatype attrType,
+                     const void* lowVal, const Operator lowOp,
+                     const void* highVal, const Operator highOp,
+                     std::vector<RecordId>& outRids);
+
   //marks current page of scan dirty
   void markDirty();
 
@@ -56,10 +81,90 @@ class FileScan
   FileIterator  filePageIter;
   PageIterator  pageRecordIter;
 
+  /**
+   * Unpins the current page, if any, and pins the next one.
+   */
+  void nextPage();
+
+  /**
+   * Attribute values of the page being filtered by scanNextBatch, and the slot each one comes from.
+   */
+  double        batchValues[PageHeader::MAX_SLOTS];
+  SlotId        batchSlots[PageHeader::MAX_SLOTS];
+
+  /**
+   * Selection vector: positions in the batch of the values that satisfy the predicate.
+   */
+  std::uint16_t selection[PageHeader::MAX_SLOTS];
+
   /**
    * True if page has been updated
    */
   bool  	      curDirtyFlag;
 };
 
+/**
+ * @brief This class is used to scan the pages of a relation with several worker threads.
+ *
+ * The used-page chain of the file is walked once when the scan starts to build a directory of page numbers.
+ * Workers then claim chunks of consecutive directory entries from a shared atomic cursor, pin each page
+ * through the buffer manager and hand it to a callback, which iterates over its records.
+ */
+class ParallelFileScan
+{
+ public:
+  /**
+   * Called by a worker for every page it claims, with the page pinned.  Callbacks of different workers
+   * run concurrently; the worker number, from 0 to the number of workers - 1, selects per-worker state.
+   */
+  typedef std::function<void(unsigned worker, Page* page)> PageCallback;
+
+  /**
+   * Pages a worker claims at a time.
+   */
+  static const std::size_t CHUNK_PAGES = 16;
+
+  ParallelFileScan(const std::string &name, BufMgr *bufMgr);
+
+  ~ParallelFileScan();
+
+  //returns the number of pages of the relation
+  std::size_t numPages() const { return pageIds.size(); }
+
+  //scans every page once with the given number of worker threads and returns when all of them are done.
+  //an exception thrown by a callback stops the scan and is rethrown here
+  void run(const unsigned numWorkers, const PageCallback &visit);
+
+ private:
+  /**
+   * Body of a worker thread.
+   */
+  void work(const unsigned worker, const PageCallback &visit);
+
+  /**
+   * File which is being scanned.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer Manager instance used to read pages into the buffer pool.
+   */
+  BufMgr        *bufMgr;
+
+  /**
+   * Page numbers of the used pages, in file order.
+   */
+  std::vector<PageId> pageIds;
+
+  /**
+   * Index in pageIds of the next page to hand out.
+   */
+  std::atomic<std::size_t> cursor;
+
+  /**
+   * Set when a worker failed; the others stop claiming pages.
+   */
+  std::atomic<bool> failed;
+};
+
 }
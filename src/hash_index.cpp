@@ -0,0 +1,395 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "hash_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb {
+
+static_assert(sizeof(HashMetaPage) <= Page::SIZE,
+              "Hash meta page must fit a page.");
+static_assert(sizeof(HashBucketPage) <= Page::SIZE,
+              "Hash bucket must fit a page.");
+
+namespace {
+
+bool compareKeys(const std::pair<int, RecordId>& a,
+                 const std::pair<int, RecordId>& b) {
+  return a.first < b.first;
+}
+
+}
+
+HashIndex::HashIndex(const std::string& relationName,
+                     std::string& outIndexName, BufMgr* bufMgr,
+                     const int attrByteOffset, const Datatype attrType)
+    : file_(NULL), bufMgr_(bufMgr), meta_page_no_(1) {
+  if (attrType != INTEGER) {
+    throw BadIndexInfoException("Hash indexes support INTEGER keys only.");
+  }
+  std::ostringstream name;
+  name << relationName << '.' << attrByteOffset << ".hash";
+  outIndexName = name.str();
+
+  if (File::exists(outIndexName)) {
+    file_ = new BlobFile(outIndexName, false);
+    Page* page;
+    bufMgr_->readPage(file_, meta_page_no_, page);
+    meta_ = *reinterpret_cast<HashMetaPage*>(page);
+    bufMgr_->unPinPage(file_, meta_page_no_, false);
+    if (relationName.compare(0, sizeof(meta_.relation_name) - 1,
+                             meta_.relation_name) != 0 ||
+        meta_.attr_byte_offset != attrByteOffset) {
+      bufMgr_->flushFile(file_);
+      delete file_;
+      throw BadIndexInfoException("Index file " + outIndexName +
+                                  " is for another relation or attribute.");
+    }
+    return;
+  }
+
+  // Meta page, one directory page and one empty bucket.
+  file_ = new BlobFile(outIndexName, true);
+  std::memset(&meta_, 0, sizeof(meta_));
+  std::strncpy(meta_.relation_name, relationName.c_str(),
+               sizeof(meta_.relation_name) - 1);
+  meta_.attr_byte_offset = attrByteOffset;
+  Page* page;
+  bufMgr_->allocPage(file_, meta_page_no_, page);
+  bufMgr_->unPinPage(file_, meta_page_no_, true);
+  PageId directory_page_no;
+  bufMgr_->allocPage(file_, directory_page_no, page);
+  meta_.directory_pages[0] = directory_page_no;
+  meta_.num_directory_pages = 1;
+  Page* bucket_page;
+  const PageId bucket_page_no = allocBucketPage(bucket_page);
+  bufMgr_->unPinPage(file_, bucket_page_no, true);
+  reinterpret_cast<PageId*>(page)[0] = bucket_page_no;
+  bufMgr_->unPinPage(file_, directory_page_no, true);
+  meta_.num_buckets = 1;
+  writeMeta();
+
+  FileScan scan(relationName, bufMgr_);
+  std::string scratch;
+  try {
+    RecordId rid;
+    while (true) {
+      scan.scanNext(rid);
+      const RecordView record = scan.getRecordView(scratch);
+      int key;
+      std::memcpy(&key, record.data + attrByteOffset, sizeof(key));
+      insertEntry(key, rid);
+    }
+  } catch (const EndOfFileException&) {
+  }
+}
+
+HashIndex::~HashIndex() {
+  writeMeta();
+  bufMgr_->flushFile(file_);
+  delete file_;
+}
+
+std::uint32_t HashIndex::hash(const int key) {
+  // Finalizer of MurmurHash3.
+  std::uint32_t h = static_cast<std::uint32_t>(key);
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+PageId HashIndex::bucketAt(const std::uint32_t entry) {
+  const PageId directory_page_no =
+      meta_.directory_pages[entry / HASH_DIRECTORY_PAGE_SIZE];
+  Page* page;
+  bufMgr_->readPage(file_, directory_page_no, page);
+  const PageId bucket =
+      reinterpret_cast<PageId*>(page)[entry % HASH_DIRECTORY_PAGE_SIZE];
+  bufMgr_->unPinPage(file_, directory_page_no, false);
+  return bucket;
+}
+
+void HashIndex::setBucketAt(const std::uint32_t entry, const PageId bucket) {
+  const PageId directory_page_no =
+      meta_.directory_pages[entry / HASH_DIRECTORY_PAGE_SIZE];
+  Page* page;
+  bufMgr_->readPage(file_, directory_page_no, page);
+  reinterpret_cast<PageId*>(page)[entry % HASH_DIRECTORY_PAGE_SIZE] = bucket;
+  bufMgr_->unPinPage(file_, directory_page_no, true);
+}
+
+void HashIndex::doubleDirectory() {
+  const std::uint32_t size = 1u << meta_.global_depth;
+  if (size < static_cast<std::uint32_t>(HASH_DIRECTORY_PAGE_SIZE)) {
+    // The new half still fits the first directory page.
+    Page* page;
+    bufMgr_->readPage(file_, meta_.directory_pages[0], page);
+    PageId* entries = reinterpret_cast<PageId*>(page);
+    std::copy(entries, entries + size, entries + size);
+    bufMgr_->unPinPage(file_, meta_.directory_pages[0], true);
+  } else {
+    const std::uint32_t pages = meta_.num_directory_pages;
+    for (std::uint32_t i = 0; i < pages; ++i) {
+      PageId page_no;
+      Page* page;
+      bufMgr_->allocPage(file_, page_no, page);
+      Page* old_page;
+      bufMgr_->readPage(file_, meta_.directory_pages[i], old_page);
+      std::memcpy(page, old_page, Page::SIZE);
+      bufMgr_->unPinPage(file_, meta_.directory_pages[i], false);
+      bufMgr_->unPinPage(file_, page_no, true);
+      meta_.directory_pages[meta_.num_directory_pages++] = page_no;
+    }
+  }
+  ++meta_.global_depth;
+  writeMeta();
+}
+
+void HashIndex::insertEntry(const int key, const RecordId rid) {
+  const std::uint32_t h = hash(key);
+  while (true) {
+    // The first page of the bucket with room takes the entry.
+    PageId page_no = bucketAt(h & ((1u << meta_.global_depth) - 1));
+    while (page_no != 0) {
+      Page* page;
+      bufMgr_->readPage(file_, page_no, page);
+      HashBucketPage* bucket = reinterpret_cast<HashBucketPage*>(page);
+      if (bucket->count < HASH_BUCKET_SIZE) {
+        insertIntoPage(bucket, key, rid);
+        bufMgr_->unPinPage(file_, page_no, true);
+        ++meta_.num_entries;
+        return;
+      }
+      const PageId next = bucket->overflow_page_no;
+      bufMgr_->unPinPage(file_, page_no, false);
+      page_no = next;
+    }
+    if (makeRoom(key, rid)) {
+      ++meta_.num_entries;
+      return;
+    }
+  }
+}
+
+bool HashIndex::makeRoom(const int key, const RecordId rid) {
+  const std::uint32_t h = hash(key);
+  const PageId primary = bucketAt(h & ((1u << meta_.global_depth) - 1));
+
+  // Gather the entries of the whole bucket.
+  std::vector<std::pair<int, RecordId> > entries;
+  std::vector<PageId> overflow;
+  int local_depth = 0;
+  bool same_hash = true;
+  for (PageId page_no = primary; page_no != 0;) {
+    Page* page;
+    bufMgr_->readPage(file_, page_no, page);
+    HashBucketPage* bucket = reinterpret_cast<HashBucketPage*>(page);
+    if (page_no == primary) {
+      local_depth = bucket->local_depth;
+    } else {
+      overflow.push_back(page_no);
+    }
+    for (int i = 0; i < bucket->count; ++i) {
+      entries.push_back(std::make_pair(bucket->keys[i], bucket->rids[i]));
+      same_hash = same_hash && hash(bucket->keys[i]) == h;
+    }
+    const PageId next = bucket->overflow_page_no;
+    bufMgr_->unPinPage(file_, page_no, false);
+    page_no = next;
+  }
+
+  if (same_hash || local_depth == HASH_MAX_DEPTH) {
+    // Splitting would not separate the keys: chain a page holding the entry.
+    const PageId last = overflow.empty() ? primary : overflow.back();
+    Page* page;
+    const PageId page_no = allocBucketPage(page);
+    HashBucketPage* bucket = reinterpret_cast<HashBucketPage*>(page);
+    bucket->local_depth = local_depth;
+    insertIntoPage(bucket, key, rid);
+    bufMgr_->unPinPage(file_, page_no, true);
+    Page* last_page;
+    bufMgr_->readPage(file_, last, last_page);
+    reinterpret_cast<HashBucketPage*>(last_page)->overflow_page_no = page_no;
+    bufMgr_->unPinPage(file_, last, true);
+    ++meta_.num_overflow_pages;
+    return true;
+  }
+
+  if (local_depth == meta_.global_depth) {
+    doubleDirectory();
+  }
+
+  // The overflow pages go to the free list, the entries are written anew.
+  for (std::size_t i = 0; i < overflow.size(); ++i) {
+    Page* page;
+    bufMgr_->readPage(file_, overflow[i], page);
+    HashBucketPage* bucket = reinterpret_cast<HashBucketPage*>(page);
+    bucket->count = 0;
+    bucket->overflow_page_no = meta_.free_page_no;
+    meta_.free_page_no = overflow[i];
+    bufMgr_->unPinPage(file_, overflow[i], true);
+  }
+  meta_.num_overflow_pages -= overflow.size();
+
+  // Split on the next bit of the hash; entries are gathered sorted page by
+  // page, so sort them again as a whole.
+  std::vector<std::pair<int, RecordId> > low;
+  std::vector<std::pair<int, RecordId> > high;
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    if ((hash(entries[i].first) >> local_depth) & 1) {
+      high.push_back(entries[i]);
+    } else {
+      low.push_back(entries[i]);
+    }
+  }
+  std::stable_sort(low.begin(), low.end(), compareKeys);
+  std::stable_sort(high.begin(), high.end(), compareKeys);
+  Page* page;
+  bufMgr_->readPage(file_, primary, page);
+  writeBucket(primary, page, local_depth + 1, low);
+  const PageId split = allocBucketPage(page);
+  writeBucket(split, page, local_depth + 1, high);
+  ++meta_.num_buckets;
+
+  // Every directory entry of the old bucket with the bit set moves over.
+  const std::uint32_t step = 1u << (local_depth + 1);
+  const std::uint32_t first =
+      (h & ((1u << local_depth) - 1)) | (1u << local_depth);
+  for (std::uint32_t entry = first; entry < (1u << meta_.global_depth);
+       entry += step) {
+    setBucketAt(entry, split);
+  }
+  return false;
+}
+
+PageId HashIndex::allocBucketPage(Page*& page) {
+  PageId page_no = meta_.free_page_no;
+  if (page_no != 0) {
+    bufMgr_->readPage(file_, page_no, page);
+    meta_.free_page_no =
+        reinterpret_cast<HashBucketPage*>(page)->overflow_page_no;
+  } else {
+    bufMgr_->allocPage(file_, page_no, page);
+  }
+  HashBucketPage* bucket = reinterpret_cast<HashBucketPage*>(page);
+  bucket->local_depth = 0;
+  bucket->count = 0;
+  bucket->overflow_page_no = 0;
+  return page_no;
+}
+
+void HashIndex::writeBucket(
+    const PageId pageNo, Page* page, const int localDepth,
+    const std::vector<std::pair<int, RecordId> >& entries) {
+  PageId page_no = pageNo;
+  HashBucketPage* bucket = reinterpret_cast<HashBucketPage*>(page);
+  bucket->local_depth = localDepth;
+  bucket->count = 0;
+  bucket->overflow_page_no = 0;
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    if (bucket->count == HASH_BUCKET_SIZE) {
+      Page* next_page;
+      const PageId next = allocBucketPage(next_page);
+      bucket->overflow_page_no = next;
+      bufMgr_->unPinPage(file_, page_no, true);
+      page_no = next;
+      bucket = reinterpret_cast<HashBucketPage*>(next_page);
+      bucket->local_depth = localDepth;
+      ++meta_.num_overflow_pages;
+    }
+    bucket->keys[bucket->count] = entries[i].first;
+    bucket->rids[bucket->count] = entries[i].second;
+    ++bucket->count;
+  }
+  bufMgr_->unPinPage(file_, page_no, true);
+}
+
+void HashIndex::insertIntoPage(HashBucketPage* bucket, const int key,
+                               const RecordId rid) {
+  const int slot =
+      std::upper_bound(bucket->keys, bucket->keys + bucket->count, key) -
+      bucket->keys;
+  std::copy_backward(bucket->keys + slot, bucket->keys + bucket->count,
+                     bucket->keys + bucket->count + 1);
+  std::copy_backward(bucket->rids + slot, bucket->rids + bucket->count,
+                     bucket->rids + bucket->count + 1);
+  bucket->keys[slot] = key;
+  bucket->rids[slot] = rid;
+  ++bucket->count;
+}
+
+std::size_t HashIndex::lookup(const int key, RecordId* out,
+                              const std::size_t max) {
+  std::size_t found = 0;
+  PageId page_no = bucketAt(hash(key) & ((1u << meta_.global_depth) - 1));
+  while (page_no != 0) {
+    Page* page;
+    bufMgr_->readPage(file_, page_no, page);
+    const HashBucketPage* bucket = reinterpret_cast<HashBucketPage*>(page);
+    for (int i = std::lower_bound(bucket->keys, bucket->keys + bucket->count,
+                                  key) -
+                 bucket->keys;
+         i < bucket->count && bucket->keys[i] == key; ++i) {
+      if (found < max) {
+        out[found] = bucket->rids[i];
+      }
+      ++found;
+    }
+    const PageId next = bucket->overflow_page_no;
+    bufMgr_->unPinPage(file_, page_no, false);
+    page_no = next;
+  }
+  return found;
+}
+
+bool HashIndex::deleteEntry(const int key, const RecordId rid) {
+  PageId page_no = bucketAt(hash(key) & ((1u << meta_.global_depth) - 1));
+  while (page_no != 0) {
+    Page* page;
+    bufMgr_->readPage(file_, page_no, page);
+    HashBucketPage* bucket = reinterpret_cast<HashBucketPage*>(page);
+    for (int i = std::lower_bound(bucket->keys, bucket->keys + bucket->count,
+                                  key) -
+                 bucket->keys;
+         i < bucket->count && bucket->keys[i] == key; ++i) {
+      if (bucket->rids[i].page_number == rid.page_number &&
+          bucket->rids[i].slot_number == rid.slot_number) {
+        std::copy(bucket->keys + i + 1, bucket->keys + bucket->count,
+                  bucket->keys + i);
+        std::copy(bucket->rids + i + 1, bucket->rids + bucket->count,
+                  bucket->rids + i);
+        --bucket->count;
+        bufMgr_->unPinPage(file_, page_no, true);
+        --meta_.num_entries;
+        return true;
+      }
+    }
+    const PageId next = bucket->overflow_page_no;
+    bufMgr_->unPinPage(file_, page_no, false);
+    page_no = next;
+  }
+  return false;
+}
+
+void HashIndex::writeMeta() {
+  Page* page;
+  bufMgr_->readPage(file_, meta_page_no_, page);
+  *reinterpret_cast<HashMetaPage*>(page) = meta_;
+  bufMgr_->unPinPage(file_, meta_page_no_, true);
+}
+
+}
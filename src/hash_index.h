@@ -0,0 +1,241 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Most bits of the hash the directory of a HashIndex uses.
+ */
+const int HASH_MAX_DEPTH = 21;
+
+/**
+ * @brief Number of directory entries on a directory page.
+ */
+const int HASH_DIRECTORY_PAGE_SIZE = Page::SIZE / sizeof(PageId);
+
+/**
+ * @brief Number of directory pages the meta page can list, enough for a
+ * directory of HASH_MAX_DEPTH bits.
+ */
+const int HASH_MAX_DIRECTORY_PAGES =
+    (1 << HASH_MAX_DEPTH) / HASH_DIRECTORY_PAGE_SIZE;
+
+/**
+ * @brief First page of a hash index file.
+ */
+struct HashMetaPage {
+  /**
+   * Name of base relation.
+   */
+  char relation_name[20];
+
+  /**
+   * Offset of the INTEGER key inside the records.
+   */
+  int attr_byte_offset;
+
+  /**
+   * Number of low bits of the hash that index the directory.
+   */
+  int global_depth;
+
+  std::uint64_t num_entries;
+  std::uint32_t num_buckets;
+  std::uint32_t num_overflow_pages;
+
+  /**
+   * First page of the list of overflow pages given back by splits, linked
+   * through their overflow_page_no.
+   */
+  PageId free_page_no;
+
+  std::uint32_t num_directory_pages;
+
+  /**
+   * Pages of the directory, in order.
+   */
+  PageId directory_pages[HASH_MAX_DIRECTORY_PAGES];
+};
+
+/**
+ * @brief Number of entries on a bucket page.
+ */
+const int HASH_BUCKET_SIZE =
+    (Page::SIZE - 2 * sizeof(int) - sizeof(PageId)) /
+    (sizeof(int) + sizeof(RecordId));
+
+/**
+ * @brief Primary or overflow page of a bucket.  Entries are kept sorted by
+ * key on every page.
+ */
+struct HashBucketPage {
+  /**
+   * Number of low bits of the hash that all keys of the bucket share.
+   */
+  int local_depth;
+
+  /**
+   * Number of entries on the page.
+   */
+  int count;
+
+  /**
+   * Next overflow page of the bucket, 0 for the last page.
+   */
+  PageId overflow_page_no;
+
+  int keys[HASH_BUCKET_SIZE];
+  RecordId rids[HASH_BUCKET_SIZE];
+};
+
+/**
+ * @brief Extendible hash index on an INTEGER attribute of a relation.
+ *
+ * The low global depth bits of the hash of a key select an entry of the
+ * directory, which holds the page of the key's bucket; several entries share
+ * a bucket whose local depth is smaller.  A full bucket is split in two on
+ * the next bit of the hash, and the directory doubles when the bucket already
+ * used every bit.  A bucket whose keys all have the same hash cannot be
+ * split, so it grows a chain of overflow pages instead, as does any bucket
+ * once the directory reaches HASH_MAX_DEPTH bits.
+ *
+ * The meta page, the directory and the buckets are all pages of one BlobFile
+ * read and written through the buffer manager.  Unlike BTreeIndex there are
+ * no range scans: only equality lookups.
+ *
+ * @warning This class is not threadsafe.
+ */
+class HashIndex {
+ public:
+  /**
+   * Opens the index file of the relation on the given attribute if it exists.
+   * Otherwise creates it and inserts an entry for every record of the
+   * relation, read with a FileScan.
+   *
+   * @param relationName    Name of the relation file.
+   * @param outIndexName    Returns the name of the index file.
+   * @param bufMgr          Buffer manager the pages are read through.
+   * @param attrByteOffset  Offset of the key inside the records.
+   * @param attrType        Type of the key, which must be INTEGER.
+   * @throws  BadIndexInfoException  If the key is not INTEGER or the existing
+   *                                 index file is for another relation or
+   *                                 attribute.
+   */
+  HashIndex(const std::string& relationName, std::string& outIndexName,
+            BufMgr* bufMgr, const int attrByteOffset,
+            const Datatype attrType);
+
+  /**
+   * Writes the meta page, flushes the index file and closes it.
+   */
+  ~HashIndex();
+
+  /**
+   * Inserts an entry.
+   */
+  void insertEntry(const int key, const RecordId rid);
+
+  /**
+   * Finds the entries with the given key.
+   *
+   * @param key  The key to look up.
+   * @param out  Receives the record ids of the first max matching entries.
+   * @param max  Capacity of out.
+   * @return  Number of entries with the key, which may be larger than max.
+   */
+  std::size_t lookup(const int key, RecordId* out, const std::size_t max);
+
+  /**
+   * Removes the entry with the given key and record id.
+   *
+   * @return  False if there is no such entry.
+   */
+  bool deleteEntry(const int key, const RecordId rid);
+
+  int globalDepth() const { return meta_.global_depth; }
+  std::size_t numEntries() const { return meta_.num_entries; }
+  std::size_t numBuckets() const { return meta_.num_buckets; }
+  std::size_t numOverflowPages() const { return meta_.num_overflow_pages; }
+
+ private:
+  /**
+   * Hashes a key to 32 bits.
+   */
+  static std::uint32_t hash(const int key);
+
+  /**
+   * Returns the primary page of the bucket at the given directory entry.
+   */
+  PageId bucketAt(const std::uint32_t entry);
+
+  /**
+   * Points the given directory entry at a bucket.
+   */
+  void setBucketAt(const std::uint32_t entry, const PageId bucket);
+
+  /**
+   * Doubles the directory, the new half pointing to the same buckets as the
+   * old one.
+   */
+  void doubleDirectory();
+
+  /**
+   * Makes room for the key in its full bucket: splits the bucket, or adds an
+   * overflow page holding the entry if it cannot be split.
+   *
+   * @return  True if the entry was stored in a new overflow page.
+   */
+  bool makeRoom(const int key, const RecordId rid);
+
+  /**
+   * Returns a page for an overflow page or a new bucket, from the free list
+   * if there is one.
+   */
+  PageId allocBucketPage(Page*& page);
+
+  /**
+   * Writes sorted entries to the bucket on the given pinned primary page,
+   * adding overflow pages as needed.
+   */
+  void writeBucket(const PageId pageNo, Page* page, const int localDepth,
+                   const std::vector<std::pair<int, RecordId> >& entries);
+
+  /**
+   * Inserts an entry into a page with room for it, keeping the keys sorted.
+   */
+  static void insertIntoPage(HashBucketPage* bucket, const int key,
+                             const RecordId rid);
+
+  /**
+   * Writes the in-memory copy of the meta page to the file.
+   */
+  void writeMeta();
+
+  BlobFile* file_;
+  BufMgr* bufMgr_;
+  PageId meta_page_no_;
+
+  /**
+   * Copy of the meta page.
+   */
+  HashMetaPage meta_;
+};
+
+}
@@ -0,0 +1,58 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "heap_fetch.h"
+
+#include <algorithm>
+
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+
+namespace badgerdb {
+
+HeapFetch::HeapFetch(const std::string& relationName, BTreeIndex* index,
+                     BufMgr* bufMgr)
+    : relation_name_(relationName),
+      index_(index),
+      bufMgr_(bufMgr),
+      pins_(0) {
+}
+
+std::size_t HeapFetch::run(const void* lowVal, const Operator lowOp,
+                           const void* highVal, const Operator highOp,
+                           const RecordCallback& emit) {
+  pins_ = 0;
+  rids_.clear();
+  try {
+    index_->startScan(lowVal, lowOp, highVal, highOp);
+  } catch (const NoSuchKeyFoundException&) {
+    return 0;
+  }
+  try {
+    RecordId rid;
+    while (true) {
+      index_->scanNext(rid);
+      rids_.push_back((static_cast<std::uint64_t>(rid.page_number) << 16) |
+                      rid.slot_number);
+    }
+  } catch (const IndexScanCompletedException&) {
+  }
+  index_->endScan();
+  std::sort(rids_.begin(), rids_.end());
+
+  // Qualifying records of a page are adjacent, so each page is pinned once.
+  RecordFetcher records(relation_name_, bufMgr_);
+  for (std::size_t i = 0; i < rids_.size(); ++i) {
+    const RecordId rid = {static_cast<PageId>(rids_[i] >> 16),
+                          static_cast<SlotId>(rids_[i] & 0xffff), 0};
+    emit(rid, records.fetch(rid));
+  }
+  pins_ = records.numPins();
+  return rids_.size();
+}
+
+}
@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+#include "join.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Fetches the records of an index range scan from the heap file in
+ * page order.
+ *
+ * The record ids of the range are collected from the index first and sorted
+ * by page and slot.  Each heap page holding a qualifying record is then
+ * pinned once and all of its qualifying records are returned from it, so an
+ * unclustered index costs one pin per page instead of one per record and the
+ * pages are read in file order.  Records come out in page order, not in key
+ * order.
+ *
+ * @warning This class is not threadsafe.
+ */
+class HeapFetch {
+ public:
+  /**
+   * Called for every record of the range.  The view is valid until the
+   * callback returns.
+   */
+  typedef std::function<void(const RecordId& rid, const RecordView& record)>
+      RecordCallback;
+
+  /**
+   * Constructor.
+   *
+   * @param relationName  Name of the relation file.
+   * @param index         Index of the relation.
+   * @param bufMgr        Buffer manager the pages are read through.
+   */
+  HeapFetch(const std::string& relationName, BTreeIndex* index,
+            BufMgr* bufMgr);
+
+  /**
+   * Fetches the records whose key lies in the given range.  The range is
+   * given as for BTreeIndex::startScan, which is used to collect the record
+   * ids and ends any scan running on the index.
+   *
+   * @param emit  Called with every record of the range.
+   * @return  Number of records fetched.
+   * @throws  BadOpcodesException    If the operators are not supported.
+   * @throws  BadScanrangeException  If lowVal > highVal.
+   */
+  std::size_t run(const void* lowVal, const Operator lowOp,
+                  const void* highVal, const Operator highOp,
+                  const RecordCallback& emit);
+
+  /**
+   * Returns the number of heap pages pinned by the last run.
+   */
+  std::size_t numPins() const { return pins_; }
+
+ private:
+  std::string relation_name_;
+  BTreeIndex* index_;
+  BufMgr* bufMgr_;
+
+  /**
+   * Record ids of the range, packed with the page number in the high bits so
+   * they sort by page and then by slot.
+   */
+  std::vector<std::uint64_t> rids_;
+
+  std::size_t pins_;
+};
+
+}
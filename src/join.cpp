@@ -0,0 +1,266 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "join.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <utility>
+
+#include "filescan.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+// Orders outer records by key, and records with equal keys by page so they
+// are fetched with one pin per page.
+bool compareKeyRids(const std::pair<int, RecordId>& a,
+                    const std::pair<int, RecordId>& b) {
+  if (a.first != b.first) return a.first < b.first;
+  if (a.second.page_number != b.second.page_number) {
+    return a.second.page_number < b.second.page_number;
+  }
+  return a.second.slot_number < b.second.slot_number;
+}
+
+}
+
+IndexLeafCursor::IndexLeafCursor(BTreeIndex* index)
+    : index_(index),
+      leaf_number_(0),
+      leaf_(NULL),
+      slot_(0),
+      count_(0),
+      at_end_(index->rootPageNum == 0),
+      descents_(0) {
+}
+
+IndexLeafCursor::~IndexLeafCursor() {
+  if (leaf_ != NULL) {
+    index_->bufMgr->unPinPage(index_->file, leaf_number_, false);
+  }
+}
+
+bool IndexLeafCursor::seek(const int key) {
+  if (at_end_) {
+    return false;
+  }
+  if (leaf_ != NULL && !holds(key)) {
+    // Keys probed in order are often close: try the right sibling first.
+    const PageId sibling = leaf_->rightSibPageNo;
+    if (sibling == 0) {
+      at_end_ = true;
+      return false;
+    }
+    moveTo(sibling);
+  }
+  if (leaf_ == NULL || !holds(key)) {
+    // Searching for key - 1 leads left of a separator equal to the key, to
+    // the first leaf that can hold the key when equal keys straddle leaves.
+    PageId leaf_number;
+    int upper_bound;
+    index_->findLeaf(key == INT_MIN ? key : key - 1, leaf_number, upper_bound);
+    ++descents_;
+    moveTo(leaf_number);
+    while (!holds(key)) {
+      const PageId sibling = leaf_->rightSibPageNo;
+      if (sibling == 0) {
+        at_end_ = true;
+        return false;
+      }
+      moveTo(sibling);
+    }
+  }
+  slot_ = std::lower_bound(leaf_->keyArray + slot_, leaf_->keyArray + count_,
+                           key) - leaf_->keyArray;
+  return true;
+}
+
+bool IndexLeafCursor::next() {
+  if (at_end_) {
+    return false;
+  }
+  ++slot_;
+  while (slot_ >= count_) {
+    const PageId sibling = leaf_->rightSibPageNo;
+    if (sibling == 0) {
+      at_end_ = true;
+      return false;
+    }
+    moveTo(sibling);
+  }
+  return true;
+}
+
+void IndexLeafCursor::moveTo(const PageId leaf_number) {
+  Page* page;
+  index_->bufMgr->readPage(index_->file, leaf_number, page);
+  if (leaf_ != NULL) {
+    index_->bufMgr->unPinPage(index_->file, leaf_number_, false);
+  }
+  leaf_number_ = leaf_number;
+  leaf_ = reinterpret_cast<LeafNodeInt*>(page);
+  slot_ = 0;
+  // Empty slots at the end of a leaf hold INT_MAX.
+  count_ = std::lower_bound(leaf_->keyArray,
+                            leaf_->keyArray + index_->leafOccupancy, INT_MAX) -
+           leaf_->keyArray;
+}
+
+RecordFetcher::RecordFetcher(const std::string& relationName, BufMgr* bufMgr)
+    : file_(new PageFile(relationName, false)),
+      bufMgr_(bufMgr),
+      page_number_(Page::INVALID_NUMBER),
+      page_(NULL),
+      pins_(0) {
+}
+
+RecordFetcher::~RecordFetcher() {
+  if (page_ != NULL) {
+    bufMgr_->unPinPage(file_, page_number_, false);
+  }
+  bufMgr_->flushFile(file_);
+  delete file_;
+}
+
+RecordView RecordFetcher::fetch(const RecordId& rid) {
+  if (page_ == NULL || rid.page_number != page_number_) {
+    Page* page;
+    bufMgr_->readPage(file_, rid.page_number, page);
+    if (page_ != NULL) {
+      bufMgr_->unPinPage(file_, page_number_, false);
+    }
+    page_number_ = rid.page_number;
+    page_ = page;
+    ++pins_;
+  }
+  return page_->getRecordView(rid, copy_);
+}
+
+IndexNestedLoopJoin::IndexNestedLoopJoin(const std::string& outerName,
+                                         const int outerByteOffset,
+                                         const std::string& innerName,
+                                         BTreeIndex* innerIndex,
+                                         BufMgr* bufMgr)
+    : outer_name_(outerName),
+      outer_byte_offset_(outerByteOffset),
+      inner_name_(innerName),
+      inner_index_(innerIndex),
+      bufMgr_(bufMgr),
+      descents_(0) {
+}
+
+std::size_t IndexNestedLoopJoin::run(const JoinCallback& emit) {
+  std::vector<std::pair<int, RecordId> > outer;
+  {
+    FileScan scan(outer_name_, bufMgr_);
+    std::string scratch;
+    try {
+      RecordId rid;
+      while (true) {
+        scan.scanNext(rid);
+        const RecordView record = scan.getRecordView(scratch);
+        int key;
+        std::memcpy(&key, record.data + outer_byte_offset_, sizeof(key));
+        outer.push_back(std::make_pair(key, rid));
+      }
+    } catch (const EndOfFileException&) {
+    }
+  }
+  std::sort(outer.begin(), outer.end(), compareKeyRids);
+
+  RecordFetcher outer_records(outer_name_, bufMgr_);
+  RecordFetcher inner_records(inner_name_, bufMgr_);
+  IndexLeafCursor cursor(inner_index_);
+  std::vector<RecordId> matches;
+  std::size_t pairs = 0;
+  for (std::size_t first = 0; first < outer.size();) {
+    const int key = outer[first].first;
+    std::size_t last = first;
+    while (last < outer.size() && outer[last].first == key) {
+      ++last;
+    }
+    // Every probe after this one is for a larger key.
+    if (!cursor.seek(key)) {
+      break;
+    }
+    matches.clear();
+    while (cursor.key() == key) {
+      matches.push_back(cursor.rid());
+      if (!cursor.next()) {
+        break;
+      }
+    }
+    for (std::size_t i = first; i < last && !matches.empty(); ++i) {
+      const RecordView left = outer_records.fetch(outer[i].second);
+      for (std::size_t j = 0; j < matches.size(); ++j) {
+        emit(left, inner_records.fetch(matches[j]));
+      }
+      pairs += matches.size();
+    }
+    first = last;
+  }
+  descents_ = cursor.numDescents();
+  return pairs;
+}
+
+SortMergeJoin::SortMergeJoin(const std::string& leftName,
+                             BTreeIndex* leftIndex,
+                             const std::string& rightName,
+                             BTreeIndex* rightIndex, BufMgr* bufMgr)
+    : left_name_(leftName),
+      left_index_(leftIndex),
+      right_name_(rightName),
+      right_index_(rightIndex),
+      bufMgr_(bufMgr) {
+}
+
+std::size_t SortMergeJoin::run(const JoinCallback& emit) {
+  IndexLeafCursor left(left_index_);
+  IndexLeafCursor right(right_index_);
+  RecordFetcher left_records(left_name_, bufMgr_);
+  RecordFetcher right_records(right_name_, bufMgr_);
+  std::vector<RecordId> group;
+  std::size_t pairs = 0;
+  bool more = left.seek(INT_MIN) && right.seek(INT_MIN);
+  while (more) {
+    if (left.key() < right.key()) {
+      more = left.seek(right.key());
+      continue;
+    }
+    if (right.key() < left.key()) {
+      more = right.seek(left.key());
+      continue;
+    }
+
+    // Equal keys: hold on to the right entries and pair each left one with
+    // all of them.
+    const int key = left.key();
+    group.clear();
+    bool more_right;
+    do {
+      group.push_back(right.rid());
+      more_right = right.next();
+    } while (more_right && right.key() == key);
+    bool more_left;
+    do {
+      const RecordView record = left_records.fetch(left.rid());
+      for (std::size_t i = 0; i < group.size(); ++i) {
+        emit(record, right_records.fetch(group[i]));
+      }
+      pairs += group.size();
+      more_left = left.next();
+    } while (more_left && left.key() == key);
+    more = more_left && more_right;
+  }
+  return pairs;
+}
+
+}
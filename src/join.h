@@ -0,0 +1,252 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Called for every pair of joined records.  The views are valid until
+ * the callback returns.
+ */
+typedef std::function<void(const RecordView& left, const RecordView& right)>
+    JoinCallback;
+
+/**
+ * @brief Position in the leaf chain of a BTreeIndex, moving forward only.
+ *
+ * The cursor keeps the leaf it is on pinned.  A seek for a key at or after
+ * the current position stays in the current leaf or moves to its right
+ * sibling when the key is close; only a key further away descends from the
+ * root again.
+ *
+ * @warning Do not insert into the index while a cursor is open on it.
+ */
+class IndexLeafCursor {
+ public:
+  /**
+   * Creates a cursor before the first entry of the index.
+   *
+   * @param index  Index whose leaves are walked.
+   */
+  IndexLeafCursor(BTreeIndex* index);
+
+  /**
+   * Unpins the current leaf.
+   */
+  ~IndexLeafCursor();
+
+  /**
+   * Moves to the first entry with a key greater than or equal to the given
+   * one.  Entries before the current position are not considered again.
+   *
+   * @param key  Key to seek to.
+   * @return  False if there is no such entry.
+   */
+  bool seek(const int key);
+
+  /**
+   * Moves to the next entry.
+   *
+   * @return  False if the current entry was the last one.
+   */
+  bool next();
+
+  /**
+   * Returns the key of the current entry.
+   */
+  int key() const { return leaf_->keyArray[slot_]; }
+
+  /**
+   * Returns the record id of the current entry.
+   */
+  RecordId rid() const { return index_->leafRids(leaf_)[slot_]; }
+
+  /**
+   * Returns the number of descents from the root so far.
+   */
+  std::size_t numDescents() const { return descents_; }
+
+ private:
+  /**
+   * Pins the given leaf in place of the current one and moves to its first
+   * entry.
+   */
+  void moveTo(const PageId leaf_number);
+
+  /**
+   * Returns true if the current leaf has an entry at or after the current
+   * position with a key greater than or equal to the given one.
+   */
+  bool holds(const int key) const {
+    return slot_ < count_ && leaf_->keyArray[count_ - 1] >= key;
+  }
+
+  BTreeIndex* index_;
+  PageId leaf_number_;
+  LeafNodeInt* leaf_;
+  int slot_;
+
+  /**
+   * Number of entries in the current leaf.
+   */
+  int count_;
+
+  /**
+   * True once the cursor has moved past the last entry.
+   */
+  bool at_end_;
+
+  std::size_t descents_;
+};
+
+/**
+ * @brief Keeps the heap page of the last record fetched pinned, so records
+ * read in page order cost one pin per page.
+ */
+class RecordFetcher {
+ public:
+  /**
+   * Opens the relation.
+   *
+   * @param relationName  Name of the relation file.
+   * @param bufMgr        Buffer manager the pages are read through.
+   */
+  RecordFetcher(const std::string& relationName, BufMgr* bufMgr);
+
+  /**
+   * Unpins the last page and closes the relation.
+   */
+  ~RecordFetcher();
+
+  /**
+   * Returns the record with the given id.  The view is valid until the next
+   * call.
+   */
+  RecordView fetch(const RecordId& rid);
+
+  /**
+   * Returns the number of pages pinned so far.
+   */
+  std::size_t numPins() const { return pins_; }
+
+ private:
+  PageFile* file_;
+  BufMgr* bufMgr_;
+  PageId page_number_;
+  Page* page_;
+
+  /**
+   * Scratch buffer the last record fetched from a PAX page is reassembled
+   * in.
+   */
+  std::string copy_;
+
+  std::size_t pins_;
+};
+
+/**
+ * @brief Equi-join of a relation with a relation indexed on the join
+ * attribute, by probing the index for every key of the outer relation.
+ *
+ * The keys of the outer relation are collected with a FileScan and sorted,
+ * so the probes reach the index in key order: each probe continues from the
+ * leaf position of the one before it through an IndexLeafCursor, and the
+ * inner entries of a key are read once for all outer records that have it.
+ * Outer records are fetched in key order; inner records in index order.
+ *
+ * @warning This class is not threadsafe.
+ */
+class IndexNestedLoopJoin {
+ public:
+  /**
+   * @param outerName        Name of the outer relation.
+   * @param outerByteOffset  Offset of the INTEGER join attribute in the outer
+   *                         records.
+   * @param innerName        Name of the inner relation.
+   * @param innerIndex       Index of the inner relation on the join attribute.
+   * @param bufMgr           Buffer manager the relations are read through.
+   */
+  IndexNestedLoopJoin(const std::string& outerName, const int outerByteOffset,
+                      const std::string& innerName, BTreeIndex* innerIndex,
+                      BufMgr* bufMgr);
+
+  /**
+   * Runs the join.
+   *
+   * @param emit  Called with every pair of an outer and an inner record with
+   *              equal keys.
+   * @return  Number of pairs emitted.
+   */
+  std::size_t run(const JoinCallback& emit);
+
+  /**
+   * Returns the number of descents of the inner index in the last run.
+   */
+  std::size_t numDescents() const { return descents_; }
+
+ private:
+  std::string outer_name_;
+  int outer_byte_offset_;
+  std::string inner_name_;
+  BTreeIndex* inner_index_;
+  BufMgr* bufMgr_;
+  std::size_t descents_;
+};
+
+/**
+ * @brief Equi-join of two relations that are both indexed on the join
+ * attribute, by walking the leaf chains of the two indexes in lockstep.
+ *
+ * Whichever side has the smaller key seeks forward to the key of the other,
+ * so runs of keys without a match are skipped a leaf at a time.  For equal
+ * keys every left record is paired with every right record.
+ *
+ * @warning This class is not threadsafe.
+ */
+class SortMergeJoin {
+ public:
+  /**
+   * @param leftName    Name of the left relation.
+   * @param leftIndex   Index of the left relation on the join attribute.
+   * @param rightName   Name of the right relation.
+   * @param rightIndex  Index of the right relation on the join attribute.
+   * @param bufMgr      Buffer manager the relations are read through.
+   */
+  SortMergeJoin(const std::string& leftName, BTreeIndex* leftIndex,
+                const std::string& rightName, BTreeIndex* rightIndex,
+                BufMgr* bufMgr);
+
+  /**
+   * Runs the join.
+   *
+   * @param emit  Called with every pair of a left and a right record with
+   *              equal keys.
+   * @return  Number of pairs emitted.
+   */
+  std::size_t run(const JoinCallback& emit);
+
+ private:
+  std::string left_name_;
+  BTreeIndex* left_index_;
+  std::string right_name_;
+  BTreeIndex* right_index_;
+  BufMgr* bufMgr_;
+};
+
+}
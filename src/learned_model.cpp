@@ -0,0 +1,162 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "learned_model.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "buffer.h"
+#include "page.h"
+
+namespace badgerdb {
+
+namespace {
+
+bool segmentBefore(const int key, const LearnedModel::Segment& segment) {
+  return key < segment.first_key;
+}
+
+// Page of a saved model.  Every page repeats the fields of the model, which
+// are read from the first one.
+struct ModelPage {
+  PageId next_page;
+  std::uint32_t num_segments;
+  int max_error;
+  int max_key;
+  std::uint32_t last_position;
+  std::uint32_t total_segments;
+  LearnedModel::Segment
+      segments[(Page::SIZE - 6 * sizeof(std::uint32_t)) /
+               sizeof(LearnedModel::Segment)];
+};
+
+static_assert(sizeof(ModelPage) <= Page::SIZE,
+              "A model page must fit in a page.");
+
+}
+
+LearnedModel::LearnedModel(const int maxError)
+    : max_error_(maxError), max_key_(0), last_position_(0) {
+}
+
+LearnedModel* LearnedModel::train(
+    const std::vector<std::pair<int, std::uint32_t> >& points,
+    const int maxError, const std::size_t maxSegments) {
+  if (points.empty()) {
+    return NULL;
+  }
+  LearnedModel* model = new LearnedModel(maxError);
+  model->max_key_ = points.back().first;
+  model->last_position_ = points.back().second;
+
+  // Range of slopes keeping every point of the current segment within the
+  // bound, narrowed by each point added to it.
+  Segment segment = {points[0].first, points[0].second, 0};
+  double low = 0;
+  double high = std::numeric_limits<double>::infinity();
+  for (std::size_t i = 1; i < points.size(); ++i) {
+    const double dx =
+        static_cast<double>(points[i].first) - segment.first_key;
+    const double dy =
+        static_cast<double>(points[i].second) - segment.position;
+    const double point_low = std::max(low, (dy - maxError) / dx);
+    const double point_high = std::min(high, (dy + maxError) / dx);
+    if (point_low <= point_high) {
+      low = point_low;
+      high = point_high;
+      continue;
+    }
+    segment.slope = high == std::numeric_limits<double>::infinity()
+                        ? low
+                        : (low + high) / 2;
+    model->segments_.push_back(segment);
+    if (model->segments_.size() == maxSegments) {
+      delete model;
+      return NULL;
+    }
+    segment.first_key = points[i].first;
+    segment.position = points[i].second;
+    low = 0;
+    high = std::numeric_limits<double>::infinity();
+  }
+  segment.slope =
+      high == std::numeric_limits<double>::infinity() ? low : (low + high) / 2;
+  model->segments_.push_back(segment);
+  return model;
+}
+
+LearnedModel* LearnedModel::load(BufMgr* bufMgr, File* file,
+                                 const PageId firstPage) {
+  Page* page;
+  bufMgr->readPage(file, firstPage, page);
+  const ModelPage* first = reinterpret_cast<const ModelPage*>(page);
+  LearnedModel* model = new LearnedModel(first->max_error);
+  model->max_key_ = first->max_key;
+  model->last_position_ = first->last_position;
+  model->segments_.reserve(first->total_segments);
+  PageId page_number = firstPage;
+  while (true) {
+    const ModelPage* saved = reinterpret_cast<const ModelPage*>(page);
+    model->segments_.insert(model->segments_.end(), saved->segments,
+                            saved->segments + saved->num_segments);
+    const PageId next_page = saved->next_page;
+    bufMgr->unPinPage(file, page_number, false);
+    if (next_page == Page::INVALID_NUMBER) {
+      break;
+    }
+    page_number = next_page;
+    bufMgr->readPage(file, page_number, page);
+  }
+  return model;
+}
+
+PageId LearnedModel::save(BufMgr* bufMgr, File* file) const {
+  const std::size_t per_page =
+      sizeof(ModelPage::segments) / sizeof(Segment);
+  // Pages are written last to first, so each knows the number of the next.
+  PageId next_page = Page::INVALID_NUMBER;
+  std::size_t end = segments_.size();
+  do {
+    const std::size_t first = (end - 1) / per_page * per_page;
+    PageId page_number;
+    Page* page;
+    bufMgr->allocPage(file, page_number, page);
+    ModelPage* saved = reinterpret_cast<ModelPage*>(page);
+    saved->next_page = next_page;
+    saved->num_segments = end - first;
+    saved->max_error = max_error_;
+    saved->max_key = max_key_;
+    saved->last_position = last_position_;
+    saved->total_segments = segments_.size();
+    std::memcpy(saved->segments, &segments_[first],
+                (end - first) * sizeof(Segment));
+    bufMgr->unPinPage(file, page_number, true);
+    next_page = page_number;
+    end = first;
+  } while (end > 0);
+  return next_page;
+}
+
+std::size_t LearnedModel::predict(const int key) const {
+  std::vector<Segment>::const_iterator next = std::upper_bound(
+      segments_.begin(), segments_.end(), key, segmentBefore);
+  const Segment& segment = next == segments_.begin() ? *next : *(next - 1);
+  const double position =
+      segment.position +
+      segment.slope * (static_cast<double>(key) - segment.first_key);
+  if (position <= 0) {
+    return 0;
+  }
+  if (position >= last_position_) {
+    return last_position_;
+  }
+  return static_cast<std::size_t>(position + 0.5);
+}
+
+}
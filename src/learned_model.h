@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+class File;
+
+/**
+ * @brief Piecewise linear model from INTEGER keys to positions in a sorted
+ * sequence.
+ *
+ * Each segment covers the keys from its first key up to the first key of the
+ * next segment and predicts a position on a line through its first point.
+ * Training places the segments greedily, each as long as a slope exists that
+ * keeps every training point within the error bound, so the position of a
+ * key the model was trained on is never further than maxError() from the
+ * prediction.  Keys it was not trained on get a prediction too, without that
+ * guarantee.
+ */
+class LearnedModel {
+ public:
+  /**
+   * Line through the first point of a segment.
+   */
+  struct Segment {
+    int first_key;
+    std::uint32_t position;
+    double slope;
+  };
+
+  /**
+   * Fits a model to the points.
+   *
+   * @param points       Pairs of key and position, with keys and positions
+   *                     strictly increasing.
+   * @param maxError     Largest distance allowed between the prediction and
+   *                     the position of a point.
+   * @param maxSegments  Largest number of segments allowed.
+   * @return  The model, owned by the caller, or NULL if more segments are
+   *          needed or there are no points.
+   */
+  static LearnedModel* train(
+      const std::vector<std::pair<int, std::uint32_t> >& points,
+      const int maxError, const std::size_t maxSegments);
+
+  /**
+   * Reads a model saved with save.
+   *
+   * @param bufMgr      Buffer manager to read the pages through.
+   * @param file        File the model was saved in.
+   * @param firstPage   First page of the model, as returned by save.
+   * @return  The model, owned by the caller.
+   */
+  static LearnedModel* load(BufMgr* bufMgr, File* file,
+                            const PageId firstPage);
+
+  /**
+   * Writes the model to new pages of a file, each pointing to the next.
+   *
+   * @param bufMgr  Buffer manager to allocate the pages through.
+   * @param file    File to save the model in.
+   * @return  Number of the first page.
+   */
+  PageId save(BufMgr* bufMgr, File* file) const;
+
+  /**
+   * Returns the predicted position of a key, between 0 and the position of
+   * the last point.
+   */
+  std::size_t predict(const int key) const;
+
+  /**
+   * Returns the smallest key the model was trained on.
+   */
+  int minKey() const { return segments_.front().first_key; }
+
+  /**
+   * Returns the largest key the model was trained on.
+   */
+  int maxKey() const { return max_key_; }
+
+  int maxError() const { return max_error_; }
+
+  std::size_t numSegments() const { return segments_.size(); }
+
+  /**
+   * Returns the memory taken by the segments in bytes.
+   */
+  std::size_t size() const { return segments_.size() * sizeof(Segment); }
+
+ private:
+  LearnedModel(const int maxError);
+
+  std::vector<Segment> segments_;
+  int max_error_;
+  int max_key_;
+  std::uint32_t last_position_;
+};
+
+}
@@ -0,0 +1,472 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <set>
+
+#include "file.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+/**
+ * Records are forced once this many bytes are waiting, commit or not.
+ */
+static const std::size_t MAX_BUFFERED_BYTES = 1 << 20;
+
+/**
+ * Unchanged bytes allowed inside one update record before it is split in two.
+ */
+static const std::size_t MAX_DIFF_GAP = 8;
+
+/**
+ * Atomic action of the calling thread, zero if none.
+ */
+static thread_local std::uint32_t current_action_id = 0;
+
+/**
+ * Nesting depth of beginAction calls of the calling thread.
+ */
+static thread_local int current_action_depth = 0;
+
+LogManager::LogManager(const std::string& name)
+    : name_(name),
+      fd_(-1),
+      next_lsn_(1),
+      flushed_lsn_(0),
+      requested_lsn_(0),
+      stop_(false),
+      sync_count_(0),
+      next_action_id_(1),
+      crash_countdown_(0) {
+  fd_ = ::open(name_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd_ < 0) {
+    throw FileNotFoundException(name_);
+  }
+  if (::lseek(fd_, 0, SEEK_END) > 0) {
+    recover();
+  }
+  writer_ = std::thread(&LogManager::writerLoop, this);
+}
+
+LogManager::~LogManager() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cond_.notify_one();
+  writer_.join();
+  ::close(fd_);
+}
+
+void LogManager::beginAction() {
+  if (current_action_depth++ == 0) {
+    current_action_id = next_action_id_++;
+  }
+}
+
+void LogManager::commitAction() {
+  if (current_action_depth == 0 || --current_action_depth > 0) {
+    return;
+  }
+  const Lsn lsn =
+      append(LOG_COMMIT, "", Page::INVALID_NUMBER, false, 0, NULL, NULL, 0);
+  current_action_id = 0;
+  flush(lsn);
+}
+
+Lsn LogManager::logPageUpdate(const File* file, const PageId page_number,
+                              const bool has_page_lsn, Page& shadow,
+                              const Page& page) {
+  std::size_t skip_begin = 0;
+  std::size_t skip_end = 0;
+  if (has_page_lsn) {
+    // The copy in memory may hold a stale next page number; the file keeps
+    // the one on disk current and never takes it from a buffered page.
+    skip_begin = offsetof(PageHeader, next_page_number);
+    skip_end = skip_begin + sizeof(PageId);
+  }
+  const Lsn lsn = logDiff(file->filename(), page_number, has_page_lsn,
+                          File::pagePosition(page_number),
+                          reinterpret_cast<const char*>(&shadow),
+                          reinterpret_cast<const char*>(&page), Page::SIZE,
+                          skip_begin, skip_end);
+  if (lsn != 0) {
+    shadow = page;
+  }
+  return lsn;
+}
+
+Lsn LogManager::logFileWrite(const std::string& filename,
+                             const PageId page_number,
+                             const bool has_page_lsn,
+                             const std::uint64_t offset, const char* before,
+                             const char* after, const std::size_t length) {
+  return logDiff(filename, page_number, has_page_lsn, offset, before, after,
+                 length, 0, 0);
+}
+
+void LogManager::logRemove(const std::string& filename) {
+  const std::uint32_t action_id = current_action_id;
+  // A removal cannot be rolled back, so it never belongs to an action.
+  current_action_id = 0;
+  const Lsn lsn = append(LOG_REMOVE, filename, Page::INVALID_NUMBER, false, 0,
+                         NULL, NULL, 0);
+  current_action_id = action_id;
+  flush(lsn);
+}
+
+void LogManager::flush(const Lsn lsn) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (lsn <= flushed_lsn_) {
+    return;
+  }
+  if (lsn > requested_lsn_) {
+    requested_lsn_ = lsn;
+    work_cond_.notify_one();
+  }
+  while (flushed_lsn_ < lsn) {
+    flushed_cond_.wait(lock);
+  }
+}
+
+Lsn LogManager::checkpointLsn() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Lsn lsn = next_lsn_;
+  for (std::map<std::uint32_t, Lsn>::const_iterator it =
+           active_actions_.begin();
+       it != active_actions_.end(); ++it) {
+    lsn = std::min(lsn, it->second);
+  }
+  return lsn;
+}
+
+void LogManager::logCheckpoint(const Lsn redo_lsn) {
+  flush(append(LOG_CHECKPOINT, "", Page::INVALID_NUMBER, false, redo_lsn,
+               NULL, NULL, 0));
+}
+
+void LogManager::flushAll() {
+  Lsn lsn;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lsn = next_lsn_ - 1;
+  }
+  flush(lsn);
+}
+
+Lsn LogManager::flushedLsn() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return flushed_lsn_;
+}
+
+void LogManager::writePoint() {
+  int left = crash_countdown_;
+  while (left > 0 && !crash_countdown_.compare_exchange_weak(left, left - 1)) {
+  }
+  if (left == 1) {
+    ::_exit(CRASH_EXIT_STATUS);
+  }
+}
+
+Lsn LogManager::append(const LogRecordType type, const std::string& filename,
+                       const PageId page_number, const bool has_page_lsn,
+                       const std::uint64_t offset, const char* before,
+                       const char* after, const std::size_t length) {
+  LogRecordHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.action_id = current_action_id;
+  header.type = type;
+  header.has_page_lsn = has_page_lsn;
+  header.name_length = filename.length();
+  header.page_number = page_number;
+  header.length = length;
+  header.offset = offset;
+
+  const std::size_t total = sizeof(header) + filename.length() + 2 * length;
+  std::vector<char> record(total);
+  std::memcpy(&record[0], &header, sizeof(header));
+  std::memcpy(&record[sizeof(header)], filename.data(), filename.length());
+  if (length > 0) {
+    std::memcpy(&record[sizeof(header) + filename.length()], before, length);
+    std::memcpy(&record[sizeof(header) + filename.length() + length], after,
+                length);
+  }
+  const std::uint32_t partial = checksum(&record[0], total);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  header.lsn = next_lsn_++;
+  if (header.action_id != 0) {
+    if (type == LOG_COMMIT) {
+      active_actions_.erase(header.action_id);
+    } else if (active_actions_.find(header.action_id) ==
+               active_actions_.end()) {
+      active_actions_[header.action_id] = header.lsn;
+    }
+  }
+  header.checksum = checksum(reinterpret_cast<const char*>(&header.lsn),
+                             sizeof(header.lsn), partial);
+  const std::size_t start = buffer_.size();
+  buffer_.insert(buffer_.end(), record.begin(), record.end());
+  std::memcpy(&buffer_[start + offsetof(LogRecordHeader, lsn)], &header.lsn,
+              sizeof(header.lsn));
+  std::memcpy(&buffer_[start + offsetof(LogRecordHeader, checksum)],
+              &header.checksum, sizeof(header.checksum));
+
+  if (buffer_.size() >= MAX_BUFFERED_BYTES) {
+    work_cond_.notify_one();
+  }
+  return header.lsn;
+}
+
+Lsn LogManager::logDiff(const std::string& filename, const PageId page_number,
+                        const bool has_page_lsn, const std::uint64_t offset,
+                        const char* before, const char* after,
+                        const std::size_t length,
+                        const std::size_t skip_begin,
+                        const std::size_t skip_end) {
+  Lsn lsn = 0;
+  std::size_t i = 0;
+  while (i < length) {
+    if ((i >= skip_begin && i < skip_end) || before[i] == after[i]) {
+      ++i;
+      continue;
+    }
+    // Extend the run over small gaps of equal bytes, but never into the
+    // skipped range.
+    std::size_t end = i + 1;
+    for (std::size_t j = end; j < length && !(j >= skip_begin && j < skip_end);
+         ++j) {
+      if (before[j] != after[j]) {
+        end = j + 1;
+      } else if (j - end >= MAX_DIFF_GAP) {
+        break;
+      }
+    }
+    lsn = append(LOG_UPDATE, filename, page_number, has_page_lsn, offset + i,
+                 before + i, after + i, end - i);
+    i = end;
+  }
+  return lsn;
+}
+
+void LogManager::writerLoop() {
+  std::vector<char> batch;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    while (!stop_ && requested_lsn_ <= flushed_lsn_ &&
+           buffer_.size() < MAX_BUFFERED_BYTES) {
+      work_cond_.wait(lock);
+    }
+    if (buffer_.empty()) {
+      if (stop_) {
+        return;
+      }
+      continue;
+    }
+    // Everything appended up to now goes out in this batch; appends made
+    // while it is written collect for the next one.
+    batch.swap(buffer_);
+    const Lsn last = next_lsn_ - 1;
+    lock.unlock();
+    writeOut(batch);
+    batch.clear();
+    lock.lock();
+    flushed_lsn_ = last;
+    flushed_cond_.notify_all();
+  }
+}
+
+void LogManager::writeOut(const std::vector<char>& records) {
+  std::size_t length = records.size();
+  if (crash_countdown_ == 1) {
+    // Injected crash in the middle of a log write.
+    length /= 2;
+  }
+  writePoint();
+
+  std::size_t written = 0;
+  while (written < length) {
+    const ssize_t n = ::write(fd_, &records[written], length - written);
+    if (n <= 0) {
+      break;
+    }
+    written += n;
+  }
+  if (length < records.size()) {
+    ::_exit(CRASH_EXIT_STATUS);
+  }
+  ::fdatasync(fd_);
+  ++sync_count_;
+}
+
+std::uint32_t LogManager::checksum(const char* data, const std::size_t length,
+                                   std::uint32_t hash) {
+  // FNV-1a
+  for (std::size_t i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+std::uint32_t LogManager::recordChecksum(char* record,
+                                         const std::size_t length) {
+  Lsn lsn;
+  std::memcpy(&lsn, record + offsetof(LogRecordHeader, lsn), sizeof(lsn));
+  std::memset(record + offsetof(LogRecordHeader, lsn), 0, sizeof(lsn));
+  std::memset(record + offsetof(LogRecordHeader, checksum), 0,
+              sizeof(std::uint32_t));
+  const std::uint32_t hash = checksum(
+      reinterpret_cast<const char*>(&lsn), sizeof(lsn), checksum(record, length));
+  std::memcpy(record + offsetof(LogRecordHeader, lsn), &lsn, sizeof(lsn));
+  return hash;
+}
+
+void LogManager::recover() {
+  // Read the whole log; it is truncated after every recovery.
+  const off_t log_size = ::lseek(fd_, 0, SEEK_END);
+  std::vector<char> log(log_size);
+  std::size_t read_bytes = 0;
+  while (read_bytes < log.size()) {
+    const ssize_t n = ::pread(fd_, &log[read_bytes], log.size() - read_bytes,
+                              read_bytes);
+    if (n <= 0) {
+      break;
+    }
+    read_bytes += n;
+  }
+
+  // Analysis: find the valid prefix of the log, committed actions and
+  // removed files.  The log ends at the first torn or corrupt record.
+  std::vector<std::size_t> records;
+  std::set<std::uint32_t> committed;
+  std::map<std::string, Lsn> removed;
+  Lsn max_lsn = 0;
+  Lsn redo_lsn = 0;
+  std::size_t pos = 0;
+  while (pos + sizeof(LogRecordHeader) <= read_bytes) {
+    LogRecordHeader header;
+    std::memcpy(&header, &log[pos], sizeof(header));
+    const std::size_t total =
+        sizeof(header) + header.name_length + 2 * std::size_t(header.length);
+    if (pos + total > read_bytes || header.lsn <= max_lsn) {
+      break;
+    }
+    if (recordChecksum(&log[pos], total) != header.checksum) {
+      break;
+    }
+    const std::string filename(&log[pos + sizeof(header)], header.name_length);
+    if (header.type == LOG_COMMIT) {
+      committed.insert(header.action_id);
+    } else if (header.type == LOG_REMOVE) {
+      removed[filename] = header.lsn;
+    } else if (header.type == LOG_CHECKPOINT) {
+      redo_lsn = header.offset;
+    }
+    records.push_back(pos);
+    max_lsn = header.lsn;
+    pos += total;
+  }
+
+  std::map<std::string, std::fstream*> files;
+  std::map<std::pair<std::string, PageId>, Lsn> page_lsns;
+
+  // Redo: repeat history for every logged change since the last checkpoint.
+  // Pages with a page LSN on disk skip the changes they already hold.
+  for (std::size_t r = 0; r < records.size(); ++r) {
+    LogRecordHeader header;
+    std::memcpy(&header, &log[records[r]], sizeof(header));
+    if (header.type != LOG_UPDATE || header.lsn < redo_lsn) {
+      continue;
+    }
+    const char* name = &log[records[r] + sizeof(header)];
+    const std::string filename(name, header.name_length);
+    if ((removed.count(filename) && removed[filename] > header.lsn) ||
+        !File::exists(filename)) {
+      continue;
+    }
+    if (files.find(filename) == files.end()) {
+      files[filename] = new std::fstream(
+          filename.c_str(),
+          std::fstream::in | std::fstream::out | std::fstream::binary);
+    }
+    std::fstream* stream = files[filename];
+
+    if (header.has_page_lsn) {
+      const std::pair<std::string, PageId> key(filename, header.page_number);
+      if (page_lsns.find(key) == page_lsns.end()) {
+        Lsn disk_lsn = 0;
+        stream->seekg(File::pagePosition(header.page_number) +
+                      std::streamoff(offsetof(PageHeader, page_lsn)));
+        stream->read(reinterpret_cast<char*>(&disk_lsn), sizeof(disk_lsn));
+        if (!*stream) {
+          disk_lsn = 0;
+          stream->clear();
+        }
+        page_lsns[key] = disk_lsn;
+      }
+      if (header.lsn <= page_lsns[key]) {
+        continue;
+      }
+    }
+    const char* after = name + header.name_length + header.length;
+    stream->seekp(header.offset);
+    stream->write(after, header.length);
+  }
+
+  // Undo: roll back actions without a commit record, newest change first.
+  for (std::size_t r = records.size(); r-- > 0;) {
+    LogRecordHeader header;
+    std::memcpy(&header, &log[records[r]], sizeof(header));
+    if (header.type != LOG_UPDATE || header.action_id == 0 ||
+        committed.count(header.action_id)) {
+      continue;
+    }
+    const char* name = &log[records[r] + sizeof(header)];
+    const std::string filename(name, header.name_length);
+    if (files.find(filename) == files.end()) {
+      continue;
+    }
+    const char* before = name + header.name_length;
+    files[filename]->seekp(header.offset);
+    files[filename]->write(before, header.length);
+  }
+
+  // Make the recovered files durable before the log is thrown away.
+  for (std::map<std::string, std::fstream*>::iterator it = files.begin();
+       it != files.end(); ++it) {
+    it->second->close();
+    delete it->second;
+    const int fd = ::open(it->first.c_str(), O_RDWR);
+    if (fd >= 0) {
+      ::fsync(fd);
+      ::close(fd);
+    }
+  }
+
+  if (::ftruncate(fd_, 0) != 0) {
+    return;
+  }
+  next_lsn_ = max_lsn + 1;
+  append(LOG_CHECKPOINT, "", Page::INVALID_NUMBER, false, next_lsn_, NULL,
+         NULL, 0);
+  writeOut(buffer_);
+  buffer_.clear();
+  flushed_lsn_ = next_lsn_ - 1;
+  requested_lsn_ = flushed_lsn_;
+}
+
+}
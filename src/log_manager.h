@@ -0,0 +1,387 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+
+namespace badgerdb {
+
+class File;
+
+/**
+ * @brief Types of records in the write-ahead log.
+ */
+enum LogRecordType {
+  /**
+   * Byte range of a file changed from a before image to an after image.
+   */
+  LOG_UPDATE = 1,
+
+  /**
+   * Atomic action committed.
+   */
+  LOG_COMMIT = 2,
+
+  /**
+   * File was removed; older records for it must not be replayed.
+   */
+  LOG_REMOVE = 3,
+
+  /**
+   * Checkpoint; its offset field holds the LSN redo starts from.  Written
+   * after every change older than that LSN is on disk, and when the log is
+   * truncated after recovery.
+   */
+  LOG_CHECKPOINT = 4
+};
+
+/**
+ * @brief Fixed-size part of every log record.  The record continues with
+ * the file name and, for updates, the before and after images.
+ */
+struct LogRecordHeader {
+  /**
+   * LSN of this record.
+   */
+  Lsn lsn;
+
+  /**
+   * Atomic action the record belongs to.  Zero for changes made outside an
+   * action, which count as committed as soon as they are logged.
+   */
+  std::uint32_t action_id;
+
+  /**
+   * LogRecordType of the record.
+   */
+  std::uint16_t type;
+
+  /**
+   * True if the page has a PageHeader holding a page LSN on disk.
+   */
+  std::uint16_t has_page_lsn;
+
+  /**
+   * Checksum over the whole record, computed with this field and the LSN set
+   * to zero and then continued over the LSN.
+   */
+  std::uint32_t checksum;
+
+  /**
+   * Length of the file name following the header.
+   */
+  std::uint32_t name_length;
+
+  /**
+   * Page the change belongs to, Page::INVALID_NUMBER for the file header.
+   */
+  PageId page_number;
+
+  /**
+   * Length of each of the before and after images.
+   */
+  std::uint32_t length;
+
+  /**
+   * Byte offset of the change from the beginning of the file.
+   */
+  std::uint64_t offset;
+};
+
+/**
+ * @brief Write-ahead log for files managed through BufMgr.
+ *
+ * Changes are logged physically as byte ranges of a file together with their
+ * before and after images.  The buffer manager logs the bytes of a page that
+ * changed while it was pinned when the page is unpinned dirty, and files log
+ * the writes they make on their own (page allocation and deletion, file
+ * header updates, direct page writes).  A record is forced to disk before any
+ * data it describes is written (the WAL rule).
+ *
+ * Records are appended to an in-memory buffer and written out by a dedicated
+ * writer thread (group commit).  A caller that needs its records durable
+ * waits for the flushed LSN to reach them; while the writer syncs one batch
+ * the next one collects, so concurrent commits share a single sync.
+ *
+ * Changes can be grouped into atomic actions, one per thread at a time.
+ * After a crash, recover() replays every logged change in LSN order (redo)
+ * and then rolls back the changes of actions that never committed (undo), in
+ * the spirit of ARIES.
+ *
+ * Appending and committing are threadsafe.
+ */
+class LogManager {
+ public:
+  /**
+   * Exit status of a process stopped by an injected crash.
+   */
+  static const int CRASH_EXIT_STATUS = 86;
+
+  /**
+   * Opens the log with the given name, creating it if it does not exist, and
+   * starts the writer thread.  If the log holds records from a previous run,
+   * recovery is run first.
+   *
+   * @param name  Name of the log file.
+   */
+  LogManager(const std::string& name);
+
+  /**
+   * Stops the writer thread once the remaining records are durable and closes
+   * the log.
+   */
+  ~LogManager();
+
+  /**
+   * Starts an atomic action of the calling thread.  Actions may be nested;
+   * only the outermost one commits.
+   */
+  void beginAction();
+
+  /**
+   * Commits the current atomic action of the calling thread and waits until
+   * its commit record is durable.
+   */
+  void commitAction();
+
+  /**
+   * Logs the bytes of a page that differ from its shadow copy and brings the
+   * shadow copy up to date.
+   *
+   * @param file          File the page belongs to.
+   * @param page_number   Number of the page in the file.
+   * @param has_page_lsn  True if the page has a PageHeader on disk, in which
+   *                      case its next page number is left out because the
+   *                      file keeps the copy on disk current.
+   * @param shadow        Copy of the page as of the last logged change.
+   * @param page          Current contents of the page.
+   * @return  LSN of the last record written, zero if nothing changed.
+   */
+  Lsn logPageUpdate(const File* file, const PageId page_number,
+                    const bool has_page_lsn, Page& shadow, const Page& page);
+
+  /**
+   * Logs a write a file is about to make.
+   *
+   * @param filename      Name of the file.
+   * @param page_number   Page being written, Page::INVALID_NUMBER for the header.
+   * @param has_page_lsn  True if the page has a PageHeader on disk.
+   * @param offset        Byte offset of the write in the file.
+   * @param before        Bytes currently on disk.
+   * @param after         Bytes about to be written.
+   * @param length        Number of bytes.
+   * @return  LSN of the last record written, zero if nothing changed.
+   */
+  Lsn logFileWrite(const std::string& filename, const PageId page_number,
+                   const bool has_page_lsn, const std::uint64_t offset,
+                   const char* before, const char* after,
+                   const std::size_t length);
+
+  /**
+   * Logs the removal of a file and forces the log.
+   *
+   * @param filename  Name of the removed file.
+   */
+  void logRemove(const std::string& filename);
+
+  /**
+   * Wakes the writer thread and waits until every record up to the given LSN
+   * is durable.
+   *
+   * @param lsn   LSN that must be on disk when this returns.
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Makes every record appended so far durable.
+   */
+  void flushAll();
+
+  /**
+   * Returns the LSN of the last record made durable.
+   */
+  Lsn flushedLsn();
+
+  /**
+   * Returns the LSN a checkpoint started now can let redo begin at: the next
+   * LSN, or the first LSN of the oldest action still running if that is
+   * older, since undo needs all of its records.
+   */
+  Lsn checkpointLsn();
+
+  /**
+   * Logs a completed checkpoint and forces the log.  The caller must have
+   * made every change logged before redo_lsn durable.
+   *
+   * @param redo_lsn  LSN returned by checkpointLsn when the checkpoint began.
+   */
+  void logCheckpoint(const Lsn redo_lsn);
+
+  /**
+   * Returns the number of times the writer thread has synced the log.
+   */
+  std::uint64_t syncCount() const { return sync_count_; }
+
+  /**
+   * Fault injection: the process exits without cleanup right before the
+   * given number of further log or data writes is reached.  A crash during a
+   * log write leaves a torn record behind.
+   *
+   * @param writes  Number of writes to let through, zero to disable.
+   */
+  void setCrashPoint(const int writes) { crash_countdown_ = writes; }
+
+  /**
+   * Called before every write to a logged file; counts down to the crash
+   * point, if one is set.
+   */
+  void writePoint();
+
+ private:
+  /**
+   * Appends a record to the in-memory log buffer.  The record is built and
+   * most of its checksum computed before the buffer is locked; only the LSN
+   * is assigned under the lock.
+   *
+   * @return  LSN assigned to the record.
+   */
+  Lsn append(const LogRecordType type, const std::string& filename,
+             const PageId page_number, const bool has_page_lsn,
+             const std::uint64_t offset, const char* before,
+             const char* after, const std::size_t length);
+
+  /**
+   * Logs every run of differing bytes between two images.
+   *
+   * @param skip_begin  Offset of a byte range to leave out of the records.
+   * @param skip_end    End of that range, equal to skip_begin if none.
+   * @return  LSN of the last record written, zero if the images are equal.
+   */
+  Lsn logDiff(const std::string& filename, const PageId page_number,
+              const bool has_page_lsn, const std::uint64_t offset,
+              const char* before, const char* after,
+              const std::size_t length, const std::size_t skip_begin,
+              const std::size_t skip_end);
+
+  /**
+   * Replays the log after a crash: redo of all logged changes followed by
+   * undo of the changes of uncommitted actions.  Truncates the log afterwards.
+   * Runs in the constructor, before the writer thread starts.
+   */
+  void recover();
+
+  /**
+   * Body of the writer thread: takes whatever is in the buffer once a flush
+   * is requested, writes and syncs it, and wakes the waiting callers.
+   */
+  void writerLoop();
+
+  /**
+   * Writes a batch of records to the log file and syncs it.
+   */
+  void writeOut(const std::vector<char>& records);
+
+  /**
+   * FNV-1a checksum of a record, continuing from the given hash.
+   */
+  static std::uint32_t checksum(const char* data, const std::size_t length,
+                                const std::uint32_t hash = 2166136261u);
+
+  /**
+   * Checksum of a complete record with its LSN filled in.
+   */
+  static std::uint32_t recordChecksum(char* record, const std::size_t length);
+
+  /**
+   * Name of the log file.
+   */
+  std::string name_;
+
+  /**
+   * Descriptor of the open log file.
+   */
+  int fd_;
+
+  /**
+   * Protects the buffer and the LSN counters below.
+   */
+  std::mutex mutex_;
+
+  /**
+   * Signalled when the writer thread has work.
+   */
+  std::condition_variable work_cond_;
+
+  /**
+   * Signalled when the flushed LSN advances.
+   */
+  std::condition_variable flushed_cond_;
+
+  /**
+   * Records not yet handed to the writer thread.
+   */
+  std::vector<char> buffer_;
+
+  /**
+   * LSN the next record gets.
+   */
+  Lsn next_lsn_;
+
+  /**
+   * LSN of the last record in the log file.
+   */
+  Lsn flushed_lsn_;
+
+  /**
+   * Highest LSN a caller is waiting for.
+   */
+  Lsn requested_lsn_;
+
+  /**
+   * First LSN of every action that has logged changes but not committed.
+   */
+  std::map<std::uint32_t, Lsn> active_actions_;
+
+  /**
+   * Set to make the writer thread exit once the buffer is empty.
+   */
+  bool stop_;
+
+  /**
+   * Number of syncs of the log file.
+   */
+  std::atomic<std::uint64_t> sync_count_;
+
+  /**
+   * Id to hand out to the next atomic action.
+   */
+  std::atomic<std::uint32_t> next_action_id_;
+
+  /**
+   * Writes left before the injected crash, zero if none is set.
+   */
+  std::atomic<int> crash_countdown_;
+
+  /**
+   * The writer thread.
+   */
+  std::thread writer_;
+};
+
+}
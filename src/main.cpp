@@ -6,11 +6,30 @@
  */
 
 #include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <thread>
+#include <climits>
 #include "btree.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
 #include "file_iterator.h"
+#include "log_manager.h"
+#include "sort.h"
+#include "join.h"
+#include "heap_fetch.h"
+#include "composite_index.h"
+#include "hash_index.h"
+#include "partitioned_index.h"
+#include "compressed_index.h"
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
@@ -20,6 +39,7 @@
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/bad_index_info_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -44,6 +64,8 @@ using namespace badgerdb;
 //If the relation size is changed then the second parameter 2 chechPassFail may need to be changed to number of record that are expected to be found during the scan, else tests will erroneously be reported to have failed.
  int	relationSize = 5000;
 std::string intIndexName, doubleIndexName, stringIndexName;
+//createRelationForward stores the tuples in PAX pages if set
+bool paxRelation = false;
 
 // This is the structure for tuples in the base relation
 
@@ -53,6 +75,15 @@ typedef struct tuple {
 	char s[64];
 } RECORD;
 
+// Tuples of the relation used by the write-ahead log tests. Tag 0 is the single counter
+// tuple holding the number of data tuples, tag 1 a data tuple.
+
+typedef struct walTuple {
+	int tag;
+	int value;
+	char s[120];
+} WALRECORD;
+
 PageFile* file1;
 RecordId rid;
 RECORD record1;
@@ -70,6 +101,7 @@ void createRelationRandom();
 void createRelationNegative();
 void intTests();
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int intCount(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
 void indexTests();
 void test1();
 void test2();
@@ -80,6 +112,55 @@ void smallBufferTest();
 void bigRelation();
 void equalityTest();
 void testNegativeKey();
+void batchInsertTest();
+void appendLoadTest();
+void walRecoveryTest();
+void walWorkload(const std::string &name, const std::string &logName, int crashPoint, bool background);
+int walVerify(const std::string &name);
+void walSplitWorkload(const std::string &relation, const std::string &logName, int crashPoint, int key);
+int walSplitVerify(const std::string &relation, int key);
+void groupCommitBenchmark();
+void backgroundWriterTest();
+void recordViewScanTest();
+void pageMutationBenchmark();
+void pageChurnBenchmark();
+void pageFuzzTest();
+void paxLayoutTest();
+void paxFormat(Page &page);
+double paxScanRun(long long &sum);
+void vectorScanBenchmark();
+double filterRun(bool batch, Datatype type, int high, int &count);
+void parallelScanBenchmark();
+void parallelIndexBuildTest();
+void externalSortTest();
+double sortRun(int frames, Datatype type, int &runs, int &passes, int &count, bool &sorted);
+void joinTest();
+void createKeyRelation(const std::string &name, const std::vector<int> &keys,
+                       const std::vector<double> &doubles = std::vector<double>());
+std::size_t probeJoin(const std::string &outerName, const std::string &innerName, BTreeIndex *index);
+void heapFetchBenchmark();
+void coveringIndexBenchmark();
+void compositeIndexBenchmark();
+void lookupBenchmark();
+void bloomFilterBenchmark();
+void learnedIndexBenchmark();
+void hashIndexBenchmark();
+void partitionedIndexBenchmark();
+void compressedIndexBenchmark();
+void packedRidBenchmark();
+int openTlbCounter();
+long anonHugePagesKb();
+void hugePageBenchmark();
+bool compareRids(const RecordId &a, const RecordId &b);
+bool compareRidOrder(const RecordId &a, const RecordId &b);
+bool compareEntryKeys(const std::pair<int, RecordId> &a, const std::pair<int, RecordId> &b);
+double pageInsertRun(bool raw, int records);
+double pageUpdateRun(bool raw, int updates);
+double scanRun(bool view, long long &sum);
+int backgroundWriterRun(PageFile *file, int numPages, bool background, std::vector<int> &values);
+void sharedPoolWorker(BufMgr *mgr, PageFile *file, int numPages, int threads, int worker, int ops, int *updates);
+void groupCommitWriter(LogManager *log, int commits, double *latency);
+double batchInsertRun(const std::vector<RecordId> &rids, bool sequential, bool batch);
 
 int main(int argc, char **argv)
 {
@@ -148,6 +229,32 @@ int main(int argc, char **argv)
 	bigRelation();
 	equalityTest();
 	testNegativeKey();
+	batchInsertTest();
+	appendLoadTest();
+	walRecoveryTest();
+	groupCommitBenchmark();
+	backgroundWriterTest();
+	recordViewScanTest();
+	pageMutationBenchmark();
+	pageChurnBenchmark();
+	pageFuzzTest();
+	paxLayoutTest();
+	vectorScanBenchmark();
+	parallelScanBenchmark();
+	parallelIndexBuildTest();
+	externalSortTest();
+	joinTest();
+	heapFetchBenchmark();
+	coveringIndexBenchmark();
+	compositeIndexBenchmark();
+	lookupBenchmark();
+	bloomFilterBenchmark();
+	learnedIndexBenchmark();
+	hashIndexBenchmark();
+	partitionedIndexBenchmark();
+	compressedIndexBenchmark();
+	packedRidBenchmark();
+	hugePageBenchmark();
 	
 	delete bufMgr;
 
@@ -244,6 +351,2589 @@ void testNegativeKey(){
   std::cout<<"negative key test passed\n"<<std::flush;
 
 }
+void batchInsertTest(){
+  //compare insertBatch with one insertEntry per key on top of an existing index
+  relationName = "batchRelation";
+  std::cout << "--------------------" << std::endl;
+  std::cout << "createRelationForward with batch inserts" << std::endl;
+  createRelationForward();
+
+  //borrow real rids so intScan can fetch the records
+  std::vector<RecordId> rids;
+  {
+    FileScan fscan(relationName, bufMgr);
+    try{
+      RecordId scanRid;
+      while(1){
+        fscan.scanNext(scanRid);
+        rids.push_back(scanRid);
+      }
+    }catch(const EndOfFileException &e){
+    }
+  }
+
+  double seqEntry = batchInsertRun(rids, true, false);
+  double seqBatch = batchInsertRun(rids, true, true);
+  double rndEntry = batchInsertRun(rids, false, false);
+  double rndBatch = batchInsertRun(rids, false, true);
+  std::cout << "sequential keys/s insertEntry: " << seqEntry << " insertBatch: " << seqBatch << std::endl;
+  std::cout << "random keys/s insertEntry: " << rndEntry << " insertBatch: " << rndBatch << std::endl;
+
+  deleteRelation();
+  relationName = "relA";
+  std::cout<<"batch insert test passed\n"<<std::flush;
+}
+
+double batchInsertRun(const std::vector<RecordId> &rids, bool sequential, bool batch){
+  //insert keys relationSize..5*relationSize and return the insert rate in keys/s
+  std::vector<std::pair<int, RecordId> > entries;
+  for(int i = 0; i < 4 * relationSize; i++){
+    entries.push_back(std::make_pair(relationSize + i, rids[i % rids.size()]));
+  }
+  if(!sequential) std::random_shuffle(entries.begin(), entries.end());
+
+  double rate;
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(batch){
+      index.insertBatch(entries);
+    }else{
+      for(size_t i = 0; i < entries.size(); i++){
+        index.insertEntry(&entries[i].first, entries[i].second);
+      }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    rate = entries.size() / elapsed.count();
+
+    checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+    checkPassFail(intScan(&index,relationSize,GTE,5*relationSize,LT), 4*relationSize)
+    checkPassFail(intScan(&index,2*relationSize-5,GT,2*relationSize+5,LTE), 10)
+  }
+  try{
+    File::remove(intIndexName);
+  }catch(const FileNotFoundException &e){
+  }
+  return rate;
+}
+
+void appendLoadTest(){
+  //sequential load should take the rightmost append path and produce packed leaves
+  relationSize = 100000;
+  relationName = "appendRelation";
+  std::cout << "--------------------" << std::endl;
+  std::cout << "createRelationForward with sequential index load" << std::endl;
+  createRelationForward();
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "index load time (s): " << elapsed.count() << std::endl;
+
+    checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+    checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+    checkPassFail(intScan(&index,relationSize-10,GTE,relationSize,LT), 10)
+  }
+  std::ifstream indexFile(intIndexName.c_str(), std::ios::binary | std::ios::ate);
+  std::cout << "index size (bytes): " << indexFile.tellg() << std::endl;
+  indexFile.close();
+  File::remove(intIndexName);
+
+  {
+    //random keys after the load go through the regular path, appends afterwards still work
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    std::vector<int> keys;
+    for(int i = 0; i < relationSize; i += 7) keys.push_back(i);
+    std::random_shuffle(keys.begin(), keys.end());
+    RecordId dummy = {1, 1, 0};
+    for(size_t i = 0; i < keys.size(); i++) index.insertEntry(&keys[i], dummy);
+    for(int i = relationSize; i < relationSize + 1000; i++) index.insertEntry(&i, dummy);
+    checkPassFail(intCount(&index,0,GTE,relationSize,LT), relationSize + (int)keys.size())
+    checkPassFail(intCount(&index,relationSize,GTE,relationSize+1000,LT), 1000)
+    checkPassFail(intCount(&index,relationSize-1,GTE,relationSize+1,LT), 2)
+  }
+  File::remove(intIndexName);
+  deleteRelation();
+  relationSize = 5000;
+  relationName = "relA";
+  std::cout<<"append load test passed\n"<<std::flush;
+}
+
+void walRecoveryTest(){
+  //kill a logged workload at random write points and check that recovery leaves it consistent
+  std::string walRelation = "walRelation";
+  std::string walLog = "walRelation.log";
+  std::cout << "--------------------" << std::endl;
+  std::cout << "write-ahead log recovery with injected crashes" << std::endl;
+  int badTrials = 0;
+  for(int trial = 0; trial < 25; trial++){
+    std::remove(walRelation.c_str());
+    std::remove(walLog.c_str());
+    int crashPoint = 1 + random() % 400;
+    //every other trial runs with the background writer taking checkpoints
+    bool background = trial % 2 == 1;
+
+    std::cout << std::flush;
+    pid_t pid = fork();
+    if(pid == 0){
+      walWorkload(walRelation, walLog, crashPoint, background);
+      _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    bool crashed = WIFEXITED(status) && WEXITSTATUS(status) == LogManager::CRASH_EXIT_STATUS;
+
+    //opening the log runs recovery
+    {
+      LogManager log(walLog);
+    }
+    int committed = walVerify(walRelation);
+    if(committed < 0) badTrials++;
+    std::cout << "crash point " << crashPoint << (crashed ? "" : " not reached")
+              << (background ? " with background writer" : "")
+              << ", tuples after recovery: " << committed << std::endl;
+  }
+  std::remove(walRelation.c_str());
+  std::remove(walLog.c_str());
+  checkPassFail(badTrials, 0)
+
+  //an index whose leaves and root are all full, so one insert splits a leaf and the root
+  std::string splitRelation = "walSplitRelation";
+  std::string splitIndexName;
+  std::string savedIndexName;
+  createKeyRelation(splitRelation, std::vector<int>());
+  {
+    BTreeIndex index(splitRelation, splitIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    std::vector<std::pair<int, RecordId> > entries;
+    for(int i = 0; i < (INTARRAYNONLEAFSIZE + 1) * INTARRAYLEAFSIZE; i++){
+      RecordId rid = {(PageId)(2 * i + 1), 1, 0};
+      entries.push_back(std::make_pair(2 * i, rid));
+    }
+    index.loadSorted(entries);
+    TreeStats stats = index.getTreeStats();
+    checkPassFail(stats.nonLeafPages, (std::size_t)1)
+    checkPassFail(stats.leafPages, (std::size_t)(INTARRAYNONLEAFSIZE + 1))
+  }
+  savedIndexName = splitIndexName + ".saved";
+  std::rename(splitIndexName.c_str(), savedIndexName.c_str());
+
+  //kill the splitting insert at each of its writes in turn, and once more after its last one
+  int splitKey = (INTARRAYNONLEAFSIZE + 1) * INTARRAYLEAFSIZE + 1;
+  int badSplits = 0;
+  bool crashed = true;
+  int crashPoint;
+  for(crashPoint = 1; crashed && crashPoint < 200; crashPoint++){
+    std::remove(walLog.c_str());
+    {
+      std::ifstream saved(savedIndexName.c_str(), std::ios::binary);
+      std::ofstream copy(splitIndexName.c_str(), std::ios::binary | std::ios::trunc);
+      copy << saved.rdbuf();
+    }
+
+    std::cout << std::flush;
+    pid_t pid = fork();
+    if(pid == 0){
+      walSplitWorkload(splitRelation, walLog, crashPoint, splitKey);
+      _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    crashed = WIFEXITED(status) && WEXITSTATUS(status) == LogManager::CRASH_EXIT_STATUS;
+    if(!crashed && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) badSplits++;
+
+    {
+      LogManager log(walLog);
+    }
+    int entries = walSplitVerify(splitRelation, splitKey);
+    //an insert that finished has to be there
+    if(entries < 0 || (!crashed && entries != (INTARRAYNONLEAFSIZE + 1) * INTARRAYLEAFSIZE + 1)) badSplits++;
+  }
+  std::cout << "root split killed at " << crashPoint - 2 << " write points, entries checked by a full scan after each" << std::endl;
+  checkPassFail(crashed, false)
+  checkPassFail(badSplits, 0)
+  File::remove(splitIndexName);
+  std::remove(savedIndexName.c_str());
+  File::remove(splitRelation);
+  std::remove(walLog.c_str());
+  std::cout<<"write-ahead log recovery test passed\n"<<std::flush;
+}
+
+void walWorkload(const std::string &name, const std::string &logName, int crashPoint, bool background){
+  //each action inserts a data tuple and bumps the counter tuple on another page
+  LogManager log(logName);
+  log.setCrashPoint(crashPoint);
+  BufMgr mgr(3, &log);
+  PageFile *file = new PageFile(name, true);
+  if(background) mgr.startWriter(1, 2);
+
+  WALRECORD rec;
+  memset(&rec, ' ', sizeof(rec));
+  rec.tag = 0;
+  rec.value = 0;
+  Page *page;
+  PageId counterPageNo;
+  mgr.beginAction();
+  mgr.allocPage(file, counterPageNo, page);
+  RecordId counterRid = page->insertRecord(std::string(reinterpret_cast<char*>(&rec), sizeof(rec)));
+  mgr.unPinPage(file, counterPageNo, true);
+  mgr.commitAction();
+
+  PageId dataPageNo = counterPageNo;
+  for(int i = 0; i < 300; i++){
+    mgr.beginAction();
+    rec.tag = 1;
+    rec.value = i;
+    std::string data(reinterpret_cast<char*>(&rec), sizeof(rec));
+    mgr.readPage(file, dataPageNo, page);
+    try{
+      page->insertRecord(data);
+      mgr.unPinPage(file, dataPageNo, true);
+    }catch(const InsufficientSpaceException &e){
+      mgr.unPinPage(file, dataPageNo, false);
+      mgr.allocPage(file, dataPageNo, page);
+      page->insertRecord(data);
+      mgr.unPinPage(file, dataPageNo, true);
+    }
+
+    rec.tag = 0;
+    rec.value = i + 1;
+    mgr.readPage(file, counterPageNo, page);
+    page->updateRecord(counterRid, std::string(reinterpret_cast<char*>(&rec), sizeof(rec)));
+    mgr.unPinPage(file, counterPageNo, true);
+    mgr.commitAction();
+  }
+  mgr.stopWriter();
+  mgr.flushFile(file);
+  delete file;
+}
+
+void walSplitWorkload(const std::string &relation, const std::string &logName, int crashPoint, int key){
+  //a single logged insert, through a pool small enough that pages of the split are written before it commits
+  LogManager log(logName);
+  BufMgr mgr(6, &log);
+  std::string indexName;
+  BTreeIndex index(relation, indexName, &mgr, offsetof(tuple,i), INTEGER);
+  log.setCrashPoint(crashPoint);
+  RecordId rid = {(PageId)(key + 1), 1, 0};
+  index.insertEntry(&key, rid);
+  index.close();
+}
+
+int walSplitVerify(const std::string &relation, int key){
+  //returns the number of entries if a full scan finds every loaded even key in order, and the
+  //inserted key at most once, -1 otherwise
+  BufMgr mgr(100);
+  std::string indexName;
+  BTreeIndex index(relation, indexName, &mgr, offsetof(tuple,i), INTEGER);
+  int low = 0;
+  int high = INT_MAX - 1;
+  index.startScan(&low, GTE, &high, LTE);
+  int entries = 0;
+  int evenKeys = 0;
+  int prevKey = -1;
+  try{
+    while(1){
+      RecordId rid;
+      index.scanNext(rid);
+      int scanned = (int)rid.page_number - 1;
+      if(scanned <= prevKey || (scanned % 2 == 1 && scanned != key)) return -1;
+      if(scanned % 2 == 0){
+        if(scanned != 2 * evenKeys) return -1;
+        evenKeys++;
+      }
+      prevKey = scanned;
+      entries++;
+    }
+  }catch(const IndexScanCompletedException &e){
+  }
+  index.endScan();
+  if(evenKeys != (INTARRAYNONLEAFSIZE + 1) * INTARRAYLEAFSIZE) return -1;
+
+  //the scan walks the leaf chain, the root the meta page names has to reach every leaf as well
+  bool split = entries > evenKeys;
+  TreeStats stats = index.getTreeStats();
+  if(stats.height != (split ? 3 : 2) || stats.leafPages < (std::size_t)(INTARRAYNONLEAFSIZE + 1 + split)) return -1;
+  return entries;
+}
+
+void groupCommitBenchmark(){
+  //concurrent writers commit small actions; commits waiting on the same sync share it
+  std::string groupLog = "groupCommit.log";
+  std::cout << "--------------------" << std::endl;
+  std::cout << "group commit with 1 to 64 writer threads" << std::endl;
+  const int totalCommits = 2048;
+  int maxThreads = 64;
+  for(int threads = 1; threads <= maxThreads; threads *= 2){
+    std::remove(groupLog.c_str());
+    LogManager log(groupLog);
+    std::vector<std::thread> writers;
+    std::vector<double> latency(threads);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int t = 0; t < threads; t++){
+      writers.push_back(std::thread(groupCommitWriter, &log, totalCommits / threads, &latency[t]));
+    }
+    for(int t = 0; t < threads; t++){
+      writers[t].join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double meanLatency = 0;
+    for(int t = 0; t < threads; t++){
+      meanLatency += latency[t] / threads;
+    }
+    std::cout << threads << " writers: " << (int)(totalCommits / seconds) << " commits/s, "
+              << meanLatency * 1e6 << " us mean commit latency, "
+              << log.syncCount() << " syncs for " << totalCommits << " commits" << std::endl;
+    checkPassFail((log.flushedLsn() >= (Lsn)totalCommits * 2), true)
+  }
+  std::remove(groupLog.c_str());
+}
+
+void groupCommitWriter(LogManager *log, int commits, double *latency){
+  //each action logs one 64 byte change and waits for its commit to be durable
+  char before[64];
+  char after[64];
+  memset(before, 0, sizeof(before));
+  memset(after, 1, sizeof(after));
+  double total = 0;
+  for(int i = 0; i < commits; i++){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    log->beginAction();
+    log->logFileWrite("groupCommitRelation", 1, false, Page::SIZE + i * sizeof(after), before, after, sizeof(after));
+    log->commitAction();
+    total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  *latency = total / commits;
+}
+
+void backgroundWriterTest(){
+  //readPage latency under random updates, with victims cleaned in the foreground or by the background writer
+  std::string writerRelation = "writerRelation";
+  std::cout << "--------------------" << std::endl;
+  std::cout << "readPage latency with and without the background writer" << std::endl;
+  int numPages = 2000;
+  try{
+    File::remove(writerRelation);
+  }catch(const FileNotFoundException &e){
+  }
+  PageFile *file = new PageFile(writerRelation, true);
+  std::vector<int> values(numPages + 1, 0);
+  {
+    BufMgr mgr(100);
+    RECORD record;
+    memset(&record, ' ', sizeof(record));
+    record.i = 0;
+    record.d = 0;
+    for(int i = 0; i < numPages; i++){
+      PageId pageNo;
+      Page *page;
+      mgr.allocPage(file, pageNo, page);
+      page->insertRecord(std::string(reinterpret_cast<char*>(&record), sizeof(record)));
+      mgr.unPinPage(file, pageNo, true);
+    }
+    mgr.flushFile(file);
+  }
+
+  checkPassFail(backgroundWriterRun(file, numPages, false, values), 0)
+  checkPassFail(backgroundWriterRun(file, numPages, true, values), 0)
+
+  //threads sharing a pool half the size of their pages: misses wait for victims being written, and
+  //may find the page read in by another thread when they get the lock back
+  const int sharedPages = 12;
+  const int threads = 4;
+  std::vector<int> updates(sharedPages, 0);
+  {
+    BufMgr mgr(6);
+    mgr.startWriter(6, 0);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; t++){
+      workers.push_back(std::thread(sharedPoolWorker, &mgr, file, sharedPages, threads, t, 20000, &updates[0]));
+    }
+    for(int t = 0; t < threads; t++){
+      workers[t].join();
+    }
+    mgr.stopWriter();
+    mgr.flushFile(file);
+  }
+  int lost = 0;
+  {
+    BufMgr mgr(8);
+    for(int p = 0; p < sharedPages; p++){
+      Page *page;
+      mgr.readPage(file, p + 1, page);
+      RecordId rid = {(PageId)(p + 1), 1};
+      std::string recordStr = page->getRecord(rid);
+      if(reinterpret_cast<const RECORD*>(recordStr.data())->i != values[p + 1] + updates[p]) lost++;
+      mgr.unPinPage(file, p + 1, false);
+    }
+    mgr.flushFile(file);
+  }
+  checkPassFail(lost, 0)
+  delete file;
+  File::remove(writerRelation);
+}
+
+void sharedPoolWorker(BufMgr *mgr, PageFile *file, int numPages, int threads, int worker, int ops, int *updates){
+  //reads any page, updates only the pages it owns
+  unsigned int seed = worker;
+  for(int i = 0; i < ops; i++){
+    int p = rand_r(&seed) % numPages;
+    bool update = p % threads == worker;
+    Page *page;
+    mgr->readPage(file, p + 1, page);
+    if(update){
+      RecordId rid = {(PageId)(p + 1), 1};
+      std::string recordStr = page->getRecord(rid);
+      RECORD record;
+      memcpy(&record, recordStr.data(), sizeof(record));
+      record.i++;
+      page->updateRecord(rid, std::string(reinterpret_cast<char*>(&record), sizeof(record)));
+      updates[p]++;
+    }
+    mgr->unPinPage(file, p + 1, update);
+  }
+}
+
+int backgroundWriterRun(PageFile *file, int numPages, bool background, std::vector<int> &values){
+  //bursts of accesses, half of which update the record on the page; returns the number of pages with a lost update
+  BufMgr mgr(256);
+  if(background) mgr.startWriter(64);
+  std::vector<double> latency;
+  int ops = 100000;
+  for(int i = 0; i < ops; i++){
+    PageId pageNo = 1 + random() % numPages;
+    Page *page;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mgr.readPage(file, pageNo, page);
+    latency.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    bool dirty = random() % 2 == 0;
+    if(dirty){
+      RecordId rid = {pageNo, 1};
+      std::string recordStr = page->getRecord(rid);
+      RECORD record;
+      memcpy(&record, recordStr.data(), sizeof(record));
+      record.i = ++values[pageNo];
+      page->updateRecord(rid, std::string(reinterpret_cast<char*>(&record), sizeof(record)));
+    }
+    mgr.unPinPage(file, pageNo, dirty);
+
+    //idle time between bursts of requests, which the background writer uses
+    if(i % 64 == 63) std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  mgr.stopWriter();
+  std::sort(latency.begin(), latency.end());
+  std::cout << (background ? "with" : "without") << " writer: readPage p50 " << latency[ops / 2] * 1e6
+            << " us, p99 " << latency[ops * 99 / 100] * 1e6
+            << " us, p99.9 " << latency[ops * 999 / 1000] * 1e6
+            << " us, max " << latency[ops - 1] * 1e6 << " us; "
+            << mgr.getBufStats().diskwrites << " foreground writes, "
+            << mgr.getBufStats().backgroundwrites << " background writes" << std::endl;
+  mgr.flushFile(file);
+
+  //read the pages back through a fresh buffer pool
+  BufMgr check(10);
+  int lost = 0;
+  for(int pageNo = 1; pageNo <= numPages; pageNo++){
+    Page *page;
+    check.readPage(file, pageNo, page);
+    RecordId rid = {(PageId)pageNo, 1};
+    std::string recordStr = page->getRecord(rid);
+    if(reinterpret_cast<const RECORD*>(recordStr.data())->i != values[pageNo]) lost++;
+    check.unPinPage(file, pageNo, false);
+  }
+  check.flushFile(file);
+  return lost;
+}
+
+void recordViewScanTest(){
+  //full scans reading the key of every record, through copies and through views
+  std::cout << "--------------------" << std::endl;
+  std::cout << "scan throughput with record copies and record views" << std::endl;
+  relationSize = 200000;
+  createRelationForward();
+
+  long long expected = (long long)relationSize * (relationSize - 1) / 2;
+  long long sum;
+  double seconds = scanRun(false, sum);
+  std::cout << "getRecord: " << (int)(relationSize / seconds) << " records/s" << std::endl;
+  checkPassFail(sum, expected)
+
+  seconds = scanRun(true, sum);
+  std::cout << "getRecordView: " << (int)(relationSize / seconds) << " records/s" << std::endl;
+  checkPassFail(sum, expected)
+
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "index build from scan: " << elapsed.count() << " s" << std::endl;
+    checkPassFail(intCount(&index,0,GTE,relationSize,LT), relationSize)
+  }
+  try{
+    File::remove(intIndexName);
+  }catch(const FileNotFoundException &e){
+  }
+  deleteRelation();
+  relationSize = 5000;
+}
+
+double scanRun(bool view, long long &sum){
+  //returns the seconds taken by one scan summing the keys
+  sum = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    FileScan fscan(relationName, bufMgr);
+    try{
+      RecordId scanRid;
+      while(1){
+        fscan.scanNext(scanRid);
+        if(view){
+          RecordView record = fscan.getRecordView();
+          sum += *((int *)(record.data + offsetof(RECORD, i)));
+        }else{
+          std::string recordStr = fscan.getRecord();
+          sum += *((int *)(recordStr.c_str() + offsetof(RECORD, i)));
+        }
+      }
+    }catch(const EndOfFileException &e){
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void pageMutationBenchmark(){
+  //ns per record for the inserts and updates createRelationForward makes, through strings and raw bytes
+  std::cout << "--------------------" << std::endl;
+  std::cout << "page insert and update cost" << std::endl;
+  int records = 2000000;
+  double ns = pageInsertRun(false, records);
+  std::cout << "insert std::string: " << ns << " ns/record" << std::endl;
+  ns = pageInsertRun(true, records);
+  std::cout << "insert raw: " << ns << " ns/record" << std::endl;
+  ns = pageUpdateRun(false, records);
+  std::cout << "update std::string: " << ns << " ns/record" << std::endl;
+  ns = pageUpdateRun(true, records);
+  std::cout << "update raw: " << ns << " ns/record" << std::endl;
+
+  //records of different lengths survive compaction after deletes and resizing updates
+  Page page;
+  std::vector<RecordId> rids;
+  std::vector<std::string> expected;
+  for(int i = 0; i < 40; i++){
+    expected.push_back(std::string(1 + i % 13, (char)('a' + i % 26)));
+    rids.push_back(page.insertRecord(expected[i].data(), expected[i].length()));
+  }
+  for(int i = 0; i < 40; i += 3){
+    page.deleteRecord(rids[i]);
+    expected[i].clear();
+  }
+  for(int i = 1; i < 40; i += 3){
+    expected[i] = std::string(20 - i % 7, (char)('A' + i % 26));
+    page.updateRecord(rids[i], expected[i].data(), expected[i].length());
+  }
+  int mismatches = 0;
+  for(int i = 0; i < 40; i++){
+    if(!expected[i].empty() && page.getRecord(rids[i]) != expected[i]) mismatches++;
+  }
+  checkPassFail(mismatches, 0)
+}
+
+double pageInsertRun(bool raw, int records){
+  //fills pages with RECORDs, starting a new page whenever one is full
+  RECORD record;
+  memset(&record, ' ', sizeof(record));
+  Page *page = new Page();
+  int full = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int i = 0; i < records; i++){
+    record.i = i;
+    record.d = (double)i;
+    try{
+      if(raw){
+        page->insertRecord(reinterpret_cast<char*>(&record), sizeof(record));
+      }else{
+        page->insertRecord(std::string(reinterpret_cast<char*>(&record), sizeof(record)));
+      }
+    }catch(const InsufficientSpaceException &e){
+      delete page;
+      page = new Page();
+      full++;
+      i--;
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  delete page;
+  checkPassFail((full > 0), true)
+  return elapsed.count() * 1e9 / records;
+}
+
+double pageUpdateRun(bool raw, int updates){
+  //rewrites the records of one full page round robin with records of the same length
+  RECORD record;
+  memset(&record, ' ', sizeof(record));
+  Page page;
+  std::vector<RecordId> rids;
+  try{
+    while(1){
+      rids.push_back(page.insertRecord(std::string(reinterpret_cast<char*>(&record), sizeof(record))));
+    }
+  }catch(const InsufficientSpaceException &e){
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int i = 0; i < updates; i++){
+    record.i = i;
+    const RecordId &rid = rids[i % rids.size()];
+    if(raw){
+      page.updateRecord(rid, reinterpret_cast<char*>(&record), sizeof(record));
+    }else{
+      page.updateRecord(rid, std::string(reinterpret_cast<char*>(&record), sizeof(record)));
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  int last = updates - 1 - (updates - 1) % rids.size();
+  RecordView view = page.getRecordView(rids[0]);
+  checkPassFail(reinterpret_cast<const RECORD*>(view.data)->i, last)
+  return elapsed.count() * 1e9 / updates;
+}
+
+void pageChurnBenchmark(){
+  //a full page of small records: random delete+insert pairs, then iteration over a half empty page
+  std::cout << "--------------------" << std::endl;
+  std::cout << "page churn" << std::endl;
+  char data[16];
+  memset(data, 'x', sizeof(data));
+  Page page;
+  std::vector<RecordId> rids;
+  try{
+    while(1) rids.push_back(page.insertRecord(std::string(data, sizeof(data))));
+  }catch(const InsufficientSpaceException &e){
+  }
+
+  int ops = 1000000;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int i = 0; i < ops; i++){
+    int j = random() % rids.size();
+    page.deleteRecord(rids[j]);
+    memcpy(data, &j, sizeof(j));
+    rids[j] = page.insertRecord(std::string(data, sizeof(data)));
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << rids.size() << " records, delete+insert: " << elapsed.count() * 1e9 / ops << " ns" << std::endl;
+  int intact = 0;
+  for(size_t j = 0; j < rids.size(); j++){
+    int tag;
+    memcpy(&tag, page.getRecordView(rids[j]).data, sizeof(tag));
+    if(tag == (int)j) intact++;
+  }
+  checkPassFail(intact, (int)rids.size())
+
+  //delete every other record, keeping the last one so the slot array does not shrink
+  std::sort(rids.begin(), rids.end(), compareRids);
+  int live = rids.size();
+  for(size_t i = 0; i + 1 < rids.size(); i += 2){
+    page.deleteRecord(rids[i]);
+    live--;
+  }
+  int scans = 20000;
+  int seen = 0;
+  start = std::chrono::steady_clock::now();
+  for(int i = 0; i < scans; i++){
+    for(PageIterator it = page.begin(); it != page.end(); ++it) seen++;
+  }
+  elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "iterate half empty page: " << elapsed.count() * 1e9 / seen << " ns per record" << std::endl;
+  checkPassFail(seen, live * scans)
+}
+
+void pageFuzzTest(){
+  //random inserts, deletes and updates of records of random lengths, checked against a map of
+  //what the page should hold; slots get reused while the page compacts
+  std::cout << "--------------------" << std::endl;
+  std::cout << "page fuzz" << std::endl;
+
+  //a slot freed in the middle of the page is reused by an insert that needs a compaction
+  Page page;
+  std::vector<RecordId> rids;
+  while(page.hasSpaceForRecord(100)) rids.push_back(page.insertRecord(std::string(100, 'a')));
+  for(size_t i = 0; i < rids.size(); i += 2) page.deleteRecord(rids[i]);
+  std::uint16_t freeSpace = page.getFreeSpace();
+  RecordId rid = page.insertRecord(std::string(150, 'b'));
+  checkPassFail(rid.slot_number, rids[0].slot_number)
+  checkPassFail(page.getFreeSpace(), freeSpace - 150)
+  int intact = 0;
+  for(size_t i = 1; i < rids.size(); i += 2){
+    if(page.getRecord(rids[i]) == std::string(100, 'a')) intact++;
+  }
+  checkPassFail(intact, (int)rids.size() / 2)
+
+  Page fuzzed;
+  std::map<SlotId, std::string> model;
+  int ops = 200000;
+  int mismatches = 0;
+  for(int i = 0; i < ops; i++){
+    std::size_t length = 1 + random() % 300;
+    std::string data(length, (char)('a' + i % 26));
+    int op = random() % 3;
+    if(op == 0 || model.empty()){
+      if(fuzzed.hasSpaceForRecord(length)){
+        rid = fuzzed.insertRecord(data);
+        if(model.count(rid.slot_number)) mismatches++;
+        model[rid.slot_number] = data;
+      }
+    }else{
+      std::map<SlotId, std::string>::iterator it = model.begin();
+      std::advance(it, random() % model.size());
+      rid.page_number = fuzzed.page_number();
+      rid.slot_number = it->first;
+      if(op == 1){
+        fuzzed.deleteRecord(rid);
+        model.erase(it);
+      }else if(length <= it->second.size() || length <= fuzzed.getFreeSpace() + it->second.size()){
+        fuzzed.updateRecord(rid, data);
+        it->second = data;
+      }
+    }
+
+    //the slot array ends at the last used slot; everything else not held by a record is free
+    std::size_t used = model.empty() ? 0 : model.rbegin()->first * sizeof(PageSlot);
+    for(std::map<SlotId, std::string>::iterator it = model.begin(); it != model.end(); ++it){
+      used += it->second.size();
+    }
+    if(fuzzed.getFreeSpace() != Page::DATA_SIZE - used) mismatches++;
+    if(i % 100 == 0){
+      std::size_t seen = 0;
+      for(PageIterator it = fuzzed.begin(); it != fuzzed.end(); ++it){
+        std::map<SlotId, std::string>::iterator expected = model.find(it.getCurrentRecord().slot_number);
+        if(expected == model.end() || *it != expected->second) mismatches++;
+        seen++;
+      }
+      if(seen != model.size()) mismatches++;
+    }
+  }
+  std::cout << ops << " operations, " << model.size() << " records left" << std::endl;
+  checkPassFail(mismatches, 0)
+}
+
+void paxLayoutTest(){
+  //records round trip through the minipages of a PAX page, then scans and index builds over row and PAX relations
+  std::cout << "--------------------" << std::endl;
+  std::cout << "PAX pages" << std::endl;
+  Page page;
+  paxFormat(page);
+  memset(record1.s, ' ', sizeof(record1.s));
+  std::vector<RecordId> rids;
+  try{
+    while(1){
+      int i = rids.size();
+      sprintf(record1.s, "%05d string record", i);
+      record1.i = i;
+      record1.d = (double)i;
+      rids.push_back(page.insertRecord(reinterpret_cast<char*>(&record1), sizeof(record1)));
+    }
+  }catch(const InsufficientSpaceException &e){
+  }
+  std::cout << rids.size() << " records per PAX page" << std::endl;
+
+  //a deleted record leaves a zero in each minipage and its slot is reused
+  page.deleteRecord(rids[7]);
+  checkPassFail(page.getColumn(0).values<int>()[7], 0)
+  sprintf(record1.s, "%05d string record", 7);
+  record1.i = 7;
+  record1.d = 7.0;
+  checkPassFail((page.insertRecord(reinterpret_cast<char*>(&record1), sizeof(record1)) == rids[7]), true)
+
+  ColumnView keys = page.getColumn(0);
+  ColumnView doubles = page.getColumn(1);
+  int intact = 0;
+  for(size_t j = 0; j < rids.size(); j++){
+    std::string recordStr = page.getRecord(rids[j]);
+    const RECORD *record = reinterpret_cast<const RECORD*>(recordStr.c_str());
+    char s[sizeof(record1.s)];
+    memset(s, ' ', sizeof(s));
+    sprintf(s, "%05d string record", (int)j);
+    if(record->i == (int)j && record->d == (double)j && memcmp(record->s, s, sizeof(s)) == 0 &&
+       keys.values<int>()[j] == (int)j && doubles.values<double>()[j] == (double)j){
+      intact++;
+    }
+  }
+  checkPassFail(intact, (int)rids.size())
+
+  //a view of a PAX record points into the scratch buffer it was reassembled in
+  std::string scratch;
+  RecordView view = page.getRecordView(rids[3], scratch);
+  checkPassFail((view.data == scratch.data() && view.toString() == page.getRecord(rids[3])), true)
+
+  //the same relation in row and in PAX pages: a scan summing the keys, and an index build over RECORD::i
+  relationSize = 10000000;
+  long long expected = (long long)relationSize * (relationSize - 1) / 2;
+  for(int pax = 0; pax < 2; pax++){
+    paxRelation = pax;
+    createRelationForward();
+    bufMgr->flushFile(file1);
+
+    long long sum;
+    double seconds = pax ? paxScanRun(sum) : scanRun(true, sum);
+    std::cout << (pax ? "PAX" : "row") << " pages, key scan: " << seconds << " s" << std::endl;
+    checkPassFail(sum, expected)
+
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << (pax ? "PAX" : "row") << " pages, index build: " << elapsed.count() << " s" << std::endl;
+      checkPassFail(intCount(&index,relationSize/2,GTE,relationSize/2+5000,LT), 5000)
+    }
+    try{
+      File::remove(intIndexName);
+    }catch(const FileNotFoundException &e){
+    }
+    deleteRelation();
+  }
+  paxRelation = false;
+  relationSize = 5000;
+}
+
+void paxFormat(Page &page){
+  //one minipage per field of RECORD
+  std::vector<PaxColumn> columns;
+  PaxColumn i = {offsetof(RECORD, i), sizeof(int), 0};
+  PaxColumn d = {offsetof(RECORD, d), sizeof(double), 0};
+  PaxColumn s = {offsetof(RECORD, s), sizeof(record1.s), 0};
+  columns.push_back(i);
+  columns.push_back(d);
+  columns.push_back(s);
+  page.initializePax(sizeof(RECORD), columns);
+}
+
+double paxScanRun(long long &sum){
+  //returns the seconds taken by one scan of the key column summing the keys
+  sum = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    FileScan fscan(relationName, bufMgr);
+    std::size_t column;
+    fscan.findColumn(offsetof(RECORD, i), column);
+    try{
+      ColumnView keys;
+      while(1){
+        fscan.scanNextColumn(column, keys);
+        const int *values = keys.values<int>();
+        for(SlotId slot = 1; slot <= keys.num_slots; slot++){
+          if(keys.isUsed(slot)){
+            sum += values[slot - 1];
+          }
+        }
+      }
+    }catch(const EndOfFileException &e){
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void vectorScanBenchmark(){
+  //range filters without an index: scanNext with a copy of every record and a scalar compare, against scanNextBatch
+  std::cout << "--------------------" << std::endl;
+  std::cout << "vectorized range filter" << std::endl;
+  relationSize = 1000000;
+  createRelationRandom();
+  bufMgr->flushFile(file1);
+
+  double selectivities[] = {0.001, 0.01, 0.1, 0.5, 1.0};
+  for(int k = 0; k < 5; k++){
+    int high = relationSize * selectivities[k];
+    int count;
+    double scalar = filterRun(false, INTEGER, high, count);
+    checkPassFail(count, high)
+    double batch = filterRun(true, INTEGER, high, count);
+    checkPassFail(count, high)
+    std::cout << "selectivity " << selectivities[k] * 100 << "%: scanNext " << (int)(relationSize / scalar)
+              << " records/s, scanNextBatch " << (int)(relationSize / batch) << " records/s" << std::endl;
+  }
+  int count;
+  filterRun(true, DOUBLE, relationSize / 10, count);
+  checkPassFail(count, relationSize / 10)
+  deleteRelation();
+
+  //PAX pages are filtered straight from the key column
+  paxRelation = true;
+  createRelationForward();
+  bufMgr->flushFile(file1);
+  double batch = filterRun(true, INTEGER, relationSize / 10, count);
+  checkPassFail(count, relationSize / 10)
+  std::cout << "PAX pages, selectivity 10%: scanNextBatch " << (int)(relationSize / batch) << " records/s" << std::endl;
+  deleteRelation();
+  paxRelation = false;
+  relationSize = 5000;
+}
+
+double filterRun(bool batch, Datatype type, int high, int &count){
+  //returns the seconds taken by one scan selecting the records with a key in [0, high)
+  count = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    FileScan fscan(relationName, bufMgr);
+    std::vector<RecordId> rids;
+    try{
+      if(batch){
+        int lowInt = 0;
+        double lowDouble = 0, highDouble = high;
+        while(1){
+          if(type == INTEGER){
+            fscan.scanNextBatch(offsetof(RECORD, i), INTEGER, &lowInt, GTE, &high, LT, rids);
+          }else{
+            fscan.scanNextBatch(offsetof(RECORD, d), DOUBLE, &lowDouble, GTE, &highDouble, LT, rids);
+          }
+          count += rids.size();
+        }
+      }else{
+        RecordId scanRid;
+        while(1){
+          fscan.scanNext(scanRid);
+          std::string recordStr = fscan.getRecord();
+          int key = *((int *)(recordStr.c_str() + offsetof(RECORD, i)));
+          if(key >= 0 && key < high){
+            rids.push_back(scanRid);
+            count++;
+          }
+        }
+      }
+    }catch(const EndOfFileException &e){
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void parallelScanBenchmark(){
+  //a scan summing the keys of a large relation, split across 1 to 8 worker threads
+  std::cout << "--------------------" << std::endl;
+  std::cout << "parallel scan, " << std::thread::hardware_concurrency() << " cores" << std::endl;
+  relationSize = 2000000;
+  createRelationForward();
+  bufMgr->flushFile(file1);
+  long long expected = (long long)relationSize * (relationSize - 1) / 2;
+  {
+    ParallelFileScan scan(relationName, bufMgr);
+    for(unsigned workers = 1; workers <= 8; workers *= 2){
+      std::vector<long long> sums(workers, 0);
+      std::atomic<std::size_t> pages(0);
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      scan.run(workers, [&sums, &pages](unsigned worker, Page *page){
+        long long sum = 0;
+        for(PageIterator iter = page->begin(); iter != page->end(); ++iter){
+          RecordView record = iter.getRecordView();
+          sum += *((int *)(record.data + offsetof(RECORD, i)));
+        }
+        sums[worker] += sum;
+        pages++;
+      });
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      long long total = 0;
+      for(unsigned i = 0; i < workers; i++){
+        total += sums[i];
+      }
+      std::cout << workers << " workers: " << (int)(relationSize / elapsed.count()) << " records/s" << std::endl;
+      checkPassFail(total, expected)
+      checkPassFail(pages.load(), scan.numPages())
+    }
+  }
+  deleteRelation();
+  relationSize = 5000;
+}
+
+void parallelIndexBuildTest(){
+  //bulk-loaded index over runs of equal keys that straddle leaves, with runs spilled to disk
+  std::cout << "--------------------" << std::endl;
+  std::cout << "parallel index build" << std::endl;
+  try{
+    File::remove(relationName);
+  }catch(const FileNotFoundException &e){
+  }
+  file1 = new PageFile(relationName, true);
+  memset(record1.s, ' ', sizeof(record1.s));
+  PageId new_page_number;
+  Page new_page = file1->allocatePage(new_page_number);
+  for(int i = 0; i < 30000; i++){
+    record1.i = i / 300;
+    while(1){
+      try{
+        new_page.insertRecord(reinterpret_cast<char*>(&record1), sizeof(record1));
+        break;
+      }catch(const InsufficientSpaceException &e){
+        file1->writePage(new_page_number, new_page);
+        new_page = file1->allocatePage(new_page_number);
+      }
+    }
+  }
+  file1->writePage(new_page_number, new_page);
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, 3, 64 * 1024);
+    int intact = 0;
+    for(int k = 0; k < 100; k++){
+      if(intCount(&index, k, GTE, k, LTE) == 300) intact++;
+    }
+    checkPassFail(intact, 100)
+    checkPassFail(intCount(&index, 10, GT, 20, LT), 2700)
+  }
+  File::remove(intIndexName);
+  deleteRelation();
+
+  //build wall time on a large relation inserted in random order, from 1 to 8 threads
+  relationSize = 5000000;
+  createRelationRandom();
+  bufMgr->flushFile(file1);
+  for(unsigned threads = 1; threads <= 8; threads *= 2){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+      BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, threads, 256 << 20);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << threads << " threads: " << elapsed.count() << " s" << std::endl;
+      checkPassFail(intCount(&index, relationSize / 2, GTE, relationSize / 2 + 5000, LT), 5000)
+      if(threads == 1){
+        checkPassFail(intCount(&index, 0, GTE, relationSize, LT), relationSize)
+      }
+    }
+    File::remove(intIndexName);
+  }
+  deleteRelation();
+  relationSize = 5000;
+}
+
+void externalSortTest(){
+  //equal keys keep their scan order across runs and merge passes
+  std::cout << "--------------------" << std::endl;
+  std::cout << "external sort" << std::endl;
+  try{
+    File::remove(relationName);
+  }catch(const FileNotFoundException &e){
+  }
+  file1 = new PageFile(relationName, true);
+  memset(record1.s, ' ', sizeof(record1.s));
+  PageId new_page_number;
+  Page new_page = file1->allocatePage(new_page_number);
+  for(int i = 0; i < 30000; i++){
+    record1.i = (i * 7919) % 100;
+    record1.d = i;
+    while(1){
+      try{
+        new_page.insertRecord(reinterpret_cast<char*>(&record1), sizeof(record1));
+        break;
+      }catch(const InsufficientSpaceException &e){
+        file1->writePage(new_page_number, new_page);
+        new_page = file1->allocatePage(new_page_number);
+      }
+    }
+  }
+  file1->writePage(new_page_number, new_page);
+  {
+    ExternalSort sort(relationName, bufMgr, offsetof(tuple,i), INTEGER, 5);
+    int count = 0;
+    bool stable = true;
+    RECORD last;
+    last.i = -1;
+    RecordView record;
+    try{
+      while(1){
+        sort.next(record);
+        const RECORD *current = reinterpret_cast<const RECORD*>(record.data);
+        if(current->i < last.i || (current->i == last.i && current->d <= last.d)) stable = false;
+        last = *current;
+        count++;
+      }
+    }catch(const EndOfFileException &e){
+    }
+    checkPassFail(count, 30000)
+    checkPassFail(stable, true)
+    checkPassFail((sort.numMergePasses() > 1), true)
+  }
+  deleteRelation();
+
+  //sort time of a relation inserted in random order under different budgets
+  relationSize = 1340000;
+  createRelationRandom();
+  bufMgr->flushFile(file1);
+  int budgets[] = {8, 64, 512, 4096};
+  for(int b = 0; b < 4; b++){
+    int runs, passes, count;
+    bool sorted;
+    double seconds = sortRun(budgets[b], b % 2 ? DOUBLE : INTEGER, runs, passes, count, sorted);
+    std::cout << budgets[b] << " frames: " << runs << " runs, " << passes << " passes, " << seconds << " s" << std::endl;
+    checkPassFail(count, relationSize)
+    checkPassFail(sorted, true)
+  }
+  deleteRelation();
+  relationSize = 5000;
+}
+
+double sortRun(int frames, Datatype type, int &runs, int &passes, int &count, bool &sorted){
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  ExternalSort sort(relationName, bufMgr, type == INTEGER ? offsetof(tuple,i) : offsetof(tuple,d), type, frames);
+  count = 0;
+  sorted = true;
+  RecordView record;
+  try{
+    while(1){
+      sort.next(record);
+      const RECORD *current = reinterpret_cast<const RECORD*>(record.data);
+      if(current->i != count || current->d != count) sorted = false;
+      count++;
+    }
+  }catch(const EndOfFileException &e){
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  runs = sort.numInitialRuns();
+  passes = sort.numMergePasses();
+  return elapsed.count();
+}
+
+void joinTest(){
+  //index nested-loop and sort-merge joins against a probe per outer tuple, at several join selectivities
+  std::cout << "--------------------" << std::endl;
+  std::cout << "joins" << std::endl;
+  const std::string outerName = relationName + ".outer";
+  const std::string innerName = relationName + ".inner";
+  //inner relation: every key below innerKeys twice, in random order
+  const int innerKeys = 50000;
+  std::vector<int> keys;
+  for(int i = 0; i < 2 * innerKeys; i++){
+    keys.push_back(i / 2);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  createKeyRelation(innerName, keys);
+  std::string innerIndexName, outerIndexName;
+  {
+    BTreeIndex innerIndex(innerName, innerIndexName, bufMgr, offsetof(tuple,i), INTEGER, 1, 64 << 20);
+    int percents[] = {1, 10, 50, 100};
+    for(int p = 0; p < 4; p++){
+      //outer keys drawn from a range of which the inner keys cover the given percentage
+      const int range = innerKeys * 100 / percents[p];
+      keys.clear();
+      std::size_t expected = 0;
+      for(int i = 0; i < 20000; i++){
+        keys.push_back(random() % range);
+        if(keys.back() < innerKeys) expected += 2;
+      }
+      createKeyRelation(outerName, keys);
+      std::size_t mismatches = 0;
+      JoinCallback check = [&mismatches](const RecordView &left, const RecordView &right){
+        if(reinterpret_cast<const RECORD*>(left.data)->i != reinterpret_cast<const RECORD*>(right.data)->i) mismatches++;
+      };
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      std::size_t probed = probeJoin(outerName, innerName, &innerIndex);
+      std::chrono::duration<double> probeTime = std::chrono::steady_clock::now() - start;
+
+      start = std::chrono::steady_clock::now();
+      IndexNestedLoopJoin nestedLoop(outerName, offsetof(tuple,i), innerName, &innerIndex, bufMgr);
+      std::size_t nested = nestedLoop.run(check);
+      std::chrono::duration<double> nestedTime = std::chrono::steady_clock::now() - start;
+
+      //the outer index is built by single inserts, so runs of equal keys may straddle its leaves
+      std::size_t merged;
+      std::chrono::duration<double> mergeTime;
+      {
+        BTreeIndex outerIndex(outerName, outerIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        start = std::chrono::steady_clock::now();
+        SortMergeJoin mergeJoin(outerName, &outerIndex, innerName, &innerIndex, bufMgr);
+        merged = mergeJoin.run(check);
+        mergeTime = std::chrono::steady_clock::now() - start;
+      }
+      File::remove(outerIndexName);
+      File::remove(outerName);
+
+      std::cout << percents[p] << "% selectivity, " << expected << " pairs: probe loop " << probeTime.count()
+                << " s, index nested-loop " << nestedTime.count() << " s (" << nestedLoop.numDescents()
+                << " descents), sort-merge " << mergeTime.count() << " s" << std::endl;
+      checkPassFail(probed, expected)
+      checkPassFail(nested, expected)
+      checkPassFail(merged, expected)
+      checkPassFail(mismatches, 0)
+    }
+  }
+  File::remove(innerIndexName);
+  File::remove(innerName);
+}
+
+void heapFetchBenchmark(){
+  //records of an unclustered index range fetched one pin per rid in key order, or in page order
+  std::cout << "--------------------" << std::endl;
+  std::cout << "heap fetch" << std::endl;
+  relationSize = 500000;
+  createRelationRandom();
+  bufMgr->flushFile(file1);
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, 1, 64 << 20);
+    HeapFetch fetch(relationName, &index, bufMgr);
+    int percents[] = {1, 5, 10, 20};
+    for(int p = 0; p < 4; p++){
+      int low = relationSize / 3;
+      int high = low + relationSize / 100 * percents[p];
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      long long naiveSum = 0;
+      int naive = 0;
+      index.startScan(&low, GTE, &high, LT);
+      try{
+        while(1){
+          RecordId scanRid;
+          Page *page;
+          index.scanNext(scanRid);
+          bufMgr->readPage(file1, scanRid.page_number, page);
+          naiveSum += reinterpret_cast<const RECORD*>(page->getRecordView(scanRid).data)->i;
+          bufMgr->unPinPage(file1, scanRid.page_number, false);
+          naive++;
+        }
+      }catch(const IndexScanCompletedException &e){
+      }
+      index.endScan();
+      std::chrono::duration<double> naiveTime = std::chrono::steady_clock::now() - start;
+
+      start = std::chrono::steady_clock::now();
+      long long sortedSum = 0;
+      std::size_t sorted = fetch.run(&low, GTE, &high, LT, [&sortedSum](const RecordId &rid, const RecordView &record){
+        sortedSum += reinterpret_cast<const RECORD*>(record.data)->i;
+      });
+      std::chrono::duration<double> sortedTime = std::chrono::steady_clock::now() - start;
+
+      std::cout << percents[p] << "%: naive " << (int)(naive / naiveTime.count()) << " records/s, " << naive
+                << " pins; sorted " << (int)(sorted / sortedTime.count()) << " records/s, " << fetch.numPins()
+                << " pins" << std::endl;
+      checkPassFail(naive, high - low)
+      checkPassFail(sorted, (std::size_t)(high - low))
+      checkPassFail(sortedSum, naiveSum)
+    }
+  }
+  File::remove(intIndexName);
+  deleteRelation();
+  relationSize = 5000;
+}
+
+void coveringIndexBenchmark(){
+  //range queries reading d and s, from the heap after an index scan or from a covering index alone
+  std::cout << "--------------------" << std::endl;
+  std::cout << "covering index" << std::endl;
+  relationSize = 200000;
+  createRelationRandom();
+  bufMgr->flushFile(file1);
+  std::string coveringIndexName;
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    std::vector<IncludedAttr> included;
+    IncludedAttr d = {offsetof(tuple,d), sizeof(double)};
+    IncludedAttr s = {offsetof(tuple,s), sizeof(record1.s)};
+    included.push_back(d);
+    included.push_back(s);
+    BTreeIndex covering(relationName, coveringIndexName, bufMgr, offsetof(tuple,i), INTEGER, included);
+    checkPassFail(covering.getPayloadLength(), (int)(sizeof(double) + sizeof(record1.s)))
+
+    //entries without records cannot be added to a covering index
+    bool refused = false;
+    try{
+      covering.insertBatch(std::vector<std::pair<int, RecordId> >(1, std::make_pair(0, rid)));
+    }catch(const BadIndexInfoException &e){
+      refused = true;
+    }
+    checkPassFail(refused, true)
+
+    const int queries = 200;
+    const int width = 1000;
+    double heapSum = 0, coveredSum = 0;
+    int heapStrings = 0, coveredStrings = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int q = 0; q < queries; q++){
+      int low = (q * 7919) % (relationSize - width);
+      int high = low + width;
+      index.startScan(&low, GTE, &high, LT);
+      try{
+        while(1){
+          RecordId scanRid;
+          Page *page;
+          index.scanNext(scanRid);
+          bufMgr->readPage(file1, scanRid.page_number, page);
+          const RECORD *record = reinterpret_cast<const RECORD*>(page->getRecordView(scanRid).data);
+          heapSum += record->d;
+          if(atoi(record->s) == (int)record->d) heapStrings++;
+          bufMgr->unPinPage(file1, scanRid.page_number, false);
+        }
+      }catch(const IndexScanCompletedException &e){
+      }
+      index.endScan();
+    }
+    std::chrono::duration<double> heapTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    char payload[sizeof(double) + sizeof(record1.s)];
+    for(int q = 0; q < queries; q++){
+      int low = (q * 7919) % (relationSize - width);
+      int high = low + width;
+      covering.startScan(&low, GTE, &high, LT);
+      try{
+        while(1){
+          RecordId scanRid;
+          covering.scanNext(scanRid, payload);
+          double value;
+          memcpy(&value, payload, sizeof(value));
+          coveredSum += value;
+          if(atoi(payload + sizeof(double)) == (int)value) coveredStrings++;
+        }
+      }catch(const IndexScanCompletedException &e){
+      }
+      covering.endScan();
+    }
+    std::chrono::duration<double> coveredTime = std::chrono::steady_clock::now() - start;
+
+    std::cout << "heap fetch: " << (int)(queries / heapTime.count()) << " queries/s, index-only: "
+              << (int)(queries / coveredTime.count()) << " queries/s" << std::endl;
+    checkPassFail(heapStrings, queries * width)
+    checkPassFail(coveredStrings, queries * width)
+    checkPassFail(coveredSum, heapSum)
+  }
+  File::remove(intIndexName);
+  File::remove(coveringIndexName);
+  deleteRelation();
+  relationSize = 5000;
+}
+
+void compositeIndexBenchmark(){
+  //queries on (i, d range): an index on i with the d filter applied to every fetched record, or a composite index on (i, d)
+  std::cout << "--------------------" << std::endl;
+  std::cout << "composite index" << std::endl;
+  typedef CompositeKey<int, double> IntDoubleKey;
+  const int groups = 4000, perGroup = 50;
+  std::vector<int> values;
+  for(int v = 0; v < groups * perGroup; v++) values.push_back(v);
+  std::random_shuffle(values.begin(), values.end());
+  std::vector<int> keys;
+  std::vector<double> doubles;
+  for(size_t v = 0; v < values.size(); v++){
+    keys.push_back(values[v] / perGroup);
+    doubles.push_back(values[v] % perGroup);
+  }
+  createKeyRelation(relationName, keys, doubles);
+
+  std::string compositeIndexName;
+  std::vector<int> offsets;
+  offsets.push_back(offsetof(tuple,i));
+  offsets.push_back(offsetof(tuple,d));
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, 1, 64 << 20);
+    CompositeIndex<IntDoubleKey> composite(relationName, compositeIndexName, bufMgr, offsets);
+    checkPassFail(compositeIndexName, relationName + ".0.8")
+    PageFile *relation = new PageFile(relationName, false);
+
+    const int queries = 2000;
+    int filtered = 0, fetched = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int q = 0; q < queries; q++){
+      //GT the key before, since equal keys may straddle leaves
+      int low = (q * 7919) % groups - 1;
+      int high = low + 1;
+      index.startScan(&low, GT, &high, LTE);
+      try{
+        while(1){
+          RecordId scanRid;
+          Page *page;
+          index.scanNext(scanRid);
+          bufMgr->readPage(relation, scanRid.page_number, page);
+          double d = reinterpret_cast<const RECORD*>(page->getRecordView(scanRid).data)->d;
+          bufMgr->unPinPage(relation, scanRid.page_number, false);
+          fetched++;
+          if(d >= 10 && d <= 19) filtered++;
+        }
+      }catch(const IndexScanCompletedException &e){
+      }
+      index.endScan();
+    }
+    std::chrono::duration<double> filterTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    int matched = 0;
+    double dSum = 0;
+    for(int q = 0; q < queries; q++){
+      int key = (q * 7919) % groups;
+      composite.startScan(makeCompositeKey(key, 10.0), GTE, makeCompositeKey(key, 19.0), LTE);
+      try{
+        while(1){
+          RecordId scanRid;
+          IntDoubleKey found;
+          composite.scanNext(scanRid, found);
+          if(found.head == key) matched++;
+          dSum += found.tail.head;
+        }
+      }catch(const IndexScanCompletedException &e){
+      }
+      composite.endScan();
+    }
+    std::chrono::duration<double> compositeTime = std::chrono::steady_clock::now() - start;
+    std::cout << "index on i and filter: " << (int)(queries / filterTime.count()) << " queries/s, " << fetched
+              << " records fetched; composite index: " << (int)(queries / compositeTime.count()) << " queries/s" << std::endl;
+    checkPassFail(fetched, queries * perGroup)
+    checkPassFail(filtered, queries * 10)
+    checkPassFail(matched, queries * 10)
+    checkPassFail(dSum, queries * 145.0)
+
+    //prefix scan: every entry of a range of i, whatever d is
+    int prefix = 0;
+    composite.startScan(makeCompositeKey(100, 0.0), GTE, makeCompositeKey(109, 0.0), LTE, 1);
+    try{
+      while(1){
+        RecordId scanRid;
+        composite.scanNext(scanRid);
+        prefix++;
+      }
+    }catch(const IndexScanCompletedException &e){
+    }
+    composite.endScan();
+    checkPassFail(prefix, 10 * perGroup)
+
+    bool noKey = false;
+    try{
+      composite.startScan(makeCompositeKey(groups, 0.0), GTE, makeCompositeKey(groups + 5, 0.0), LTE, 1);
+    }catch(const NoSuchKeyFoundException &e){
+      noKey = true;
+    }
+    checkPassFail(noKey, true)
+    bool badRange = false;
+    try{
+      composite.startScan(makeCompositeKey(5, 20.0), GTE, makeCompositeKey(5, 10.0), LTE);
+    }catch(const BadScanrangeException &e){
+      badRange = true;
+    }
+    checkPassFail(badRange, true)
+
+    //inserts split the full leaves left by the bulk load; new d values land between the existing ones
+    for(int v = 0; v < groups * 2; v++){
+      RecordId newRid = {1, (SlotId)v, 0};
+      composite.insertEntry(makeCompositeKey(v % groups, 10.5), newRid);
+    }
+    matched = 0;
+    composite.startScan(makeCompositeKey(0, 10.0), GTE, makeCompositeKey(groups, 11.0), LT);
+    try{
+      RecordId scanRid;
+      IntDoubleKey found, last = makeCompositeKey(-1, 0.0);
+      while(1){
+        composite.scanNext(scanRid, found);
+        if(IntDoubleKey::compare(last, found, 2) > 0) break;
+        last = found;
+        if(found.tail.head >= 10 && found.tail.head < 11) matched++;
+      }
+    }catch(const IndexScanCompletedException &e){
+    }
+    composite.endScan();
+    checkPassFail(matched, groups * 3)
+    bufMgr->flushFile(relation);
+    delete relation;
+  }
+
+  //reopening checks that the file was built on the same attributes
+  {
+    CompositeIndex<IntDoubleKey> reopened(relationName, compositeIndexName, bufMgr, offsets);
+    int found = 0;
+    reopened.startScan(makeCompositeKey(7, 0.0), GTE, makeCompositeKey(7, 0.0), LTE, 1);
+    try{
+      while(1){
+        RecordId scanRid;
+        reopened.scanNext(scanRid);
+        found++;
+      }
+    }catch(const IndexScanCompletedException &e){
+    }
+    reopened.endScan();
+    checkPassFail(found, perGroup + 2)
+  }
+  //same attributes read as other types
+  bool mismatch = false;
+  try{
+    CompositeIndex<CompositeKey<int, int> > other(relationName, compositeIndexName, bufMgr, offsets);
+  }catch(const BadIndexInfoException &e){
+    mismatch = true;
+  }
+  checkPassFail(mismatch, true)
+  File::remove(intIndexName);
+  File::remove(compositeIndexName);
+  File::remove(relationName);
+}
+
+void lookupBenchmark(){
+  //equality probes through a scan, through lookup, and through lookupBatch
+  std::cout << "--------------------" << std::endl;
+  std::cout << "point lookups" << std::endl;
+
+  //keys with up to 7 duplicates inserted in random order, so equal keys straddle leaves after splits
+  std::vector<int> keys;
+  const int distinct = 3000;
+  for(int k = 0; k < distinct; k++){
+    for(int c = 0; c <= k % 7; c++) keys.push_back(k);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  createKeyRelation(relationName, keys);
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    PageFile *relation = new PageFile(relationName, false);
+    std::vector<int> probes;
+    for(int k = distinct; k >= -1; k--) probes.push_back(k);
+    std::vector<RecordId> batchRids;
+    std::vector<std::size_t> offsets;
+    index.lookupBatch(probes, batchRids, offsets);
+    checkPassFail(offsets.size(), probes.size() + 1)
+    checkPassFail(batchRids.size(), keys.size())
+    int wrongCounts = 0, wrongRids = 0;
+    RecordId found[8];
+    for(size_t p = 0; p < probes.size(); p++){
+      int k = probes[p];
+      std::size_t expected = k >= 0 && k < distinct ? k % 7 + 1 : 0;
+      std::size_t count = index.lookup(k, found, 8);
+      if(count != expected || offsets[p + 1] - offsets[p] != expected) wrongCounts++;
+      for(std::size_t r = offsets[p]; r < offsets[p + 1]; r++){
+        Page *page;
+        bufMgr->readPage(relation, batchRids[r].page_number, page);
+        if(reinterpret_cast<const RECORD*>(page->getRecordView(batchRids[r]).data)->i != k) wrongRids++;
+        if(batchRids[r].page_number != found[r - offsets[p]].page_number ||
+           batchRids[r].slot_number != found[r - offsets[p]].slot_number) wrongRids++;
+        bufMgr->unPinPage(relation, batchRids[r].page_number, false);
+      }
+    }
+    checkPassFail(wrongCounts, 0)
+    checkPassFail(wrongRids, 0)
+
+    //only max matches are stored, but all are counted
+    found[1].page_number = 0;
+    checkPassFail(index.lookup(6, found, 1), (std::size_t)7)
+    checkPassFail(found[1].page_number, (PageId)0)
+    bufMgr->flushFile(relation);
+    delete relation;
+  }
+  File::remove(intIndexName);
+
+  //half of the probes miss
+  relationSize = 200000;
+  createRelationRandom();
+  bufMgr->flushFile(file1);
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, 1, 64 << 20);
+    std::vector<int> probes;
+    std::size_t hits = 0;
+    for(int p = 0; p < relationSize; p++){
+      probes.push_back((int)(((long long)p * 7919) % (2 * relationSize)));
+      if(probes.back() < relationSize) hits++;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::size_t scanHits = 0;
+    for(size_t p = 0; p < probes.size(); p++){
+      try{
+        index.startScan(&probes[p], GTE, &probes[p], LTE);
+      }catch(const NoSuchKeyFoundException &e){
+        continue;
+      }
+      try{
+        while(1){
+          RecordId scanRid;
+          index.scanNext(scanRid);
+          scanHits++;
+        }
+      }catch(const IndexScanCompletedException &e){
+      }
+      index.endScan();
+    }
+    std::chrono::duration<double> scanTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    std::size_t lookupHits = 0;
+    RecordId found[4];
+    for(size_t p = 0; p < probes.size(); p++){
+      lookupHits += index.lookup(probes[p], found, 4);
+    }
+    std::chrono::duration<double> lookupTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    std::vector<RecordId> batchRids;
+    std::vector<std::size_t> offsets;
+    std::size_t batchHits = index.lookupBatch(probes, batchRids, offsets);
+    std::chrono::duration<double> batchTime = std::chrono::steady_clock::now() - start;
+
+    std::cout << "scan: " << (int)(probes.size() / scanTime.count()) << " probes/s, lookup: "
+              << (int)(probes.size() / lookupTime.count()) << " probes/s, lookupBatch: "
+              << (int)(probes.size() / batchTime.count()) << " probes/s" << std::endl;
+    checkPassFail(scanHits, hits)
+    checkPassFail(lookupHits, scanHits)
+    checkPassFail(batchHits, scanHits)
+  }
+  File::remove(intIndexName);
+  deleteRelation();
+  relationSize = 5000;
+}
+
+void bloomFilterBenchmark(){
+  //point lookups with a growing share of missing keys, without and with a filter on the index
+  std::cout << "--------------------" << std::endl;
+  std::cout << "bloom filter" << std::endl;
+  relationSize = 200000;
+  createRelationRandom();
+  bufMgr->flushFile(file1);
+  std::string filterName;
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, 1, 64 << 20);
+    filterName = intIndexName + ".filter";
+    checkPassFail((index.getFilter() == NULL), true)
+
+    const int missPercents[] = {0, 50, 90, 99};
+    std::vector<int> probes[4];
+    for(int m = 0; m < 4; m++){
+      for(int p = 0; p < relationSize; p++){
+        int key = (int)(((long long)p * 7919) % relationSize);
+        probes[m].push_back(p % 100 < missPercents[m] ? key + relationSize : key);
+      }
+    }
+    RecordId found[4];
+    double plainRate[4];
+    std::size_t plainHits[4];
+    for(int m = 0; m < 4; m++){
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      plainHits[m] = 0;
+      for(size_t p = 0; p < probes[m].size(); p++) plainHits[m] += index.lookup(probes[m][p], found, 4);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      plainRate[m] = probes[m].size() / elapsed.count();
+    }
+
+    index.buildFilter(10);
+    checkPassFail(index.getFilter()->numKeys(), (std::size_t)relationSize)
+    int falseNegatives = 0, falsePositives = 0;
+    const int absent = 1000000;
+    for(int k = 0; k < relationSize; k++){
+      if(!index.mayContain(k)) falseNegatives++;
+    }
+    for(int k = 0; k < absent; k++){
+      if(index.mayContain(relationSize + k)) falsePositives++;
+    }
+    std::cout << "filter: " << index.getFilter()->size() / 1024 << " KB, false positive rate "
+              << 100.0 * falsePositives / absent << "%" << std::endl;
+    checkPassFail(falseNegatives, 0)
+    checkPassFail((falsePositives < absent / 50), true)
+
+    for(int m = 0; m < 4; m++){
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      std::size_t hits = 0;
+      for(size_t p = 0; p < probes[m].size(); p++) hits += index.lookup(probes[m][p], found, 4);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << missPercents[m] << "% misses: " << (int)plainRate[m] << " lookups/s without filter, "
+                << (int)(probes[m].size() / elapsed.count()) << " lookups/s with filter" << std::endl;
+      checkPassFail(hits, plainHits[m])
+      checkPassFail(hits, (std::size_t)(relationSize / 100 * (100 - missPercents[m])))
+    }
+
+    //ruled out single-key scans, and keys added after the filter was built
+    bool noKey = false;
+    int low = relationSize * 3, high = low + 1;
+    try{
+      index.startScan(&low, GTE, &high, LT);
+    }catch(const NoSuchKeyFoundException &e){
+      noKey = true;
+    }
+    checkPassFail(noKey, true)
+    RecordId newRid = {1, 1, 0};
+    index.insertEntry(&low, newRid);
+    std::vector<std::pair<int, RecordId> > batch(1, std::make_pair(high, newRid));
+    index.insertBatch(batch);
+    checkPassFail(index.lookup(low, found, 4), (std::size_t)1)
+    std::vector<RecordId> batchRids;
+    std::vector<std::size_t> offsets;
+    std::vector<int> batchKeys;
+    batchKeys.push_back(relationSize + 5);
+    batchKeys.push_back(high);
+    batchKeys.push_back(7);
+    batchKeys.push_back(INT_MAX);
+    checkPassFail(index.lookupBatch(batchKeys, batchRids, offsets), (std::size_t)2)
+    checkPassFail(offsets[1], (std::size_t)0)
+    checkPassFail(offsets[2], (std::size_t)1)
+    checkPassFail(offsets[4], (std::size_t)2)
+  }
+
+  //the filter is saved with the index, and marked as open while loaded
+  {
+    BTreeIndex reopened(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail((reopened.getFilter() != NULL), true)
+    checkPassFail(reopened.getFilter()->numKeys(), (std::size_t)relationSize + 2)
+    checkPassFail(reopened.mayContain(relationSize * 3), true)
+    BloomFilter *again = BloomFilter::load(filterName, bufMgr);
+    checkPassFail((again == NULL), true)
+  }
+  BloomFilter *saved = BloomFilter::load(filterName, bufMgr);
+  checkPassFail((saved != NULL), true)
+  delete saved;
+
+  //an index created anew drops the filter of the one it replaces
+  File::remove(intIndexName);
+  {
+    BTreeIndex rebuilt(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, 1, 64 << 20);
+    checkPassFail((rebuilt.getFilter() == NULL), true)
+    checkPassFail(File::exists(filterName), false)
+  }
+  File::remove(intIndexName);
+  deleteRelation();
+  relationSize = 5000;
+}
+
+void learnedIndexBenchmark(){
+  //lookups through the non-leaf levels or through a learned model of the leaves, on three key distributions
+  std::cout << "--------------------" << std::endl;
+  std::cout << "learned index" << std::endl;
+
+  //duplicates, and equal keys kept together by the bulk load, give the same answers either way
+  std::vector<int> keys;
+  const int distinct = 20000;
+  for(int k = 0; k < distinct; k++){
+    for(int c = 0; c <= k % 7; c++) keys.push_back(k * 3);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  createKeyRelation(relationName, keys);
+  std::size_t segments;
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, 1, 64 << 20, 4);
+    checkPassFail((index.getLearnedModel() != NULL), true)
+    segments = index.getLearnedModel()->numSegments();
+  }
+  {
+    //opening the index again loads the model saved with it
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail((index.getLearnedModel() != NULL), true)
+    checkPassFail(index.getLearnedModel()->numSegments(), segments)
+    RecordId found[8];
+    int wrong = 0;
+    for(int k = -2; k < distinct * 3 + 2; k++){
+      std::size_t expected = k >= 0 && k % 3 == 0 && k < distinct * 3 ? k / 3 % 7 + 1 : 0;
+      if(index.lookup(k, found, 8) != expected) wrong++;
+    }
+    checkPassFail(wrong, 0)
+    std::vector<int> probes(1, 3 * 6);
+    std::vector<RecordId> batchRids;
+    std::vector<std::size_t> offsets;
+    checkPassFail(index.lookupBatch(probes, batchRids, offsets), (std::size_t)7)
+
+    //an insert drops the model, the tree still answers
+    int key = 1;
+    RecordId newRid = {1, 1, 0};
+    index.insertEntry(&key, newRid);
+    checkPassFail((index.getLearnedModel() == NULL), true)
+    checkPassFail(index.lookup(1, found, 8), (std::size_t)1)
+    checkPassFail(index.lookup(3, found, 8), (std::size_t)2)
+  }
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail((index.getLearnedModel() == NULL), true)
+  }
+  File::remove(intIndexName);
+
+  //a model too big for one page is saved on several and predicts the same after loading
+  {
+    std::vector<std::pair<int, std::uint32_t> > points;
+    int key = 0;
+    for(std::uint32_t p = 0; p < 4000; p++){
+      key += 1 + random() % 50;
+      points.push_back(std::make_pair(key, p));
+    }
+    LearnedModel *trained = LearnedModel::train(points, 0, points.size());
+    std::string modelName = relationName + ".model";
+    BlobFile *modelFile = new BlobFile(modelName, true);
+    PageId modelPage = trained->save(bufMgr, modelFile);
+    bufMgr->flushFile(modelFile);
+    LearnedModel *loaded = LearnedModel::load(bufMgr, modelFile, modelPage);
+    int differ = 0;
+    for(int k = -1; k <= key + 1; k++){
+      if(loaded->predict(k) != trained->predict(k)) differ++;
+    }
+    std::cout << trained->numSegments() << " segments (" << trained->size() << " bytes) saved and loaded" << std::endl;
+    checkPassFail((trained->size() > Page::SIZE), true)
+    checkPassFail(loaded->numSegments(), trained->numSegments())
+    checkPassFail(differ, 0)
+    delete trained;
+    delete loaded;
+    bufMgr->flushFile(modelFile);
+    delete modelFile;
+    File::remove(modelName);
+  }
+
+  const int numKeys = 500000;
+  const char *names[] = {"uniform", "skewed", "createRelationRandom"};
+  for(int dist = 0; dist < 3; dist++){
+    keys.clear();
+    if(dist == 0){
+      //distinct keys spread evenly over most of the int range
+      srand(7);
+      for(int k = 0; k < numKeys; k++) keys.push_back((int)(((long long)rand() * 4096 + rand() % 4096) % 2000000000));
+      std::sort(keys.begin(), keys.end());
+      keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+      std::random_shuffle(keys.begin(), keys.end());
+    }else if(dist == 1){
+      //mostly small gaps with rare large jumps
+      srand(11);
+      int key = 0;
+      for(int k = 0; k < numKeys; k++){
+        key += 1 + (rand() % 100 == 0 ? rand() % 100000 : rand() % 10);
+        keys.push_back(key);
+      }
+      std::random_shuffle(keys.begin(), keys.end());
+    }
+    if(dist == 2){
+      relationSize = numKeys;
+      createRelationRandom();
+      bufMgr->flushFile(file1);
+      for(int k = 0; k < numKeys; k++) keys.push_back(k);
+      std::random_shuffle(keys.begin(), keys.end());
+    }else{
+      createKeyRelation(relationName, keys);
+    }
+
+    //a pool holding every leaf, so the lookups are timed without reads from the file
+    BufMgr mgr(2048);
+    double rate[2];
+    std::size_t hits[2];
+    for(int learned = 0; learned < 2; learned++){
+      {
+        BTreeIndex index(relationName, intIndexName, &mgr, offsetof(tuple,i), INTEGER, 1, 64 << 20, learned ? 16 : 0);
+        RecordId found[2];
+        for(size_t k = 0; k < keys.size(); k++) index.lookup(keys[k], found, 2);
+        hits[learned] = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(size_t k = 0; k < keys.size(); k++) hits[learned] += index.lookup(keys[k], found, 2);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        rate[learned] = elapsed.count() * 1e9 / keys.size();
+        if(learned){
+          const LearnedModel *model = index.getLearnedModel();
+          checkPassFail((model != NULL), true)
+          TreeStats stats = index.getTreeStats();
+          std::cout << names[dist] << ": tree " << rate[0] << " ns/lookup, " << stats.nonLeafPages * Page::SIZE
+                    << " bytes of non-leaf pages (" << stats.leafPages * sizeof(int) * 2 << " in use); model " << rate[1]
+                    << " ns/lookup, " << model->size() << " bytes, " << model->numSegments() << " segments, error "
+                    << model->maxError() << std::endl;
+        }
+      }
+      File::remove(intIndexName);
+    }
+    checkPassFail(hits[0], keys.size())
+    checkPassFail(hits[1], keys.size())
+    if(dist == 2){
+      deleteRelation();
+      relationSize = 5000;
+    }
+  }
+  try{
+    File::remove(relationName);
+  }catch(const FileNotFoundException &e){
+  }
+}
+
+void hashIndexBenchmark(){
+  //equality lookups through an extendible hash index and through the B+tree
+  std::cout << "--------------------" << std::endl;
+  std::cout << "hash index" << std::endl;
+  std::string hashIndexName;
+
+  //splits, overflow chains for a heavily duplicated key, deletes, and reopening
+  std::vector<int> keys;
+  const int distinct = 30000;
+  for(int k = 0; k < distinct; k++) keys.push_back(k * 2);
+  for(int c = 0; c < 3000; c++) keys.push_back(7);
+  std::random_shuffle(keys.begin(), keys.end());
+  createKeyRelation(relationName, keys);
+  {
+    HashIndex index(relationName, hashIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(index.numEntries(), keys.size())
+    checkPassFail((index.globalDepth() > 0), true)
+    checkPassFail((index.numOverflowPages() > 0), true)
+    RecordId found[4];
+    int wrong = 0;
+    for(int k = -2; k < distinct * 2 + 2; k++){
+      std::size_t expected = k == 7 ? 3000 : k >= 0 && k % 2 == 0 && k < distinct * 2 ? 1 : 0;
+      if(index.lookup(k, found, 4) != expected) wrong++;
+    }
+    checkPassFail(wrong, 0)
+    std::vector<RecordId> dups(4000);
+    checkPassFail(index.lookup(7, &dups[0], dups.size()), (std::size_t)3000)
+
+    checkPassFail(index.lookup(10, found, 4), (std::size_t)1)
+    RecordId rid = found[0];
+    checkPassFail(index.deleteEntry(10, rid), true)
+    checkPassFail(index.deleteEntry(10, rid), false)
+    checkPassFail(index.lookup(10, found, 4), (std::size_t)0)
+    checkPassFail(index.deleteEntry(7, dups[1234]), true)
+    checkPassFail(index.lookup(7, &dups[0], dups.size()), (std::size_t)2999)
+    index.insertEntry(10, rid);
+  }
+  {
+    HashIndex reopened(relationName, hashIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(reopened.numEntries(), keys.size() - 1)
+    RecordId found[4];
+    checkPassFail(reopened.lookup(10, found, 4), (std::size_t)1)
+    checkPassFail(reopened.lookup(distinct * 2 - 2, found, 4), (std::size_t)1)
+    checkPassFail(reopened.lookup(11, found, 4), (std::size_t)0)
+  }
+  bool badInfo = false;
+  try{
+    HashIndex other(relationName, hashIndexName, bufMgr, offsetof(tuple,d), DOUBLE);
+  }catch(const BadIndexInfoException &e){
+    badInfo = true;
+  }
+  checkPassFail(badInfo, true)
+  File::remove(hashIndexName);
+
+  //a pool holding either index, so the lookups are timed without reads from the file
+  relationSize = 1000000;
+  createRelationRandom();
+  bufMgr->flushFile(file1);
+  std::vector<int> probes;
+  std::size_t hits = 0;
+  for(int p = 0; p < relationSize; p++){
+    probes.push_back((int)(((long long)p * 7919) % (2 * relationSize)));
+    if(probes.back() < relationSize) hits++;
+  }
+  BufMgr mgr(4096);
+  RecordId found[4];
+  double treeRate, hashRate;
+  std::size_t treeHits = 0, hashHits = 0;
+  {
+    BTreeIndex index(relationName, intIndexName, &mgr, offsetof(tuple,i), INTEGER, 1, 64 << 20);
+    for(size_t p = 0; p < probes.size(); p++) index.lookup(probes[p], found, 4);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(size_t p = 0; p < probes.size(); p++) treeHits += index.lookup(probes[p], found, 4);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    treeRate = probes.size() / elapsed.count();
+  }
+  File::remove(intIndexName);
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    HashIndex index(relationName, hashIndexName, &mgr, offsetof(tuple,i), INTEGER);
+    std::chrono::duration<double> build = std::chrono::steady_clock::now() - start;
+    for(size_t p = 0; p < probes.size(); p++) index.lookup(probes[p], found, 4);
+    start = std::chrono::steady_clock::now();
+    for(size_t p = 0; p < probes.size(); p++) hashHits += index.lookup(probes[p], found, 4);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    hashRate = probes.size() / elapsed.count();
+    std::cout << relationSize << " keys: B+tree " << (int)treeRate << " lookups/s, hash " << (int)hashRate
+              << " lookups/s (built in " << build.count() << " s, " << index.numBuckets() << " buckets, "
+              << index.numOverflowPages() << " overflow pages, global depth " << index.globalDepth() << ")" << std::endl;
+  }
+  File::remove(hashIndexName);
+  checkPassFail(treeHits, hits)
+  checkPassFail(hashHits, hits)
+  deleteRelation();
+  relationSize = 5000;
+}
+
+void partitionedIndexBenchmark(){
+  //B+trees split by key range: parallel build, concurrent inserts and parallel range scans, for 1 to 4 threads
+  std::cout << "--------------------" << std::endl;
+  std::cout << "partitioned index" << std::endl;
+  relationSize = 200000;
+  createRelationRandom();
+  bufMgr->flushFile(file1);
+  BufMgr mgr(2048);
+
+  //the answers of a single tree
+  const int numRanges = 5;
+  const int lows[numRanges] = {0, 1000, 49000, 12345, -10};
+  const Operator lowOps[numRanges] = {GTE, GT, GTE, GTE, GTE};
+  const int highs[numRanges] = {INT_MAX, 1500, 151000, 12345, -1};
+  const Operator highOps[numRanges] = {LTE, LTE, LT, LTE, LTE};
+  std::vector<RecordId> expected[numRanges];
+  {
+    BTreeIndex single(relationName, intIndexName, &mgr, offsetof(tuple,i), INTEGER, 1, 64 << 20);
+    for(int r = 0; r < numRanges; r++){
+      try{
+        single.startScan(&lows[r], lowOps[r], &highs[r], highOps[r]);
+        while(1){
+          RecordId rid;
+          single.scanNext(rid);
+          expected[r].push_back(rid);
+        }
+      }catch(const NoSuchKeyFoundException &e){
+      }catch(const IndexScanCompletedException &e){
+      }
+    }
+  }
+  File::remove(intIndexName);
+
+  bool badInfo = false;
+  std::vector<std::string> names;
+  try{
+    PartitionedIndex index(relationName, names, &mgr, offsetof(tuple,d), DOUBLE, 4, 1);
+  }catch(const BadIndexInfoException &e){
+    badInfo = true;
+  }
+  checkPassFail(badInfo, true)
+
+  const int numPartitions = 4;
+  const int numInserts = 100000;
+  for(unsigned threads = 1; threads <= 4; threads *= 2){
+    names.clear();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    PartitionedIndex *index = new PartitionedIndex(relationName, names, &mgr, offsetof(tuple,i), INTEGER, numPartitions, threads);
+    std::chrono::duration<double> build = std::chrono::steady_clock::now() - start;
+    checkPassFail(names.size(), (std::size_t)numPartitions)
+    checkPassFail(index->boundaries().size(), (std::size_t)numPartitions - 1)
+    checkPassFail((index->boundaries()[0] < index->boundaries()[2]), true)
+
+    int wrong = 0;
+    for(int r = 0; r < numRanges; r++){
+      std::vector<RecordId> found;
+      std::size_t count = index->rangeScan(lows[r], lowOps[r], highs[r], highOps[r], found);
+      if(count != found.size() || found != expected[r]) wrong++;
+    }
+    checkPassFail(wrong, 0)
+    bool badRange = false, badOps = false;
+    std::vector<RecordId> none;
+    try{
+      index->rangeScan(5, GTE, 4, LTE, none);
+    }catch(const BadScanrangeException &e){
+      badRange = true;
+    }
+    try{
+      index->rangeScan(4, LT, 5, LTE, none);
+    }catch(const BadOpcodesException &e){
+      badOps = true;
+    }
+    checkPassFail(badRange, true)
+    checkPassFail(badOps, true)
+
+    //every thread inserts its share of a second entry for half of the keys, spread over all partitions
+    start = std::chrono::steady_clock::now();
+    std::vector<std::thread> inserters;
+    for(unsigned t = 0; t < threads; t++){
+      inserters.push_back(std::thread([index, t, threads](){
+        for(int j = t; j < numInserts; j += threads){
+          RecordId rid = {(PageId)(1000000 + j / 100), (SlotId)(j % 100 + 1), 0};
+          index->insertEntry((int)(((long long)j * 7919) % relationSize), rid);
+        }
+      }));
+    }
+    for(unsigned t = 0; t < threads; t++) inserters[t].join();
+    std::chrono::duration<double> inserts = std::chrono::steady_clock::now() - start;
+
+    RecordId found[4];
+    checkPassFail(index->lookup((int)((12345LL * 7919) % relationSize), found, 4), (std::size_t)2)
+    checkPassFail(index->lookup((int)((99999LL * 7919) % relationSize), found, 4), (std::size_t)2)
+
+    //full scans fan out to every partition
+    const int scans = 5;
+    std::size_t scanned = 0;
+    start = std::chrono::steady_clock::now();
+    for(int s = 0; s < scans; s++){
+      std::vector<RecordId> all;
+      scanned += index->rangeScan(INT_MIN, GTE, INT_MAX, LTE, all);
+    }
+    std::chrono::duration<double> scanTime = std::chrono::steady_clock::now() - start;
+    checkPassFail(scanned, (std::size_t)scans * (relationSize + numInserts))
+
+    std::cout << threads << " threads, " << numPartitions << " partitions: build " << build.count() << " s, "
+              << (int)(numInserts / inserts.count()) << " inserts/s, range scans "
+              << (int)(scanned / scanTime.count()) << " entries/s" << std::endl;
+    delete index;
+    for(size_t i = 0; i < names.size(); i++) File::remove(names[i]);
+  }
+  deleteRelation();
+  relationSize = 5000;
+}
+
+void compressedIndexBenchmark(){
+  //leaves with bit-packed keys and record ids against BTreeIndex leaves, on sequential and random keys
+  std::cout << "--------------------" << std::endl;
+  std::cout << "compressed index" << std::endl;
+  std::string compressedName;
+
+  //duplicates, negative and extreme keys, inserts that split leaves, and reopening
+  std::vector<int> keys;
+  srand(5);
+  for(int k = 0; k < 60000; k++) keys.push_back(rand() % 20000 - 10000);
+  keys.push_back(INT_MIN);
+  keys.push_back(INT_MAX);
+  createKeyRelation(relationName, keys);
+  std::vector<std::pair<int, RecordId> > entries;
+  {
+    FileScan scan(relationName, bufMgr);
+    try{
+      while(1){
+        RecordId rid;
+        scan.scanNext(rid);
+        int key;
+        memcpy(&key, scan.getRecordView().data + offsetof(tuple,i), sizeof(key));
+        entries.push_back(std::make_pair(key, rid));
+      }
+    }catch(const EndOfFileException &e){
+    }
+  }
+  RecordId newRid = {900000, 1, 0};
+  const int numInserts = 20000;
+  {
+    CompressedIndex index(relationName, compressedName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(index.numEntries(), keys.size())
+    for(int j = 0; j < numInserts; j++){
+      //keys and rids that pack badly, so leaves split
+      newRid.page_number = 900000 + (j * 7919) % 100000;
+      newRid.slot_number = j % 1000 + 1;
+      int key = (int)(((long long)j * 104729) % 2000000000) - 1000000000;
+      index.insertEntry(key, newRid);
+      entries.push_back(std::make_pair(key, newRid));
+    }
+    checkPassFail(index.numEntries(), keys.size() + numInserts)
+  }
+  std::stable_sort(entries.begin(), entries.end(), compareEntryKeys);
+  {
+    CompressedIndex index(relationName, compressedName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(index.numEntries(), entries.size())
+    const int lows[] = {INT_MIN, -100, 5000, 0, 10000};
+    const int highs[] = {INT_MAX, 100, 5000, 0, INT_MAX};
+    int wrong = 0;
+    for(int r = 0; r < 5; r++){
+      std::vector<std::pair<int, RecordId> >::iterator first = std::lower_bound(entries.begin(), entries.end(), std::make_pair(lows[r], newRid), compareEntryKeys);
+      std::vector<std::pair<int, RecordId> >::iterator last = std::upper_bound(entries.begin(), entries.end(), std::make_pair(highs[r], newRid), compareEntryKeys);
+      std::vector<RecordId> expected, found;
+      for(; first != last; ++first) expected.push_back(first->second);
+      try{
+        index.startScan(&lows[r], GTE, &highs[r], LTE);
+        while(1){
+          RecordId rid;
+          index.scanNext(rid);
+          found.push_back(rid);
+        }
+      }catch(const NoSuchKeyFoundException &e){
+      }catch(const IndexScanCompletedException &e){
+        index.endScan();
+      }
+      //equal keys come back in any order
+      std::sort(expected.begin(), expected.end(), compareRidOrder);
+      std::sort(found.begin(), found.end(), compareRidOrder);
+      if(found != expected) wrong++;
+    }
+    checkPassFail(wrong, 0)
+    wrong = 0;
+    RecordId out[64];
+    for(int k = -10002; k < 10002; k++){
+      std::size_t expected = std::upper_bound(entries.begin(), entries.end(), std::make_pair(k, newRid), compareEntryKeys)
+                             - std::lower_bound(entries.begin(), entries.end(), std::make_pair(k, newRid), compareEntryKeys);
+      if(index.lookup(k, out, 64) != expected) wrong++;
+    }
+    checkPassFail(wrong, 0)
+    checkPassFail(index.lookup(INT_MAX, out, 64), (std::size_t)1)
+    checkPassFail(index.lookup(INT_MIN, out, 64), (std::size_t)1)
+    int low = 10001;
+    bool noKey = false;
+    try{
+      index.startScan(&low, GTE, &low, LTE);
+    }catch(const NoSuchKeyFoundException &e){
+      noKey = true;
+    }
+    checkPassFail(noKey, true)
+  }
+  File::remove(compressedName);
+
+  //size and full scans, with a pool holding either index
+  const int numKeys = 1000000;
+  const char *names[] = {"sequential", "random"};
+  for(int dist = 0; dist < 2; dist++){
+    keys.clear();
+    for(int k = 0; k < numKeys; k++) keys.push_back(k);
+    if(dist == 1) std::random_shuffle(keys.begin(), keys.end());
+    createKeyRelation(relationName, keys);
+    BufMgr mgr(4096);
+    int low = 0, high = numKeys;
+    std::size_t scanned[2] = {0, 0};
+    double rate[2];
+    TreeStats stats;
+    {
+      BTreeIndex index(relationName, intIndexName, &mgr, offsetof(tuple,i), INTEGER, 1, 64 << 20);
+      stats = index.getTreeStats();
+      for(int pass = 0; pass < 2; pass++){
+        scanned[0] = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        index.startScan(&low, GTE, &high, LT);
+        try{
+          while(1){
+            RecordId rid;
+            index.scanNext(rid);
+            scanned[0]++;
+          }
+        }catch(const IndexScanCompletedException &e){
+        }
+        index.endScan();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        rate[0] = scanned[0] / elapsed.count();
+      }
+    }
+    File::remove(intIndexName);
+    {
+      CompressedIndex index(relationName, compressedName, &mgr, offsetof(tuple,i), INTEGER);
+      for(int pass = 0; pass < 2; pass++){
+        scanned[1] = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        index.startScan(&low, GTE, &high, LT);
+        try{
+          while(1){
+            RecordId rid;
+            index.scanNext(rid);
+            scanned[1]++;
+          }
+        }catch(const IndexScanCompletedException &e){
+        }
+        index.endScan();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        rate[1] = scanned[1] / elapsed.count();
+      }
+      std::cout << names[dist] << ": BTreeIndex " << stats.leafPages << " leaves, "
+                << (stats.leafPages + stats.nonLeafPages) * Page::SIZE / 1024 << " KB, " << (int)rate[0]
+                << " entries/s scanned; compressed " << index.numLeaves() << " leaves, "
+                << (index.numLeaves() + index.numNonLeaves()) * Page::SIZE / 1024 << " KB, " << (int)rate[1]
+                << " entries/s scanned" << std::endl;
+      checkPassFail((index.numLeaves() < stats.leafPages), true)
+    }
+    File::remove(compressedName);
+    checkPassFail(scanned[0], (std::size_t)numKeys)
+    checkPassFail(scanned[1], (std::size_t)numKeys)
+  }
+  File::remove(relationName);
+}
+
+void packedRidBenchmark(){
+  //leaves with 6-byte record ids: their order, the meta page, and the size of a tree of 10M keys
+  std::cout << "--------------------" << std::endl;
+  std::cout << "packed record ids" << std::endl;
+
+  //page numbers above 16 bits survive packing, equal keys are ordered by page then slot
+  RecordId rid = {0x12345678, 0xfedc, 0};
+  PackedRecordId packed;
+  packed = rid;
+  checkPassFail(sizeof(PackedRecordId), (std::size_t)6)
+  checkPassFail((RecordId(packed) == rid), true)
+  RIDKeyPair<int> first, second;
+  first.set(rid, 7);
+  rid.slot_number++;
+  second.set(rid, 7);
+  checkPassFail((first < second), true)
+  checkPassFail((second < first), false)
+
+  //the root survives reopening, appends only take keys above the largest one, other formats are refused
+  std::vector<int> keys;
+  for(int k = 0; k < 20000; k++) keys.push_back(k * 2);
+  std::random_shuffle(keys.begin(), keys.end());
+  createKeyRelation(relationName, keys);
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  }
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    RecordId out[4];
+    int wrong = 0;
+    for(int k = -1; k <= 40000; k++){
+      if(index.lookup(k, out, 4) != (std::size_t)(k >= 0 && k < 40000 && k % 2 == 0)) wrong++;
+    }
+    checkPassFail(wrong, 0)
+    RecordId newRid = {900000, 1, 0};
+    for(int k = 1; k < 2000; k += 2) index.insertEntry(&k, newRid);
+    for(int k = 40000; k < 42000; k++) index.insertEntry(&k, newRid);
+    wrong = 0;
+    for(int k = -1; k <= 42000; k++){
+      bool present = (k >= 0 && k < 40000 && k % 2 == 0) || (k < 2000 && k % 2 == 1) || k >= 40000;
+      if(index.lookup(k, out, 4) != (std::size_t)(present && k < 42000)) wrong++;
+    }
+    checkPassFail(wrong, 0)
+  }
+  {
+    BlobFile file(intIndexName, false);
+    Page meta = file.readPage(1);
+    reinterpret_cast<IndexMetaInfo*>(&meta)->formatVersion = INDEX_FORMAT_VERSION - 1;
+    file.writePage(1, meta);
+  }
+  bool refused = false;
+  try{
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  }catch(const BadIndexInfoException &e){
+    refused = true;
+  }
+  checkPassFail(refused, true)
+  File::remove(intIndexName);
+  File::remove(relationName);
+
+  //tree of 10M keys with heap pages past 16 bits, against the leaves 8-byte record ids would take
+  const int numKeys = 10000000;
+  std::vector<std::pair<int, RecordId> > entries;
+  entries.reserve(numKeys);
+  for(int k = 0; k < numKeys; k++){
+    RecordId entryRid = {(PageId)(k / 100 + 1), (SlotId)(k % 100 + 1), 0};
+    entries.push_back(std::make_pair(k, entryRid));
+  }
+  BufMgr mgr(4096);
+  {
+    BTreeIndex index(intIndexName, &mgr, offsetof(tuple,i));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    index.loadSorted(entries);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    TreeStats stats = index.getTreeStats();
+
+    const std::size_t unpackedFanout = (Page::SIZE - sizeof(PageId)) / (sizeof(int) + sizeof(RecordId));
+    std::size_t unpackedLeaves = (numKeys + unpackedFanout - 1) / unpackedFanout;
+    std::size_t unpackedPages = unpackedLeaves;
+    int unpackedHeight = 1;
+    for(std::size_t nodes = unpackedLeaves; nodes > 1 || unpackedHeight == 1; unpackedHeight++){
+      nodes = (nodes + INTARRAYNONLEAFSIZE) / (INTARRAYNONLEAFSIZE + 1);
+      unpackedPages += nodes;
+    }
+    std::cout << numKeys << " keys in " << elapsed.count() << " s: height " << stats.height << ", "
+              << stats.leafPages << " leaves of " << INTARRAYLEAFSIZE << ", "
+              << (stats.leafPages + stats.nonLeafPages) * Page::SIZE / (1024 * 1024) << " MB; 8-byte record ids: height "
+              << unpackedHeight << ", " << unpackedLeaves << " leaves of " << unpackedFanout << ", "
+              << unpackedPages * Page::SIZE / (1024 * 1024) << " MB" << std::endl;
+    checkPassFail(stats.leafPages, (numKeys + INTARRAYLEAFSIZE - 1) / (std::size_t)INTARRAYLEAFSIZE)
+    checkPassFail((stats.leafPages < unpackedLeaves), true)
+
+    RecordId out[4];
+    int wrong = 0;
+    for(int k = 0; k < numKeys; k += 9973){
+      if(index.lookup(k, out, 4) != 1 || out[0] != entries[k].second) wrong++;
+    }
+    checkPassFail(wrong, 0)
+  }
+  File::remove(intIndexName);
+}
+
+int openTlbCounter(){
+  //data TLB misses of this thread in user space, -1 if the machine exposes no such counter
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+long anonHugePagesKb(){
+  //transparent huge pages mapped by this process
+  std::ifstream in("/proc/self/smaps_rollup");
+  std::string field;
+  long kb = 0;
+  while(in >> field){
+    if(field == "AnonHugePages:"){
+      in >> kb;
+      break;
+    }
+  }
+  return kb;
+}
+
+void hugePageBenchmark(){
+  //probes through a pool backed by regular pages and through one backed by huge pages split across NUMA nodes
+  std::cout << "--------------------" << std::endl;
+  std::cout << "huge page buffer pool" << std::endl;
+  const std::string fileName = relationName + ".pool";
+  PoolOptions options;
+  options.huge_pages = true;
+  options.numa = true;
+
+  //the partitioned pool hands out every frame, runs out when all are pinned, and evicts like the plain one
+  {
+    BufMgr mgr(600, NULL, options);
+    checkPassFail((mgr.getNumPartitions() >= 1), true)
+    BlobFile file(fileName, true);
+    std::vector<PageId> pageNos(600);
+    for(int i = 0; i < 600; i++){
+      Page *page;
+      mgr.allocPage(&file, pageNos[i], page);
+      *reinterpret_cast<int*>(page) = i;
+    }
+    bool exceeded = false;
+    try{
+      PageId pageNo;
+      Page *page;
+      mgr.allocPage(&file, pageNo, page);
+    }catch(const BufferExceededException &e){
+      exceeded = true;
+    }
+    checkPassFail(exceeded, true)
+    for(int i = 0; i < 600; i++) mgr.unPinPage(&file, pageNos[i], true);
+    for(int i = 0; i < 600; i++){
+      PageId pageNo;
+      Page *page;
+      mgr.allocPage(&file, pageNo, page);
+      *reinterpret_cast<int*>(page) = 600 + i;
+      pageNos.push_back(pageNo);
+      mgr.unPinPage(&file, pageNo, true);
+    }
+    int wrong = 0;
+    for(int i = 0; i < 1200; i++){
+      Page *page;
+      mgr.readPage(&file, pageNos[i], page);
+      if(*reinterpret_cast<int*>(page) != i) wrong++;
+      mgr.unPinPage(&file, pageNos[i], false);
+    }
+    checkPassFail(wrong, 0)
+    mgr.flushFile(&file);
+  }
+  File::remove(fileName);
+
+  //a pool holding every page of a tree of 10M keys, probed at random keys
+  const int numKeys = 10000000;
+  const int numProbes = 2000000;
+  std::vector<std::pair<int, RecordId> > entries;
+  entries.reserve(numKeys);
+  for(int k = 0; k < numKeys; k++){
+    RecordId rid = {(PageId)(k / 100 + 1), (SlotId)(k % 100 + 1), 0};
+    entries.push_back(std::make_pair(k, rid));
+  }
+  std::vector<int> probes(numProbes);
+  srand(13);
+  for(int i = 0; i < numProbes; i++) probes[i] = ((long long)rand() * RAND_MAX + rand()) % numKeys;
+  const char *names[] = {"regular pages", "huge pages"};
+  const char *backings[] = {"small pages", "transparent huge pages", "huge pages"};
+  std::size_t hits[2];
+  for(int huge = 0; huge < 2; huge++){
+    BufMgr mgr(16384, NULL, huge ? options : PoolOptions());
+    {
+      BTreeIndex index(fileName, &mgr, offsetof(tuple,i));
+      index.loadSorted(entries);
+      RecordId out[2];
+      for(int k = 0; k < numKeys; k += 100) index.lookup(k, out, 2);
+
+      int counter = openTlbCounter();
+      if(counter >= 0){
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+      }
+      hits[huge] = 0;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for(int i = 0; i < numProbes; i++) hits[huge] += index.lookup(probes[i], out, 2);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << names[huge] << ": " << backings[mgr.getPoolBacking()] << ", " << mgr.getNumPartitions()
+                << " partitions, " << anonHugePagesKb() / 1024 << " MB in transparent huge pages, "
+                << elapsed.count() * 1e9 / numProbes << " ns/probe, ";
+      long long misses = 0;
+      if(counter >= 0 && read(counter, &misses, sizeof(misses)) == sizeof(misses)){
+        std::cout << (double)misses / numProbes << " dTLB misses/probe" << std::endl;
+      }else{
+        std::cout << "no dTLB miss counter" << std::endl;
+      }
+      if(counter >= 0) close(counter);
+    }
+    File::remove(fileName);
+  }
+  checkPassFail(hits[0], (std::size_t)numProbes)
+  checkPassFail(hits[1], (std::size_t)numProbes)
+}
+
+bool compareRids(const RecordId &a, const RecordId &b){
+  return a.slot_number < b.slot_number;
+}
+
+bool compareRidOrder(const RecordId &a, const RecordId &b){
+  if(a.page_number != b.page_number) return a.page_number < b.page_number;
+  return a.slot_number < b.slot_number;
+}
+
+bool compareEntryKeys(const std::pair<int, RecordId> &a, const std::pair<int, RecordId> &b){
+  return a.first < b.first;
+}
+
+void createKeyRelation(const std::string &name, const std::vector<int> &keys, const std::vector<double> &doubles){
+  //one tuple per key, in the given order; d is the key unless doubles are given
+  try{
+    File::remove(name);
+  }catch(const FileNotFoundException &e){
+  }
+  PageFile file(name, true);
+  memset(record1.s, ' ', sizeof(record1.s));
+  PageId new_page_number;
+  Page new_page = file.allocatePage(new_page_number);
+  for(std::size_t i = 0; i < keys.size(); i++){
+    record1.i = keys[i];
+    record1.d = doubles.empty() ? keys[i] : doubles[i];
+    while(1){
+      try{
+        new_page.insertRecord(reinterpret_cast<char*>(&record1), sizeof(record1));
+        break;
+      }catch(const InsufficientSpaceException &e){
+        file.writePage(new_page_number, new_page);
+        new_page = file.allocatePage(new_page_number);
+      }
+    }
+  }
+  file.writePage(new_page_number, new_page);
+}
+
+std::size_t probeJoin(const std::string &outerName, const std::string &innerName, BTreeIndex *index){
+  //the hand-written join: an index scan for every outer tuple and a pin for every inner record
+  PageFile *inner = new PageFile(innerName, false);
+  std::size_t pairs = 0;
+  {
+    FileScan scan(outerName, bufMgr);
+    try{
+      RecordId outerRid;
+      while(1){
+        scan.scanNext(outerRid);
+        int key = reinterpret_cast<const RECORD*>(scan.getRecordView().data)->i;
+        try{
+          index->startScan(&key, GTE, &key, LTE);
+        }catch(const NoSuchKeyFoundException &e){
+          continue;
+        }
+        try{
+          while(1){
+            RecordId innerRid;
+            Page *page;
+            index->scanNext(innerRid);
+            bufMgr->readPage(inner, innerRid.page_number, page);
+            std::string record = page->getRecord(innerRid);
+            bufMgr->unPinPage(inner, innerRid.page_number, false);
+            if(reinterpret_cast<const RECORD*>(record.data())->i == key) pairs++;
+          }
+        }catch(const IndexScanCompletedException &e){
+        }
+        index->endScan();
+      }
+    }catch(const EndOfFileException &e){
+    }
+  }
+  bufMgr->flushFile(inner);
+  delete inner;
+  return pairs;
+}
+
+int walVerify(const std::string &name){
+  //returns the number of data tuples if they are exactly 0..counter-1, -1 otherwise
+  std::ifstream raw(name.c_str(), std::ios::binary | std::ios::ate);
+  if(!raw || raw.tellg() < (std::streamoff)Page::SIZE) return 0;
+  raw.close();
+
+  BufMgr mgr(10);
+  std::vector<int> values;
+  int counter = 0;
+  {
+    FileScan fscan(name, &mgr);
+    try{
+      RecordId scanRid;
+      while(1){
+        fscan.scanNext(scanRid);
+        std::string recordStr = fscan.getRecord();
+        if(recordStr.size() != sizeof(WALRECORD)) return -1;
+        const WALRECORD *rec = reinterpret_cast<const WALRECORD*>(recordStr.data());
+        if(rec->tag == 0){
+          counter = rec->value;
+        }else{
+          values.push_back(rec->value);
+        }
+      }
+    }catch(const EndOfFileException &e){
+    }
+  }
+  std::sort(values.begin(), values.end());
+  if((int)values.size() != counter) return -1;
+  for(size_t i = 0; i < values.size(); i++){
+    if(values[i] != (int)i) return -1;
+  }
+  return counter;
+}
+
 // -----------------------------------------------------------------------------
 // createRelationForward
 // -----------------------------------------------------------------------------
@@ -266,6 +2956,7 @@ void createRelationForward()
   memset(record1.s, ' ', sizeof(record1.s));
 	PageId new_page_number;
   Page new_page = file1->allocatePage(new_page_number);
+  if(paxRelation) paxFormat(new_page);
 
   // Insert a bunch of tuples into the relation.
   for(int i = 0; i < relationSize; i++ )
@@ -286,6 +2977,7 @@ void createRelationForward()
 			{
 				file1->writePage(new_page_number, new_page);
   			new_page = file1->allocatePage(new_page_number);
+				if(paxRelation) paxFormat(new_page);
 			}
 		}
   }
@@ -562,6 +3254,38 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 	return numResults;
 }
 
+int intCount(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+  //Like intScan but only counts the rids, so the index may hold rids that do not point at records
+  RecordId scanRid;
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+			break;
+		}
+		numResults++;
+	}
+  index->endScan();
+
+	return numResults;
+}
+
 // -----------------------------------------------------------------------------
 // errorTests
 // -----------------------------------------------------------------------------
@@ -5,12 +5,15 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include <iostream>
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
 #include "exceptions/invalid_slot_exception.h"
+#include "exceptions/page_layout_exception.h"
 #include "exceptions/slot_in_use_exception.h"
 #include "page_iterator.h"
 #include "page.h"
@@ -27,45 +30,220 @@ void Page::initialize() {
   header_.free_space_upper_bound = DATA_SIZE;
   header_.num_slots = 0;
   header_.num_free_slots = 0;
+  header_.fragmented_space = 0;
+  header_.hole_offset = 0;
+  header_.hole_length = 0;
+  header_.layout = ROW_LAYOUT;
+  std::memset(header_.used_slots, 0, sizeof(header_.used_slots));
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
+  header_.page_lsn = 0;
   //data_.assign(DATA_SIZE, char());
 	memset(data_, '\0', DATA_SIZE);
 }
 
+void Page::initializePax(const std::size_t record_length,
+                         const std::vector<PaxColumn>& columns) {
+  if (header_.num_slots != 0) {
+    throw PageLayoutException(page_number(), "page is not empty.");
+  }
+  if (columns.empty() || columns.size() > PaxHeader::MAX_COLUMNS) {
+    throw PageLayoutException(page_number(), "wrong number of columns.");
+  }
+  std::size_t stored_length = 0;
+  for (std::size_t i = 0; i < columns.size(); ++i) {
+    if (columns[i].width == 0 ||
+        columns[i].record_offset + columns[i].width > record_length) {
+      throw PageLayoutException(page_number(), "column outside the record.");
+    }
+    stored_length += columns[i].width;
+  }
+  // Every minipage starts on an 8-byte boundary so that values can be read
+  // in place as their type.
+  const std::size_t first_minipage = (sizeof(PaxHeader) + 7) & ~std::size_t(7);
+  const std::size_t capacity = std::min<std::size_t>(
+      (DATA_SIZE - first_minipage - 7 * columns.size()) / stored_length,
+      PageHeader::MAX_SLOTS);
+  if (capacity == 0) {
+    throw PageLayoutException(page_number(), "record does not fit the page.");
+  }
+
+  PaxHeader* pax = paxHeader();
+  pax->record_length = record_length;
+  pax->num_columns = columns.size();
+  pax->capacity = capacity;
+  std::size_t offset = first_minipage;
+  for (std::size_t i = 0; i < columns.size(); ++i) {
+    pax->columns[i] = columns[i];
+    pax->columns[i].minipage_offset = offset;
+    offset += (columns[i].width * capacity + 7) & ~std::size_t(7);
+  }
+  header_.layout = PAX_LAYOUT;
+}
+
+bool Page::findColumn(const std::size_t record_offset,
+                      std::size_t& column) const {
+  if (!isPax()) {
+    return false;
+  }
+  const PaxHeader* pax = paxHeader();
+  for (std::size_t i = 0; i < pax->num_columns; ++i) {
+    if (pax->columns[i].record_offset == record_offset) {
+      column = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+ColumnView Page::getColumn(const std::size_t column) const {
+  if (!isPax() || column >= paxHeader()->num_columns) {
+    throw PageLayoutException(page_number(), "no such column.");
+  }
+  const PaxColumn& pax_column = paxHeader()->columns[column];
+  const ColumnView view = {page_number(), &data_[pax_column.minipage_offset],
+                           pax_column.width, header_.num_slots,
+                           header_.used_slots};
+  return view;
+}
+
+std::size_t Page::gatherAttribute(const std::size_t record_offset,
+                                  const std::size_t width, char* values,
+                                  SlotId* slots) const {
+  // On a PAX page the attribute is read from the minipage of the column
+  // holding it, which may be wider than the attribute.
+  const char* minipage = NULL;
+  std::size_t stride = 0;
+  if (isPax()) {
+    const PaxHeader* pax = paxHeader();
+    for (std::size_t i = 0; i < pax->num_columns; ++i) {
+      const PaxColumn& column = pax->columns[i];
+      if (column.record_offset <= record_offset &&
+          record_offset + width <= column.record_offset + column.width) {
+        minipage = &data_[column.minipage_offset + record_offset -
+                          column.record_offset];
+        stride = column.width;
+        break;
+      }
+    }
+    if (minipage == NULL) {
+      throw PageLayoutException(page_number(), "no column holds the attribute.");
+    }
+  }
+
+  std::size_t count = 0;
+  for (SlotId i = getNextUsedSlot(INVALID_SLOT); i != INVALID_SLOT;
+       i = getNextUsedSlot(i)) {
+    const char* value;
+    if (minipage != NULL) {
+      value = minipage + (i - 1) * stride;
+    } else {
+      const PageSlot& slot = getSlot(i);
+      if (record_offset + width > slot.item_length) {
+        continue;
+      }
+      value = &data_[slot.item_offset + record_offset];
+    }
+    std::memcpy(&values[count * width], value, width);
+    slots[count] = i;
+    ++count;
+  }
+  return count;
+}
+
 RecordId Page::insertRecord(const std::string& record_data) {
-  if (!hasSpaceForRecord(record_data)) {
+  return insertRecord(record_data.data(), record_data.length());
+}
+
+RecordId Page::insertRecord(const char* record_data,
+                            const std::size_t record_length) {
+  if (isPax()) {
+    return insertPaxRecord(record_data, record_length);
+  }
+  if (!hasSpaceForRecord(record_length)) {
     throw InsufficientSpaceException(
-        page_number(), record_data.length(), getFreeSpace());
+        page_number(), record_length, getFreeSpace());
+  }
+  // A new slot grows the slot array into the free space.
+  if (header_.num_free_slots == 0) {
+    reserveContiguousSpace(sizeof(PageSlot));
   }
   const SlotId slot_number = getAvailableSlot();
-  insertRecordInSlot(slot_number, record_data);
+  insertRecordInSlot(slot_number, record_data, record_length);
   return {page_number(), slot_number};
 }
 
 std::string Page::getRecord(const RecordId& record_id) const {
+  std::string record;
+  return getRecordView(record_id, record).toString();
+}
+
+RecordView Page::getRecordView(const RecordId& record_id) const {
+  if (isPax()) {
+    throw PageLayoutException(page_number(),
+                              "PAX records are not stored in one piece.");
+  }
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-	std::string retStr = std::string(data_, DATA_SIZE).substr(slot.item_offset, slot.item_length);
+  const RecordView view = {&data_[slot.item_offset], slot.item_length};
+  return view;
+}
 
-	return retStr;
+RecordView Page::getRecordView(const RecordId& record_id,
+                               std::string& scratch) const {
+  if (!isPax()) {
+    return getRecordView(record_id);
+  }
+  // Reassemble the record from its columns.
+  validateRecordId(record_id);
+  const PaxHeader* pax = paxHeader();
+  scratch.assign(pax->record_length, '\0');
+  for (std::size_t i = 0; i < pax->num_columns; ++i) {
+    const PaxColumn& column = pax->columns[i];
+    std::memcpy(&scratch[column.record_offset],
+                &data_[column.minipage_offset +
+                       (record_id.slot_number - 1) * column.width],
+                column.width);
+  }
+  const RecordView view = {scratch.data(), scratch.length()};
+  return view;
 }
 
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
+  updateRecord(record_id, record_data.data(), record_data.length());
+}
+
+void Page::updateRecord(const RecordId& record_id, const char* record_data,
+                        const std::size_t record_length) {
   validateRecordId(record_id);
-  const PageSlot* slot = getSlot(record_id.slot_number);
+  if (isPax()) {
+    if (record_length != paxHeader()->record_length) {
+      throw PageLayoutException(page_number(), "wrong record length.");
+    }
+    writePaxRecord(record_id.slot_number, record_data);
+    return;
+  }
+  PageSlot* slot = getSlot(record_id.slot_number);
+  if (record_length <= slot->item_length) {
+    // The record keeps its place on the page; bytes it no longer needs are
+    // left for the next compaction.
+    std::memmove(&data_[slot->item_offset], record_data, record_length);
+    header_.fragmented_space += slot->item_length - record_length;
+    slot->item_length = record_length;
+    return;
+  }
   const std::size_t free_space_after_delete =
       getFreeSpace() + slot->item_length;
-  if (record_data.length() > free_space_after_delete) {
+  if (record_length > free_space_after_delete) {
     throw InsufficientSpaceException(
-        page_number(), record_data.length(), free_space_after_delete);
+        page_number(), record_length, free_space_after_delete);
   }
   // We have to disallow slot compaction here because we're going to place the
   // record data in the same slot, and compaction might delete the slot if we
   // permit it.
   deleteRecord(record_id, false /* allow_slot_compaction */);
-  insertRecordInSlot(record_id.slot_number, record_data);
+  insertRecordInSlot(record_id.slot_number, record_data, record_length);
 }
 
 void Page::deleteRecord(const RecordId& record_id) {
@@ -75,60 +253,45 @@ void Page::deleteRecord(const RecordId& record_id) {
 void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
-  PageSlot* slot = getSlot(record_id.slot_number);
-
-	for(int i = 0; i < slot->item_length; i++)
-		data_[i + slot->item_offset] = '\0';
-
-  //data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
-
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset; 
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot* other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
-      }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
+  if (isPax()) {
+    writePaxRecord(record_id.slot_number, NULL);
+    setSlotUsed(record_id.slot_number, false);
+    ++header_.num_free_slots;
+    if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
+      const SlotId last_used = getLastUsedSlot();
+      header_.num_free_slots -= header_.num_slots - last_used;
+      header_.num_slots = last_used;
     }
+    return;
   }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string& data_to_move = std::string(data_, DATA_SIZE).substr(move_offset, move_bytes);
+  PageSlot* slot = getSlot(record_id.slot_number);
 
-		for(std::uint16_t i = 0; i < move_bytes; i++)
-			data_[i + move_offset + slot->item_length] = data_to_move[i];
+  std::memset(&data_[slot->item_offset], '\0', slot->item_length);
 
-    //data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+  // The data is not compacted here.  A record next to the free space just
+  // gives its bytes back; any other leaves a hole until an insert needs it.
+  if (slot->item_offset == header_.free_space_upper_bound) {
+    header_.free_space_upper_bound += slot->item_length;
+  } else {
+    header_.fragmented_space += slot->item_length;
+    if (slot->item_length >= header_.hole_length) {
+      header_.hole_offset = slot->item_offset;
+      header_.hole_length = slot->item_length;
+    }
   }
-  header_.free_space_upper_bound += slot->item_length;
 
   // Mark slot as unused.
-  slot->used = false;
+  setSlotUsed(record_id.slot_number, false);
   slot->item_offset = 0;
   slot->item_length = 0;
   ++header_.num_free_slots;
 
   if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
     // Last slot in the list, so we need to free any unused slots that are at
-    // the end of the slot list.
-    int num_slots_to_delete = 1;
-    for (SlotId i = 1; i < header_.num_slots; ++i) {
-      // Traverse list backwards, looking for unused slots.
-      const PageSlot* other_slot = getSlot(header_.num_slots - i);
-      if (!other_slot->used) {
-        ++num_slots_to_delete;
-      } else {
-        // Stop at the first used slot we find, since we can't move used slots
-        // without affecting record IDs.
-        break;
-      }
-    }
+    // the end of the slot list.  We can't move used slots without affecting
+    // record IDs, so the list ends after the last used slot.
+    const SlotId last_used = getLastUsedSlot();
+    const int num_slots_to_delete = header_.num_slots - last_used;
     header_.num_slots -= num_slots_to_delete;
     header_.num_free_slots -= num_slots_to_delete;
     header_.free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
@@ -136,13 +299,39 @@ void Page::deleteRecord(const RecordId& record_id,
 }
 
 bool Page::hasSpaceForRecord(const std::string& record_data) const {
-  std::size_t record_size = record_data.length();
+  return hasSpaceForRecord(record_data.length());
+}
+
+bool Page::hasSpaceForRecord(const std::size_t record_length) const {
+  if (isPax()) {
+    return record_length == paxHeader()->record_length &&
+        header_.num_slots - header_.num_free_slots < paxHeader()->capacity;
+  }
+  std::size_t record_size = record_length;
   if (header_.num_free_slots == 0) {
+    if (header_.num_slots >= PageHeader::MAX_SLOTS) {
+      return false;
+    }
     record_size += sizeof(PageSlot);
   }
   return record_size <= getFreeSpace();
 }
 
+std::uint16_t Page::getFreeSpace() const {
+  if (isPax()) {
+    // Bytes left in the minipages.
+    const PaxHeader* pax = paxHeader();
+    std::size_t stored_length = 0;
+    for (std::size_t i = 0; i < pax->num_columns; ++i) {
+      stored_length += pax->columns[i].width;
+    }
+    return (pax->capacity - (header_.num_slots - header_.num_free_slots)) *
+        stored_length;
+  }
+  return header_.free_space_upper_bound - header_.free_space_lower_bound +
+      header_.fragmented_space;
+}
+
 PageSlot* Page::getSlot(const SlotId slot_number) {
   return reinterpret_cast<PageSlot*>(&data_[(slot_number - 1) * sizeof(PageSlot)]);
 }
@@ -154,13 +343,12 @@ const PageSlot& Page::getSlot(const SlotId slot_number) const {
 SlotId Page::getAvailableSlot() {
   SlotId slot_number = INVALID_SLOT;
   if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
-      const PageSlot* slot = getSlot(i);
-      if (!slot->used) {
-        // We don't decrement the number of free slots until someone actually
-        // puts data in the slot.
-        slot_number = i;
+    // Have an allocated but unused slot that we can reuse: the first clear
+    // bit of the bitmap.  We don't decrement the number of free slots until
+    // someone actually puts data in the slot.
+    for (std::size_t word = 0; word < PageHeader::MAX_SLOTS / 64; ++word) {
+      if (~header_.used_slots[word] != 0) {
+        slot_number = word * 64 + __builtin_ctzll(~header_.used_slots[word]) + 1;
         break;
       }
     }
@@ -176,38 +364,144 @@ SlotId Page::getAvailableSlot() {
 }
 
 void Page::insertRecordInSlot(const SlotId slot_number,
-                              const std::string& record_data) {
+                              const char* record_data,
+                              const std::size_t record_length) {
   if (slot_number > header_.num_slots ||
       slot_number == INVALID_SLOT) {
     throw InvalidSlotException(page_number(), slot_number);
   }
   PageSlot* slot = getSlot(slot_number);
-  if (slot->used) {
+  if (isSlotUsed(slot_number)) {
     throw SlotInUseException(page_number(), slot_number);
   }
-  const int record_length = record_data.length();
-  slot->used = true;
+  // Placing the record may compact the page, which moves every used slot;
+  // this one must not count as used until it has its offset.
+  slot->item_offset = placeRecord(record_length);
   slot->item_length = record_length;
-  slot->item_offset = header_.free_space_upper_bound - record_length;
-  header_.free_space_upper_bound = slot->item_offset;
+  setSlotUsed(slot_number, true);
   --header_.num_free_slots;
 
-	for(int i = 0; i < slot->item_length; i++)
-		data_[i + slot->item_offset] = record_data[i];
-
-  //data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(&data_[slot->item_offset], record_data, record_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
   if (record_id.page_number != page_number()) {
     throw InvalidRecordException(record_id, page_number());
   }
-  const PageSlot& slot = getSlot(record_id.slot_number);
-  if (!slot.used) {
+  if (record_id.slot_number == INVALID_SLOT ||
+      record_id.slot_number > header_.num_slots ||
+      !isSlotUsed(record_id.slot_number)) {
     throw InvalidRecordException(record_id, page_number());
   }
 }
 
+SlotId Page::getNextUsedSlot(const SlotId start) const {
+  // Bit <start> stands for the slot after <start>.
+  std::size_t bit = start;
+  while (bit < header_.num_slots) {
+    const std::uint64_t word = header_.used_slots[bit / 64] >> (bit % 64);
+    if (word != 0) {
+      bit += __builtin_ctzll(word);
+      return bit < header_.num_slots ? bit + 1 : INVALID_SLOT;
+    }
+    bit = (bit / 64 + 1) * 64;
+  }
+  return INVALID_SLOT;
+}
+
+SlotId Page::getLastUsedSlot() const {
+  for (int word = (header_.num_slots - 1) / 64; word >= 0; --word) {
+    if (header_.used_slots[word] != 0) {
+      return word * 64 + 64 - __builtin_clzll(header_.used_slots[word]);
+    }
+  }
+  return INVALID_SLOT;
+}
+
+RecordId Page::insertPaxRecord(const char* record_data,
+                               const std::size_t record_length) {
+  if (record_length != paxHeader()->record_length) {
+    throw PageLayoutException(page_number(), "wrong record length.");
+  }
+  if (!hasSpaceForRecord(record_length)) {
+    throw InsufficientSpaceException(
+        page_number(), record_length, getFreeSpace());
+  }
+  // The minipages have room for every slot up to the capacity, so the first
+  // clear bit is either a free slot or the one after the last slot.
+  SlotId slot_number = INVALID_SLOT;
+  for (std::size_t word = 0; word < PageHeader::MAX_SLOTS / 64; ++word) {
+    if (~header_.used_slots[word] != 0) {
+      slot_number = word * 64 + __builtin_ctzll(~header_.used_slots[word]) + 1;
+      break;
+    }
+  }
+  if (slot_number > header_.num_slots) {
+    header_.num_slots = slot_number;
+  } else {
+    --header_.num_free_slots;
+  }
+  setSlotUsed(slot_number, true);
+  writePaxRecord(slot_number, record_data);
+  return {page_number(), slot_number};
+}
+
+void Page::writePaxRecord(const SlotId slot_number, const char* record_data) {
+  const PaxHeader* pax = paxHeader();
+  for (std::size_t i = 0; i < pax->num_columns; ++i) {
+    const PaxColumn& column = pax->columns[i];
+    char* value =
+        &data_[column.minipage_offset + (slot_number - 1) * column.width];
+    if (record_data != NULL) {
+      std::memcpy(value, record_data + column.record_offset, column.width);
+    } else {
+      std::memset(value, 0, column.width);
+    }
+  }
+}
+
+void Page::reserveContiguousSpace(const std::size_t length) {
+  if (static_cast<std::size_t>(header_.free_space_upper_bound -
+                               header_.free_space_lower_bound) < length) {
+    compact();
+  }
+}
+
+std::uint16_t Page::placeRecord(const std::size_t length) {
+  if (static_cast<std::size_t>(header_.free_space_upper_bound -
+                               header_.free_space_lower_bound) < length &&
+      header_.hole_length >= length) {
+    const std::uint16_t offset = header_.hole_offset;
+    header_.hole_offset += length;
+    header_.hole_length -= length;
+    header_.fragmented_space -= length;
+    return offset;
+  }
+  reserveContiguousSpace(length);
+  header_.free_space_upper_bound -= length;
+  return header_.free_space_upper_bound;
+}
+
+void Page::compact() {
+  // Records are packed in slot order into a scratch copy and copied back in
+  // one piece; their order on the page does not matter.
+  char packed[DATA_SIZE];
+  std::uint16_t upper_bound = DATA_SIZE;
+  for (SlotId i = getNextUsedSlot(INVALID_SLOT); i != INVALID_SLOT;
+       i = getNextUsedSlot(i)) {
+    PageSlot* slot = getSlot(i);
+    upper_bound -= slot->item_length;
+    std::memcpy(&packed[upper_bound], &data_[slot->item_offset],
+                slot->item_length);
+    slot->item_offset = upper_bound;
+  }
+  std::memcpy(&data_[upper_bound], &packed[upper_bound],
+              DATA_SIZE - upper_bound);
+  header_.free_space_upper_bound = upper_bound;
+  header_.fragmented_space = 0;
+  header_.hole_length = 0;
+}
+
 PageIterator Page::begin() {
   return PageIterator(this);
 }
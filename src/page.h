@@ -11,12 +11,30 @@
 #include <stdint.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 //#include <gtest/gtest.h>
 #include "types.h"
 
 namespace badgerdb {
 
+/**
+ * @brief Ways a page can arrange the records it holds.
+ */
+enum PageLayout {
+  /**
+   * Slotted page: a slot array at the start of the data area and whole
+   * records at its end.
+   */
+  ROW_LAYOUT = 0,
+
+  /**
+   * PAX page: fixed-length records split by attribute, each attribute stored
+   * for all records of the page in a minipage of its own.
+   */
+  PAX_LAYOUT = 1
+};
+
 /**
  * @brief Header metadata in a page.
  *
@@ -24,6 +42,12 @@ namespace badgerdb {
  * contains a pointer to the next page in the file.
  */
 struct PageHeader {
+  /**
+   * Most slots a page can have.  Bounds the used-slot bitmap; only records of
+   * less than four bytes can fill a page up to it.
+   */
+  static const SlotId MAX_SLOTS = 1024;
+
   /**
    * Lower bound of the free space.  This is the offset of the first unused byte
    * after the slot array.
@@ -48,6 +72,29 @@ struct PageHeader {
    */
   SlotId num_free_slots;
 
+  /**
+   * Bytes of deleted records left between other records.  They count as free
+   * space but are only reclaimed by compacting the page once an insert needs
+   * them.
+   */
+  std::uint16_t fragmented_space;
+
+  /**
+   * Offset of the largest hole left by a deleted record since the page was
+   * last compacted.  Inserts fill it before they resort to compaction.
+   */
+  std::uint16_t hole_offset;
+
+  /**
+   * Length of that hole, zero if there is none.
+   */
+  std::uint16_t hole_length;
+
+  /**
+   * PageLayout of the page.
+   */
+  std::uint16_t layout;
+
   /**
    * Number of the page within the file.
    */
@@ -58,6 +105,17 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * LSN of the last logged change the buffer manager applied to this page.
+   * Zero if the page was never changed while a log was attached.
+   */
+  Lsn page_lsn;
+
+  /**
+   * Bitmap of the slots in use; bit i stands for slot i + 1.
+   */
+  std::uint64_t used_slots[MAX_SLOTS / 64];
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -76,12 +134,6 @@ struct PageHeader {
  * @brief Slot metadata that tracks where a record is in the data space.
  */
 struct PageSlot {
-  /**
-   * Whether the slot currently holds data.  May be false if this slot's
-   * record has been deleted after insertion.
-   */
-  bool used;
-
   /**
    * Offset of the data item in the page.
    */
@@ -93,6 +145,134 @@ struct PageSlot {
   std::uint16_t item_length;
 };
 
+/**
+ * @brief Attribute of the records on a PAX page: a byte range of every record,
+ * stored in a minipage of its own.
+ */
+struct PaxColumn {
+  /**
+   * Offset of the attribute in the record.
+   */
+  std::uint16_t record_offset;
+
+  /**
+   * Length of the attribute in bytes.
+   */
+  std::uint16_t width;
+
+  /**
+   * Offset of the minipage in the data area of the page.  Assigned by the
+   * page when it is formatted.
+   */
+  std::uint16_t minipage_offset;
+};
+
+/**
+ * @brief Layout metadata at the start of the data area of a PAX page.
+ */
+struct PaxHeader {
+  /**
+   * Most attributes a PAX page can store.
+   */
+  static const std::size_t MAX_COLUMNS = 8;
+
+  /**
+   * Length of every record on the page.  Bytes of a record outside all of the
+   * columns are not stored and read back as zero.
+   */
+  std::uint16_t record_length;
+
+  /**
+   * Number of columns.
+   */
+  std::uint16_t num_columns;
+
+  /**
+   * Number of records the minipages have room for.
+   */
+  std::uint16_t capacity;
+
+  /**
+   * The columns, in the order they were given.
+   */
+  PaxColumn columns[MAX_COLUMNS];
+};
+
+/**
+ * @brief Non-owning view of one column of a PAX page.
+ *
+ * The value of the record in slot s starts at data + (s - 1) * width.  Slots
+ * that hold no record have zero values.  Like a RecordView, the view is valid
+ * only while the page stays pinned and unchanged.
+ */
+struct ColumnView {
+  /**
+   * Page the column belongs to.
+   */
+  PageId page_number;
+
+  /**
+   * First byte of the minipage.
+   */
+  const char* data;
+
+  /**
+   * Length of each value in bytes.
+   */
+  std::size_t width;
+
+  /**
+   * Number of slots the minipage covers, used or not.
+   */
+  SlotId num_slots;
+
+  /**
+   * Used-slot bitmap of the page; bit i stands for slot i + 1.
+   */
+  const std::uint64_t* used_slots;
+
+  /**
+   * Returns true if the given slot holds a record.
+   *
+   * @param slot_number   Slot between 1 and num_slots.
+   */
+  bool isUsed(const SlotId slot_number) const {
+    return (used_slots[(slot_number - 1) / 64] >> ((slot_number - 1) % 64)) & 1;
+  }
+
+  /**
+   * Returns the minipage as an array of values of the given type.
+   */
+  template <typename T>
+  const T* values() const { return reinterpret_cast<const T*>(data); }
+};
+
+/**
+ * @brief Non-owning view of the bytes of a record stored on a page.
+ *
+ * The view points into the page itself, so it stays valid only while the page
+ * is pinned in the buffer pool and the record is not updated, deleted or moved
+ * by a change to the page.  Use toString to keep a copy.
+ */
+struct RecordView {
+  /**
+   * First byte of the record.
+   */
+  const char* data;
+
+  /**
+   * Length of the record in bytes.
+   */
+  std::size_t length;
+
+  /**
+   * Returns a copy of the record.
+   *
+   * @return  Bytes of the record.
+   */
+  std::string toString() const { return std::string(data, length); }
+};
+
 class PageIterator;
 
 /**
@@ -103,6 +283,10 @@ class PageIterator;
  * slots and identified by a RecordId.  Although a record's actual contents may
  * be moved on the page, accessing a record by its slot is consistent.
  *
+ * A page is a slotted page unless it is turned into a PAX page with
+ * initializePax, which splits fixed-length records into one minipage per
+ * attribute so that scans of an attribute read a contiguous array.
+ *
  * @warning This class is not threadsafe.
  */
 class Page {
@@ -133,6 +317,62 @@ class Page {
    */
   Page();
 
+  /**
+   * Turns this empty page into a PAX page for records of the given length,
+   * with one minipage per column.  The page then only takes records of that
+   * length.
+   *
+   * @param record_length  Length of every record.
+   * @param columns        Byte ranges of the records to store; their minipage
+   *                       offsets are ignored.
+   * @throws  PageLayoutException  If the page holds records or the columns do
+   *                               not fit the record length.
+   */
+  void initializePax(const std::size_t record_length,
+                     const std::vector<PaxColumn>& columns);
+
+  /**
+   * Returns true if this is a PAX page.
+   */
+  bool isPax() const { return header_.layout == PAX_LAYOUT; }
+
+  /**
+   * Looks up the column of a PAX page that starts at the given record offset.
+   *
+   * @param record_offset  Offset of the attribute in the record.
+   * @param column         Set to the index of the column if there is one.
+   * @return  True if this is a PAX page with such a column.
+   */
+  bool findColumn(const std::size_t record_offset, std::size_t& column) const;
+
+  /**
+   * Returns a view of one column of a PAX page, without copying it.
+   *
+   * @param column  Index of the column.
+   * @return  View of the minipage of the column.
+   * @throws  PageLayoutException  If this is not a PAX page or it has no such
+   *                               column.
+   */
+  ColumnView getColumn(const std::size_t column) const;
+
+  /**
+   * Copies an attribute of every record on the page into an array, in slot
+   * order, so that a predicate can be evaluated over all of them at once.
+   * Records too short to hold the attribute are left out.
+   *
+   * @param record_offset  Offset of the attribute in the records.
+   * @param width          Length of the attribute in bytes.
+   * @param values         Room for PageHeader::MAX_SLOTS values of that width.
+   * @param slots          Room for PageHeader::MAX_SLOTS slot numbers; set to
+   *                       the slot each value comes from.
+   * @return  Number of values copied.
+   * @throws  PageLayoutException  If this is a PAX page and no column holds
+   *                               the attribute.
+   */
+  std::size_t gatherAttribute(const std::size_t record_offset,
+                              const std::size_t width, char* values,
+                              SlotId* slots) const;
+
   /**
    * Inserts a new record into the page.
    *
@@ -141,6 +381,16 @@ class Page {
    */
   RecordId insertRecord(const std::string& record_data);
 
+  /**
+   * Inserts a new record into the page, copying it straight from the given
+   * bytes.
+   *
+   * @param record_data    Bytes that compose the record.
+   * @param record_length  Number of bytes in the record.
+   * @return  ID of the newly inserted record.
+   */
+  RecordId insertRecord(const char* record_data, const std::size_t record_length);
+
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
    * stored on the page; use updateRecord to change it.
@@ -151,6 +401,30 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns a view of the record with the given ID without copying it.  The
+   * view is valid as long as the page stays pinned and unchanged.  PAX pages
+   * do not keep records in one piece; use getRecord or getColumn for them.
+   *
+   * @param record_id  ID of the record to return.
+   * @return  View of the record on the page.
+   * @throws  PageLayoutException  If this is a PAX page.
+   */
+  RecordView getRecordView(const RecordId& record_id) const;
+
+  /**
+   * Returns a view of the record with the given ID on a page of either
+   * layout.  A record of a slotted page is viewed in place; a PAX record is
+   * reassembled into scratch, which the view then points into.
+   *
+   * @param record_id  ID of the record to return.
+   * @param scratch    Buffer a PAX record is reassembled in.
+   * @return  View of the record, valid as long as the page stays pinned and
+   *          unchanged and scratch is not modified.
+   */
+  RecordView getRecordView(const RecordId& record_id,
+                           std::string& scratch) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
@@ -162,9 +436,21 @@ class Page {
   void updateRecord(const RecordId& record_id, const std::string& record_data);
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array.
+   * Updates the record with the given ID from the given bytes.  A record of
+   * the same length is overwritten in place; otherwise this is equivalent to
+   * deleting the old record and inserting a new one in the same slot.
+   *
+   * @param record_id      ID of record to update.
+   * @param record_data    Updated bytes that compose the record.
+   * @param record_length  Number of bytes in the record.
+   */
+  void updateRecord(const RecordId& record_id, const char* record_data,
+                    const std::size_t record_length);
+
+  /**
+   * Deletes the record with the given ID.  The space of the record is
+   * reclaimed by compacting the page the next time an insert needs it.  Slot
+   * array is compacted if the slot deleted is at the end of the slot array.
    *
    * @param record_id   ID of the record to delete.
    */
@@ -178,13 +464,21 @@ class Page {
    */
   bool hasSpaceForRecord(const std::string& record_data) const;
 
+  /**
+   * Returns true if the page has enough free space to hold a record of the
+   * given length.
+   *
+   * @param record_length Number of bytes in the record.
+   * @return  Whether the page can hold the record.
+   */
+  bool hasSpaceForRecord(const std::size_t record_length) const;
+
   /**
    * Returns this page's free space in bytes.
    *
    * @return  Free space in bytes.
    */
-  std::uint16_t getFreeSpace() const { return header_.free_space_upper_bound -
-                                              header_.free_space_lower_bound; }
+  std::uint16_t getFreeSpace() const;
 
   /**
    * Returns this page's number in its file.
@@ -200,6 +494,13 @@ class Page {
    */
   PageId next_page_number() const { return header_.next_page_number; }
 
+  /**
+   * Returns the LSN of the last logged change to this page.
+   *
+   * @return  Page LSN.
+   */
+  Lsn page_lsn() const { return header_.page_lsn; }
+
   /**
    * Returns an iterator at the first record in the page.
    *
@@ -240,10 +541,18 @@ class Page {
   }
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array and
-   * <allow_slot_compaction> is set.
+   * Sets the LSN of the last logged change to this page.
+   *
+   * @param new_page_lsn  LSN of the log record.
+   */
+  void set_page_lsn(const Lsn new_page_lsn) {
+    header_.page_lsn = new_page_lsn;
+  }
+
+  /**
+   * Deletes the record with the given ID.  Slot array is compacted if the slot
+   * deleted is at the end of the slot array and <allow_slot_compaction> is
+   * set.
    *
    * @param record_id             ID of the record to delete.
    * @param allow_slot_compaction If true, the slot array will be compacted if
@@ -272,6 +581,94 @@ class Page {
    */
   const PageSlot& getSlot(const SlotId slot_number) const;
 
+  /**
+   * Returns true if the slot with the given number holds a record.
+   *
+   * @param slot_number   Number of an allocated slot.
+   */
+  bool isSlotUsed(const SlotId slot_number) const {
+    return (header_.used_slots[(slot_number - 1) / 64] >>
+            ((slot_number - 1) % 64)) & 1;
+  }
+
+  /**
+   * Marks the slot with the given number as used or unused.
+   *
+   * @param slot_number   Number of an allocated slot.
+   * @param used          Whether the slot holds a record.
+   */
+  void setSlotUsed(const SlotId slot_number, const bool used) {
+    const std::uint64_t bit = std::uint64_t(1) << ((slot_number - 1) % 64);
+    if (used) {
+      header_.used_slots[(slot_number - 1) / 64] |= bit;
+    } else {
+      header_.used_slots[(slot_number - 1) / 64] &= ~bit;
+    }
+  }
+
+  /**
+   * Returns the next used slot after the given slot or Page::INVALID_SLOT if
+   * no slots are used after it.  Scans the used-slot bitmap a word at a time.
+   *
+   * @param start   Slot to start search at.
+   * @return  Next used slot after given slot or Page::INVALID_SLOT.
+   */
+  SlotId getNextUsedSlot(const SlotId start) const;
+
+  /**
+   * Returns the last used slot, Page::INVALID_SLOT if none is used.
+   */
+  SlotId getLastUsedSlot() const;
+
+  /**
+   * Returns the layout metadata of a PAX page.
+   */
+  PaxHeader* paxHeader() { return reinterpret_cast<PaxHeader*>(data_); }
+
+  /**
+   * Returns the layout metadata of a PAX page.
+   */
+  const PaxHeader* paxHeader() const {
+    return reinterpret_cast<const PaxHeader*>(data_);
+  }
+
+  /**
+   * Inserts a record into the first free slot of a PAX page.
+   */
+  RecordId insertPaxRecord(const char* record_data,
+                           const std::size_t record_length);
+
+  /**
+   * Copies the columns of a record into the minipages at the given slot, or
+   * zeroes them if no record is given.
+   */
+  void writePaxRecord(const SlotId slot_number, const char* record_data);
+
+  /**
+   * Moves all records to the end of the page so that the free space,
+   * including the space of deleted records, is contiguous again.
+   */
+  void compact();
+
+  /**
+   * Makes sure the given number of bytes is free in one piece between the
+   * slot array and the records, compacting the page if that is necessary.
+   * Callers must have checked that the page has that much free space.
+   *
+   * @param length  Number of contiguous bytes needed.
+   */
+  void reserveContiguousSpace(const std::size_t length);
+
+  /**
+   * Finds room for record data: below the records if there is enough space
+   * there, else in the hole of a deleted record, else after compacting.
+   * Callers must have checked that the page has that much free space.
+   *
+   * @param length  Length of the record.
+   * @return  Offset the record goes to.
+   */
+  std::uint16_t placeRecord(const std::size_t length);
+
   /**
    * Returns the slot number of an available slot.  If no slots are available
    * to be reused, allocates a new slot.  Updates available slot count in the
@@ -297,12 +694,13 @@ class Page {
    *
    * @param slot_number   Number of slot to insert record into.
    * @param record_data   Bytes that compose the record.
+   * @param record_length Number of bytes in the record.
    * @throws  InvalidSlotException  Thrown when given slot number refers to an
    *                                unallocated slot.
    * @throws  SlotInUseException  Thrown when given slot is in use.
    */
-  void insertRecordInSlot(const SlotId slot_number,
-                          const std::string& record_data);
+  void insertRecordInSlot(const SlotId slot_number, const char* record_data,
+                          const std::size_t record_length);
 
   /**
    * Throws an exception if the given record ID is not valid for this page
@@ -337,6 +735,7 @@ class Page {
   friend class PageFile;
   friend class BlobFile;
   friend class PageIterator;
+  friend class BufMgr;
 };
 
 static_assert(Page::SIZE > sizeof(PageHeader),
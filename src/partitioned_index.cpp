@@ -0,0 +1,226 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "partitioned_index.h"
+
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+// Keys sampled per partition to pick the boundaries.
+const std::size_t SAMPLE_PER_PARTITION = 256;
+
+typedef std::pair<int, RecordId> Entry;
+
+// Orders entries by key, then by record id, so builds are deterministic.
+bool compareEntries(const Entry& a, const Entry& b) {
+  if (a.first != b.first) {
+    return a.first < b.first;
+  }
+  if (a.second.page_number != b.second.page_number) {
+    return a.second.page_number < b.second.page_number;
+  }
+  return a.second.slot_number < b.second.slot_number;
+}
+
+// Runs work(0) .. work(numWorkers - 1) on as many threads, one of them the
+// calling thread.
+void runWorkers(const unsigned numWorkers,
+                const std::function<void(unsigned)>& work) {
+  std::vector<std::thread> threads;
+  for (unsigned w = 1; w < numWorkers; ++w) {
+    threads.push_back(std::thread(work, w));
+  }
+  work(0);
+  for (std::size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+  }
+}
+
+}
+
+PartitionedIndex::PartitionedIndex(const std::string& relationName,
+                                   std::vector<std::string>& outIndexNames,
+                                   BufMgr* bufMgr, const int attrByteOffset,
+                                   const Datatype attrType,
+                                   const int numPartitions,
+                                   const unsigned numThreads)
+    : locks_(std::max(numPartitions, 0)),
+      num_threads_(std::max(numThreads, 1u)) {
+  if (attrType != INTEGER) {
+    throw BadIndexInfoException(
+        "Partitioned indexes support INTEGER keys only.");
+  }
+  if (numPartitions < 1) {
+    throw BadIndexInfoException("A partitioned index needs a partition.");
+  }
+
+  // Workers read the keys of disjoint pages.
+  std::vector<std::vector<Entry> > read(num_threads_);
+  {
+    ParallelFileScan scan(relationName, bufMgr);
+    scan.run(num_threads_, [&](unsigned worker, Page* page) {
+      int keys[PageHeader::MAX_SLOTS];
+      SlotId slots[PageHeader::MAX_SLOTS];
+      const std::size_t count = page->gatherAttribute(
+          attrByteOffset, sizeof(int), reinterpret_cast<char*>(keys), slots);
+      for (std::size_t i = 0; i < count; ++i) {
+        const RecordId rid = {page->page_number(), slots[i], 0};
+        read[worker].push_back(std::make_pair(keys[i], rid));
+      }
+    });
+  }
+
+  // The boundaries are quantiles of an evenly spaced sample of the keys.
+  std::size_t total = 0;
+  for (unsigned w = 0; w < num_threads_; ++w) {
+    total += read[w].size();
+  }
+  const std::size_t stride =
+      std::max<std::size_t>(1, total / (SAMPLE_PER_PARTITION * numPartitions));
+  std::vector<int> sample;
+  for (unsigned w = 0; w < num_threads_; ++w) {
+    for (std::size_t i = 0; i < read[w].size(); i += stride) {
+      sample.push_back(read[w][i].first);
+    }
+  }
+  std::sort(sample.begin(), sample.end());
+  for (int i = 1; i < numPartitions; ++i) {
+    boundaries_.push_back(
+        sample.empty() ? INT_MAX : sample[sample.size() * i / numPartitions]);
+  }
+
+  // Opening files is not threadsafe, so the partitions are created up front.
+  for (int i = 0; i < numPartitions; ++i) {
+    std::ostringstream name;
+    name << relationName << '.' << attrByteOffset << ".part" << i;
+    outIndexNames.push_back(name.str());
+    partitions_.push_back(new BTreeIndex(name.str(), bufMgr, attrByteOffset));
+  }
+
+  // Each worker routes what it read, then sorts and loads whole partitions.
+  std::vector<std::vector<std::vector<Entry> > > routed(
+      num_threads_, std::vector<std::vector<Entry> >(numPartitions));
+  runWorkers(num_threads_, [&](unsigned worker) {
+    for (std::size_t i = 0; i < read[worker].size(); ++i) {
+      routed[worker][partitionOf(read[worker][i].first)].push_back(
+          read[worker][i]);
+    }
+    std::vector<Entry>().swap(read[worker]);
+  });
+  runWorkers(num_threads_, [&](unsigned worker) {
+    for (int p = worker; p < numPartitions; p += num_threads_) {
+      std::vector<Entry> entries;
+      for (unsigned w = 0; w < num_threads_; ++w) {
+        entries.insert(entries.end(), routed[w][p].begin(),
+                       routed[w][p].end());
+        std::vector<Entry>().swap(routed[w][p]);
+      }
+      std::sort(entries.begin(), entries.end(), compareEntries);
+      partitions_[p]->loadSorted(entries);
+    }
+  });
+}
+
+PartitionedIndex::~PartitionedIndex() {
+  for (std::size_t i = 0; i < partitions_.size(); ++i) {
+    delete partitions_[i];
+  }
+}
+
+int PartitionedIndex::partitionOf(const int key) const {
+  return std::upper_bound(boundaries_.begin(), boundaries_.end(), key) -
+         boundaries_.begin();
+}
+
+void PartitionedIndex::insertEntry(const int key, const RecordId rid) {
+  const int p = partitionOf(key);
+  std::lock_guard<std::mutex> lock(locks_[p]);
+  partitions_[p]->insertEntry(&key, rid);
+}
+
+std::size_t PartitionedIndex::lookup(const int key, RecordId* out,
+                                     const std::size_t max) {
+  const int p = partitionOf(key);
+  std::lock_guard<std::mutex> lock(locks_[p]);
+  return partitions_[p]->lookup(key, out, max);
+}
+
+std::size_t PartitionedIndex::rangeScan(const int low, const Operator lowOp,
+                                        const int high, const Operator highOp,
+                                        std::vector<RecordId>& out) {
+  if (low > high) {
+    throw BadScanrangeException();
+  }
+  if (lowOp == LT || lowOp == LTE || highOp == GT || highOp == GTE) {
+    throw BadOpcodesException();
+  }
+  const long long first = lowOp == GT ? static_cast<long long>(low) + 1 : low;
+  const long long last = highOp == LT ? static_cast<long long>(high) - 1 : high;
+  if (first > last) {
+    return 0;
+  }
+
+  // The partitions hold disjoint ranges in order, so concatenating their
+  // results in partition order merges them.
+  const int first_partition = partitionOf(static_cast<int>(first));
+  const int last_partition = partitionOf(static_cast<int>(last));
+  const unsigned overlapping = last_partition - first_partition + 1;
+  std::vector<std::vector<RecordId> > results(overlapping);
+  const unsigned workers = std::min(num_threads_, overlapping);
+  runWorkers(workers, [&](unsigned worker) {
+    for (unsigned i = worker; i < overlapping; i += workers) {
+      scanPartition(first_partition + i, low, lowOp, high, highOp,
+                    results[i]);
+    }
+  });
+
+  std::size_t found = 0;
+  for (unsigned i = 0; i < overlapping; ++i) {
+    out.insert(out.end(), results[i].begin(), results[i].end());
+    found += results[i].size();
+  }
+  return found;
+}
+
+void PartitionedIndex::scanPartition(const int i, const int low,
+                                     const Operator lowOp, const int high,
+                                     const Operator highOp,
+                                     std::vector<RecordId>& out) {
+  std::lock_guard<std::mutex> lock(locks_[i]);
+  BTreeIndex* partition = partitions_[i];
+  try {
+    partition->startScan(&low, lowOp, &high, highOp);
+  } catch (const NoSuchKeyFoundException&) {
+    return;
+  }
+  try {
+    while (true) {
+      RecordId rid;
+      partition->scanNext(rid);
+      out.push_back(rid);
+    }
+  } catch (const IndexScanCompletedException&) {
+  }
+  partition->endScan();
+}
+
+}
@@ -0,0 +1,129 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Index on an INTEGER attribute of a relation split by key range into
+ * independent BTreeIndex partitions.
+ *
+ * Partition i holds the keys from boundary i - 1 up to but excluding
+ * boundary i; the first and last partitions are open ended.  The boundaries
+ * are quantiles of a sample of the keys of the relation, so the partitions
+ * start out about equally large.  Each partition has its own root and its
+ * own lock, so inserts into different partitions do not contend, and a range
+ * scan reads the partitions it overlaps in parallel.
+ *
+ * The partitions are built anew whenever the index is constructed.
+ *
+ * @warning Concurrent inserts must not be logged: attach no LogManager to the
+ * buffer manager.
+ */
+class PartitionedIndex {
+ public:
+  /**
+   * Builds the partitions.  numThreads workers scan the relation, the
+   * boundaries are picked from a sample of the keys they read, and the
+   * workers then sort and bulk load the partitions.
+   *
+   * @param relationName    Name of the relation file.
+   * @param outIndexNames   Returns the names of the files of the partitions.
+   * @param bufMgr          Buffer manager the pages are read through.
+   * @param attrByteOffset  Offset of the key inside the records.
+   * @param attrType        Type of the key, which must be INTEGER.
+   * @param numPartitions   Number of partitions.
+   * @param numThreads      Number of threads building the partitions and
+   *                        scanning them in rangeScan.
+   * @throws  BadIndexInfoException  If the key is not INTEGER or there are no
+   *                                 partitions.
+   */
+  PartitionedIndex(const std::string& relationName,
+                   std::vector<std::string>& outIndexNames, BufMgr* bufMgr,
+                   const int attrByteOffset, const Datatype attrType,
+                   const int numPartitions, const unsigned numThreads);
+
+  /**
+   * Closes the partitions.
+   */
+  ~PartitionedIndex();
+
+  /**
+   * Inserts an entry into its partition.  Safe to call from several threads
+   * at once.
+   */
+  void insertEntry(const int key, const RecordId rid);
+
+  /**
+   * Finds the entries with the given key, see BTreeIndex::lookup.
+   */
+  std::size_t lookup(const int key, RecordId* out, const std::size_t max);
+
+  /**
+   * Finds the entries in a key range.  The partitions the range overlaps are
+   * scanned in parallel and their results appended in key order.
+   *
+   * @param low     Low end of the range.
+   * @param lowOp   GT or GTE.
+   * @param high    High end of the range.
+   * @param highOp  LT or LTE.
+   * @param out     Receives the record ids of the entries in key order.
+   * @return  Number of entries found.
+   * @throws  BadOpcodesException    If an operator is not allowed.
+   * @throws  BadScanrangeException  If low is greater than high.
+   */
+  std::size_t rangeScan(const int low, const Operator lowOp, const int high,
+                        const Operator highOp, std::vector<RecordId>& out);
+
+  /**
+   * Returns the partition holding the given key.
+   */
+  int partitionOf(const int key) const;
+
+  int numPartitions() const { return static_cast<int>(partitions_.size()); }
+
+  /**
+   * Returns the smallest key of every partition but the first.
+   */
+  const std::vector<int>& boundaries() const { return boundaries_; }
+
+  /**
+   * Returns a partition.  It must not be used while other threads use the
+   * partitioned index.
+   */
+  BTreeIndex* partition(const int i) { return partitions_[i]; }
+
+ private:
+  /**
+   * Scans one partition for rangeScan.
+   */
+  void scanPartition(const int i, const int low, const Operator lowOp,
+                     const int high, const Operator highOp,
+                     std::vector<RecordId>& out);
+
+  std::vector<BTreeIndex*> partitions_;
+  std::vector<int> boundaries_;
+
+  /**
+   * One per partition, held while the partition is changed or scanned.
+   */
+  std::vector<std::mutex> locks_;
+
+  unsigned num_threads_;
+};
+
+}
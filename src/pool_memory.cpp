@@ -0,0 +1,201 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pool_memory.h"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#include <numaif.h>
+#else
+#include <fstream>
+#include <sstream>
+#include <string>
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+// Maps length bytes starting on a huge page boundary, where the kernel can
+// put transparent huge pages.  Returns NULL on failure.
+char* mapAligned(const std::size_t length) {
+  const std::size_t padded = length + PoolMemory::HUGE_PAGE_SIZE;
+  void* mem = mmap(NULL, padded, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return NULL;
+  }
+  char* start = static_cast<char*>(mem);
+  char* aligned = reinterpret_cast<char*>(
+      (reinterpret_cast<std::uintptr_t>(start) + PoolMemory::HUGE_PAGE_SIZE -
+       1) & ~static_cast<std::uintptr_t>(PoolMemory::HUGE_PAGE_SIZE - 1));
+  if (aligned > start) {
+    munmap(start, aligned - start);
+  }
+  char* end = start + padded;
+  if (end > aligned + length) {
+    munmap(aligned + length, end - (aligned + length));
+  }
+  return aligned;
+}
+
+#ifndef HAVE_LIBNUMA
+// CPUs of every node, as listed by sysfs; a single node with no CPUs listed
+// if the machine has no NUMA support.
+std::vector<std::vector<int> > readNodeCpus() {
+  std::vector<std::vector<int> > nodes;
+  while (true) {
+    std::ostringstream path;
+    path << "/sys/devices/system/node/node" << nodes.size() << "/cpulist";
+    std::ifstream in(path.str().c_str());
+    if (!in) {
+      break;
+    }
+    // Ranges like "0-3,8-11"
+    std::vector<int> cpus;
+    std::string range;
+    while (std::getline(in, range, ',')) {
+      std::istringstream parse(range);
+      int first;
+      if (!(parse >> first)) {
+        continue;
+      }
+      int last = first;
+      char dash;
+      if (parse >> dash >> last) {
+        last = std::max(first, last);
+      }
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    }
+    nodes.push_back(cpus);
+  }
+  if (nodes.empty()) {
+    nodes.push_back(std::vector<int>());
+  }
+  return nodes;
+}
+
+const std::vector<std::vector<int> >& nodeCpus() {
+  static const std::vector<std::vector<int> > cpus = readNodeCpus();
+  return cpus;
+}
+#endif
+
+}
+
+PoolMemory::PoolMemory(const std::size_t bytes, const bool hugePages)
+    : data_(NULL),
+      length_(std::max<std::size_t>(
+                  1, (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) *
+              HUGE_PAGE_SIZE),
+      backing_(POOL_SMALL_PAGES) {
+  if (hugePages) {
+    // Fails unless the administrator reserved enough huge pages
+    void* mem = mmap(NULL, length_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mem != MAP_FAILED) {
+      data_ = static_cast<char*>(mem);
+      backing_ = POOL_HUGE_PAGES;
+      return;
+    }
+  }
+  data_ = mapAligned(length_);
+  if (data_ == NULL) {
+    throw std::bad_alloc();
+  }
+  // Fails if the kernel has transparent huge pages disabled
+  if (hugePages && madvise(data_, length_, MADV_HUGEPAGE) == 0) {
+    backing_ = POOL_TRANSPARENT_HUGE_PAGES;
+  }
+}
+
+PoolMemory::~PoolMemory() {
+  munmap(data_, length_);
+}
+
+void PoolMemory::bindToNode(const std::size_t offset, const std::size_t length,
+                            const int node) {
+#ifdef HAVE_LIBNUMA
+  // The range is widened to whole pages, a page shared with the neighbouring
+  // range goes to whichever node binds it last
+  const std::size_t page = sysconf(_SC_PAGESIZE);
+  const std::size_t first = offset / page * page;
+  const std::size_t end =
+      std::min(length_, (offset + length + page - 1) / page * page);
+  if (numa_available() < 0 || node > numa_max_node() || end <= first) {
+    return;
+  }
+  // Preferred rather than bound: a full node spills over to the others
+  // instead of failing page faults
+  bitmask* nodes = numa_allocate_nodemask();
+  numa_bitmask_setbit(nodes, node);
+  mbind(data_ + first, end - first, MPOL_PREFERRED, nodes->maskp,
+        nodes->size + 1, 0);
+  numa_bitmask_free(nodes);
+#endif
+}
+
+int PoolMemory::numNodes() {
+#ifdef HAVE_LIBNUMA
+  return numa_available() < 0 ? 1 : numa_max_node() + 1;
+#else
+  return static_cast<int>(nodeCpus().size());
+#endif
+}
+
+int PoolMemory::currentNode() {
+  const int cpu = sched_getcpu();
+  if (cpu < 0) {
+    return 0;
+  }
+#ifdef HAVE_LIBNUMA
+  const int node = numa_available() < 0 ? 0 : numa_node_of_cpu(cpu);
+  return std::max(node, 0);
+#else
+  const std::vector<std::vector<int> >& nodes = nodeCpus();
+  for (std::size_t n = 0; n < nodes.size(); ++n) {
+    if (std::find(nodes[n].begin(), nodes[n].end(), cpu) != nodes[n].end()) {
+      return static_cast<int>(n);
+    }
+  }
+  return 0;
+#endif
+}
+
+std::thread PoolMemory::startOnNode(const int node,
+                                    const std::function<void()>& work) {
+  return std::thread([node, work]() {
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+      numa_run_on_node(node);
+    }
+#else
+    const std::vector<std::vector<int> >& nodes = nodeCpus();
+    if (node < static_cast<int>(nodes.size()) && !nodes[node].empty()) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      for (std::size_t i = 0; i < nodes[node].size(); ++i) {
+        CPU_SET(nodes[node][i], &cpus);
+      }
+      sched_setaffinity(0, sizeof(cpus), &cpus);
+    }
+#endif
+    work();
+  });
+}
+
+}
@@ -0,0 +1,131 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <thread>
+
+namespace badgerdb {
+
+/**
+ * @brief Kind of pages a PoolMemory mapping got from the operating system.
+ */
+enum PoolBacking {
+  /**
+   * Regular pages.
+   */
+  POOL_SMALL_PAGES = 0,
+
+  /**
+   * Regular pages the kernel was asked to merge into transparent huge pages.
+   */
+  POOL_TRANSPARENT_HUGE_PAGES = 1,
+
+  /**
+   * Huge pages reserved by the administrator, mapped with MAP_HUGETLB.
+   */
+  POOL_HUGE_PAGES = 2
+};
+
+/**
+ * @brief How a BufMgr lays out its frames in memory.
+ */
+struct PoolOptions {
+  PoolOptions() : huge_pages(false), numa(false) {}
+
+  /**
+   * Back the frames with huge pages if reserved ones are available, otherwise
+   * with transparent huge pages, otherwise with regular pages.
+   */
+  bool huge_pages;
+
+  /**
+   * Split the frames into one partition per NUMA node, placed on that node,
+   * and take victims from the partition of the node the caller runs on
+   * before the others.
+   */
+  bool numa;
+};
+
+/**
+ * @brief Anonymous memory mapping for the frames of a buffer pool, and the
+ * NUMA topology the mapping is placed on.
+ *
+ * Placement uses libnuma when the build defines HAVE_LIBNUMA.  Otherwise a
+ * range is placed by first touching it from a thread running on the node.
+ */
+class PoolMemory {
+ public:
+  /**
+   * Size of a huge page, the alignment of every mapping.
+   */
+  static const std::size_t HUGE_PAGE_SIZE = 2 << 20;
+
+  /**
+   * Maps zeroed memory, trying explicit huge pages, then transparent huge
+   * pages, if asked to.
+   *
+   * @param bytes      Size of the mapping, rounded up to HUGE_PAGE_SIZE.
+   * @param hugePages  True to back the mapping with huge pages if possible.
+   * @throws  std::bad_alloc  If the memory cannot be mapped at all.
+   */
+  PoolMemory(const std::size_t bytes, const bool hugePages);
+
+  /**
+   * Unmaps the memory.
+   */
+  ~PoolMemory();
+
+  char* data() const { return data_; }
+  PoolBacking backing() const { return backing_; }
+
+  /**
+   * Asks for a range of the mapping to be placed on a node, if it has room,
+   * when it is first touched.  Does nothing without libnuma, leaving it to
+   * first touch.
+   *
+   * @param offset  Start of the range.
+   * @param length  Length of the range.
+   * @param node    NUMA node.
+   */
+  void bindToNode(const std::size_t offset, const std::size_t length,
+                  const int node);
+
+  /**
+   * Returns the number of NUMA nodes of the machine, 1 if it has no NUMA
+   * support.
+   */
+  static int numNodes();
+
+  /**
+   * Returns the NUMA node of the CPU the calling thread runs on.
+   */
+  static int currentNode();
+
+  /**
+   * Starts a thread restricted to the CPUs of a node running the given work.
+   * The memory it touches first is placed on that node.
+   *
+   * @param node  NUMA node.
+   * @param work  Work to run.
+   * @return  The thread, to be joined.
+   */
+  static std::thread startOnNode(const int node,
+                                 const std::function<void()>& work);
+
+ private:
+  PoolMemory(const PoolMemory&);
+  PoolMemory& operator=(const PoolMemory&);
+
+  char* data_;
+  std::size_t length_;
+  PoolBacking backing_;
+};
+
+}
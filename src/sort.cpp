@@ -0,0 +1,452 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "sort.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+#include "filescan.h"
+#include "exceptions/bad_scan_param_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+// Run pages start with the number of records and the offset of the free
+// space; each record is preceded by its length.
+const std::size_t RUN_PAGE_HEADER = 2 * sizeof(std::uint32_t);
+
+// Tells the run files of different sorts apart.
+std::atomic<unsigned> next_sort_id(0);
+
+}
+
+/**
+ * @brief Reads the records of one run during a merge, a page at a time.
+ */
+class SortRunReader {
+ public:
+  SortRunReader(SortRun* run, SortPrefetcher* prefetcher)
+      : run(run),
+        next_page(0),
+        current(0),
+        spare_ready(false),
+        spare_valid(false),
+        left(0),
+        pos(NULL),
+        record(NULL),
+        length(0),
+        exhausted(false),
+        prefetcher_(prefetcher) {
+    prefetcher_->request(this);
+  }
+
+  /**
+   * Moves to the next record of the run, switching to the prefetched page
+   * when the current one is used up.
+   */
+  void advance() {
+    if (left == 0) {
+      prefetcher_->wait(this);
+      if (!spare_valid) {
+        exhausted = true;
+        return;
+      }
+      current ^= 1;
+      std::memcpy(&left, buffers[current], sizeof(left));
+      pos = buffers[current] + RUN_PAGE_HEADER;
+      prefetcher_->request(this);
+    }
+    std::uint16_t record_length;
+    std::memcpy(&record_length, pos, sizeof(record_length));
+    record = pos + sizeof(record_length);
+    length = record_length;
+    pos = record + record_length;
+    --left;
+  }
+
+  SortRun* run;
+
+  /**
+   * Index in run->pages of the next page to prefetch.
+   */
+  std::size_t next_page;
+
+  /**
+   * The page being consumed and the page being prefetched.
+   */
+  char buffers[2][Page::SIZE];
+
+  /**
+   * Buffer being consumed.
+   */
+  int current;
+
+  /**
+   * Set by the prefetcher once the spare buffer has been handled.
+   */
+  bool spare_ready;
+
+  /**
+   * True if the spare buffer holds a page, false if the run has no more.
+   */
+  bool spare_valid;
+
+  /**
+   * Records left on the current page after the current one.
+   */
+  std::uint32_t left;
+
+  /**
+   * Start of the length of the next record on the current page.
+   */
+  const char* pos;
+
+  /**
+   * Current record.
+   */
+  const char* record;
+  std::size_t length;
+  double key;
+  bool exhausted;
+
+ private:
+  SortPrefetcher* prefetcher_;
+};
+
+SortPrefetcher::SortPrefetcher(BufMgr* bufMgr)
+    : bufMgr_(bufMgr),
+      stop_(false),
+      thread_(&SortPrefetcher::run, this) {
+}
+
+SortPrefetcher::~SortPrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cond_.notify_one();
+  thread_.join();
+}
+
+void SortPrefetcher::request(SortRunReader* reader) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reader->spare_ready = false;
+    requests_.push_back(reader);
+  }
+  work_cond_.notify_one();
+}
+
+void SortPrefetcher::wait(SortRunReader* reader) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cond_.wait(lock, [reader]() { return reader->spare_ready; });
+}
+
+void SortPrefetcher::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cond_.wait(lock, [this]() { return stop_ || !requests_.empty(); });
+    if (requests_.empty()) {
+      return;
+    }
+    SortRunReader* reader = requests_.front();
+    requests_.pop_front();
+    lock.unlock();
+
+    // The consumer does not touch the spare buffer until spare_ready is set.
+    bool valid = false;
+    if (reader->next_page < reader->run->pages.size()) {
+      const PageId page_number = reader->run->pages[reader->next_page];
+      Page* page;
+      bufMgr_->readPage(reader->run->file, page_number, page);
+      std::memcpy(reader->buffers[reader->current ^ 1], page, Page::SIZE);
+      bufMgr_->unPinPage(reader->run->file, page_number, false);
+      ++reader->next_page;
+      valid = true;
+    }
+
+    lock.lock();
+    reader->spare_valid = valid;
+    reader->spare_ready = true;
+    done_cond_.notify_all();
+  }
+}
+
+ExternalSort::ExternalSort(const std::string& relationName, BufMgr* bufMgr,
+                           const int attrByteOffset, const Datatype attrType,
+                           const std::size_t bufferFrames)
+    : bufMgr_(bufMgr),
+      attr_byte_offset_(attrByteOffset),
+      attr_type_(attrType),
+      buffer_frames_(bufferFrames),
+      initial_runs_(0),
+      merge_passes_(0),
+      next_run_number_(0),
+      advance_winner_(false),
+      prefetcher_(NULL) {
+  if ((attrType != INTEGER && attrType != DOUBLE) || bufferFrames < 5) {
+    throw BadScanParamException();
+  }
+  std::ostringstream name;
+  name << relationName << ".sort" << next_sort_id++;
+  name_ = name.str();
+
+  // Run generation: fill the workspace, sort it, write it out.  Each record
+  // costs its bytes plus an entry of the array that gets sorted.
+  const std::size_t budget = bufferFrames * Page::SIZE;
+  std::vector<char> workspace(budget);
+  std::vector<RecordView> records;
+  std::size_t used = 0;
+  {
+    FileScan scan(relationName, bufMgr_);
+    std::string scratch;
+    try {
+      RecordId rid;
+      while (true) {
+        scan.scanNext(rid);
+        const RecordView record = scan.getRecordView(scratch);
+        const std::size_t entry_size = sizeof(std::pair<double, std::uint32_t>);
+        if (used + record.length + (records.size() + 1) * entry_size > budget) {
+          writeRun(records);
+          records.clear();
+          used = 0;
+        }
+        std::memcpy(&workspace[used], record.data, record.length);
+        const RecordView stored = {&workspace[used], record.length};
+        records.push_back(stored);
+        used += record.length;
+      }
+    } catch (const EndOfFileException&) {
+    }
+  }
+  if (!records.empty()) {
+    writeRun(records);
+  }
+  initial_runs_ = runs_.size();
+
+  // Merge passes, each reader holding two frames and the output one.
+  prefetcher_ = new SortPrefetcher(bufMgr_);
+  const std::size_t fan_in = (bufferFrames - 1) / 2;
+  while (runs_.size() > fan_in) {
+    std::vector<SortRun*> merged;
+    for (std::size_t first = 0; first < runs_.size(); first += fan_in) {
+      const std::size_t last = std::min(first + fan_in, runs_.size());
+      if (last - first == 1) {
+        merged.push_back(runs_[first]);
+        continue;
+      }
+      startMerge(std::vector<SortRun*>(runs_.begin() + first,
+                                       runs_.begin() + last));
+      SortRun* out = createRun();
+      Page* page = NULL;
+      RecordView record;
+      try {
+        while (true) {
+          next(record);
+          appendToRun(out, page, record.data, record.length);
+        }
+      } catch (const EndOfFileException&) {
+      }
+      finishRun(out, page);
+      endMerge();
+      merged.push_back(out);
+    }
+    runs_.swap(merged);
+    ++merge_passes_;
+  }
+  startMerge(runs_);
+  runs_.clear();
+  ++merge_passes_;
+}
+
+ExternalSort::~ExternalSort() {
+  endMerge();
+  delete prefetcher_;
+  for (std::size_t i = 0; i < runs_.size(); ++i) {
+    removeRun(runs_[i]);
+  }
+}
+
+void ExternalSort::next(RecordView& outRecord) {
+  if (advance_winner_) {
+    const std::size_t winner = tree_[0];
+    SortRunReader* reader = readers_[winner];
+    reader->advance();
+    if (!reader->exhausted) {
+      reader->key = key(reader->record);
+    }
+    adjust(winner);
+    advance_winner_ = false;
+  }
+  if (readers_.empty() || readers_[tree_[0]]->exhausted) {
+    throw EndOfFileException();
+  }
+  const SortRunReader* winner = readers_[tree_[0]];
+  outRecord.data = winner->record;
+  outRecord.length = winner->length;
+  advance_winner_ = true;
+}
+
+double ExternalSort::key(const char* record) const {
+  if (attr_type_ == INTEGER) {
+    int value;
+    std::memcpy(&value, record + attr_byte_offset_, sizeof(value));
+    return value;
+  }
+  double value;
+  std::memcpy(&value, record + attr_byte_offset_, sizeof(value));
+  return value;
+}
+
+void ExternalSort::writeRun(const std::vector<RecordView>& records) {
+  // Sorting (key, position) pairs keeps records with equal keys in scan order.
+  std::vector<std::pair<double, std::uint32_t> > order(records.size());
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    if (records[i].length < attr_byte_offset_ +
+            (attr_type_ == INTEGER ? sizeof(int) : sizeof(double))) {
+      throw BadScanParamException();
+    }
+    order[i] = std::make_pair(key(records[i].data), i);
+  }
+  std::sort(order.begin(), order.end());
+
+  SortRun* run = createRun();
+  Page* page = NULL;
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const RecordView& record = records[order[i].second];
+    appendToRun(run, page, record.data, record.length);
+  }
+  finishRun(run, page);
+  runs_.push_back(run);
+}
+
+SortRun* ExternalSort::createRun() {
+  SortRun* run = new SortRun();
+  std::ostringstream name;
+  name << name_ << '.' << next_run_number_++;
+  run->name = name.str();
+  try {
+    File::remove(run->name);
+  } catch (const FileNotFoundException&) {
+  }
+  run->file = new BlobFile(run->name, true);
+  return run;
+}
+
+void ExternalSort::appendToRun(SortRun* run, Page*& page, const char* data,
+                               const std::size_t length) {
+  char* bytes = reinterpret_cast<char*>(page);
+  std::uint32_t header[2];
+  if (page != NULL) {
+    std::memcpy(header, bytes, sizeof(header));
+  }
+  const std::uint16_t record_length = length;
+  if (page == NULL ||
+      header[1] + sizeof(record_length) + length > Page::SIZE) {
+    if (page != NULL) {
+      bufMgr_->unPinPage(run->file, run->pages.back(), true);
+    }
+    PageId page_number;
+    bufMgr_->allocPage(run->file, page_number, page);
+    run->pages.push_back(page_number);
+    bytes = reinterpret_cast<char*>(page);
+    header[0] = 0;
+    header[1] = RUN_PAGE_HEADER;
+  }
+  std::memcpy(bytes + header[1], &record_length, sizeof(record_length));
+  std::memcpy(bytes + header[1] + sizeof(record_length), data, length);
+  ++header[0];
+  header[1] += sizeof(record_length) + length;
+  std::memcpy(bytes, header, sizeof(header));
+}
+
+void ExternalSort::finishRun(SortRun* run, Page* page) {
+  if (page != NULL) {
+    bufMgr_->unPinPage(run->file, run->pages.back(), true);
+  }
+  // Written out and evicted, so runs do not crowd the buffer pool.
+  bufMgr_->flushFile(run->file);
+}
+
+void ExternalSort::removeRun(SortRun* run) {
+  bufMgr_->flushFile(run->file);
+  delete run->file;
+  File::remove(run->name);
+  delete run;
+}
+
+void ExternalSort::startMerge(const std::vector<SortRun*>& runs) {
+  merging_ = runs;
+  for (std::size_t i = 0; i < runs.size(); ++i) {
+    readers_.push_back(new SortRunReader(runs[i], prefetcher_));
+  }
+  for (std::size_t i = 0; i < readers_.size(); ++i) {
+    readers_[i]->advance();
+    if (!readers_[i]->exhausted) {
+      readers_[i]->key = key(readers_[i]->record);
+    }
+  }
+  // Every node starts out holding a virtual reader that beats all others;
+  // replaying each leaf pushes one of them out through the root.
+  const std::size_t k = readers_.size();
+  tree_.assign(std::max<std::size_t>(k, 1), k);
+  for (std::size_t i = k; i > 0; --i) {
+    adjust(i - 1);
+  }
+  advance_winner_ = false;
+}
+
+void ExternalSort::adjust(std::size_t reader) {
+  const std::size_t k = readers_.size();
+  for (std::size_t node = (reader + k) / 2; node > 0; node /= 2) {
+    if (before(tree_[node], reader)) {
+      std::swap(tree_[node], reader);
+    }
+  }
+  tree_[0] = reader;
+}
+
+bool ExternalSort::before(const std::size_t a, const std::size_t b) const {
+  const std::size_t k = readers_.size();
+  if (a == k || b == k) {
+    return a == k;
+  }
+  if (readers_[a]->exhausted || readers_[b]->exhausted) {
+    return !readers_[a]->exhausted;
+  }
+  if (readers_[a]->key != readers_[b]->key) {
+    return readers_[a]->key < readers_[b]->key;
+  }
+  // Earlier runs hold records that came earlier in the scan.
+  return a < b;
+}
+
+void ExternalSort::endMerge() {
+  // A reader may still have a prefetch outstanding.
+  for (std::size_t i = 0; i < readers_.size(); ++i) {
+    if (!readers_[i]->exhausted) {
+      prefetcher_->wait(readers_[i]);
+    }
+    delete readers_[i];
+  }
+  readers_.clear();
+  tree_.clear();
+  for (std::size_t i = 0; i < merging_.size(); ++i) {
+    removeRun(merging_[i]);
+  }
+  merging_.clear();
+  advance_winner_ = false;
+}
+
+}
@@ -0,0 +1,248 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Sorted run of records stored in a temporary BlobFile.
+ *
+ * Each page of the file starts with the number of records on it, followed by
+ * the records, each preceded by its length.
+ */
+struct SortRun {
+  /**
+   * Name of the run file.
+   */
+  std::string name;
+
+  /**
+   * The run file.
+   */
+  BlobFile* file;
+
+  /**
+   * Pages of the run, in order.
+   */
+  std::vector<PageId> pages;
+};
+
+class SortRunReader;
+
+/**
+ * @brief Reads the pages of sorted runs ahead of the merge on a thread of
+ * its own.
+ *
+ * Every run reader owns two page buffers.  While the merge consumes one, the
+ * prefetcher fills the other with the next page of the run, so the merge only
+ * waits for I/O when it overtakes the prefetcher.
+ */
+class SortPrefetcher {
+ public:
+  /**
+   * Starts the prefetch thread.
+   *
+   * @param bufMgr  Buffer manager the run pages are read through.
+   */
+  SortPrefetcher(BufMgr* bufMgr);
+
+  /**
+   * Stops the prefetch thread after the outstanding requests.
+   */
+  ~SortPrefetcher();
+
+  /**
+   * Asks for the next page of the given reader to be loaded into its spare
+   * buffer.
+   */
+  void request(SortRunReader* reader);
+
+  /**
+   * Waits until the spare buffer of the given reader has been loaded.
+   */
+  void wait(SortRunReader* reader);
+
+ private:
+  /**
+   * Body of the prefetch thread.
+   */
+  void run();
+
+  BufMgr* bufMgr_;
+  std::mutex mutex_;
+  std::condition_variable work_cond_;
+  std::condition_variable done_cond_;
+  std::deque<SortRunReader*> requests_;
+  bool stop_;
+  std::thread thread_;
+};
+
+/**
+ * @brief External merge sort of the records of a relation on an INTEGER or
+ * DOUBLE attribute.
+ *
+ * The relation is read with a FileScan into a workspace of the given number
+ * of buffer frames.  Each time the workspace is full its records are sorted
+ * and written to a temporary BlobFile as a run.  Runs are then merged with a
+ * loser tree, as many at a time as the frames allow with two page buffers per
+ * run for prefetching.  Intermediate passes write longer runs until a single
+ * merge is left, which is streamed to the caller through next().  Records
+ * with equal keys come out in the order of the scan.
+ *
+ * @warning This class is not threadsafe.
+ */
+class ExternalSort {
+ public:
+  /**
+   * Sorts the relation up to the final merge.
+   *
+   * @param relationName    Name of the relation file.
+   * @param bufMgr          Buffer manager the relation and runs are read and
+   *                        written through.
+   * @param attrByteOffset  Offset of the sort attribute in the records.
+   * @param attrType        INTEGER or DOUBLE.
+   * @param bufferFrames    Memory budget in buffer frames, at least 5.
+   * @throws  BadScanParamException  If the type or the budget is not
+   *                                 supported.
+   */
+  ExternalSort(const std::string& relationName, BufMgr* bufMgr,
+               const int attrByteOffset, const Datatype attrType,
+               const std::size_t bufferFrames);
+
+  /**
+   * Stops the merge and removes the run files.
+   */
+  ~ExternalSort();
+
+  /**
+   * Returns the next record in sorted order.  The view is valid until the
+   * next call.
+   *
+   * @param outRecord  Set to the record.
+   * @throws  EndOfFileException  If all records have been returned.
+   */
+  void next(RecordView& outRecord);
+
+  /**
+   * Returns the number of runs written while reading the relation.
+   */
+  std::size_t numInitialRuns() const { return initial_runs_; }
+
+  /**
+   * Returns the number of merge passes, counting the final streamed one.
+   */
+  std::size_t numMergePasses() const { return merge_passes_; }
+
+ private:
+  /**
+   * Returns the sort key of a record.
+   */
+  double key(const char* record) const;
+
+  /**
+   * Sorts the records in the workspace and writes them as a new run.
+   */
+  void writeRun(const std::vector<RecordView>& records);
+
+  /**
+   * Creates an empty run file.
+   */
+  SortRun* createRun();
+
+  /**
+   * Appends a record to a run being written, starting a new page when the
+   * current one is full.
+   */
+  void appendToRun(SortRun* run, Page*& page, const char* data,
+                   const std::size_t length);
+
+  /**
+   * Unpins the last page of a run being written and evicts the run from the
+   * buffer pool.
+   */
+  void finishRun(SortRun* run, Page* page);
+
+  /**
+   * Removes a run file.
+   */
+  void removeRun(SortRun* run);
+
+  /**
+   * Opens readers on the given runs and builds the loser tree over them.
+   */
+  void startMerge(const std::vector<SortRun*>& runs);
+
+  /**
+   * Replays the loser tree from the leaf of the given reader to the root.
+   */
+  void adjust(std::size_t reader);
+
+  /**
+   * Returns true if the current record of reader a sorts before the one of
+   * reader b.  Exhausted readers sort last.
+   */
+  bool before(const std::size_t a, const std::size_t b) const;
+
+  /**
+   * Ends the current merge, closing its readers.
+   */
+  void endMerge();
+
+  BufMgr* bufMgr_;
+  std::string name_;
+  int attr_byte_offset_;
+  Datatype attr_type_;
+  std::size_t buffer_frames_;
+  std::size_t initial_runs_;
+  std::size_t merge_passes_;
+  std::size_t next_run_number_;
+
+  /**
+   * Runs waiting to be merged.
+   */
+  std::vector<SortRun*> runs_;
+
+  /**
+   * Runs of the current merge.
+   */
+  std::vector<SortRun*> merging_;
+
+  /**
+   * Readers of the current merge, one per run.
+   */
+  std::vector<SortRunReader*> readers_;
+
+  /**
+   * Loser tree: tree_[0] is the reader with the smallest record, the other
+   * nodes hold the loser of the match played there.
+   */
+  std::vector<std::size_t> tree_;
+
+  /**
+   * True if the winner has been returned by next() and has to advance before
+   * the next record is chosen.
+   */
+  bool advance_winner_;
+
+  SortPrefetcher* prefetcher_;
+};
+
+}
@@ -24,6 +24,11 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Log sequence number of a record in the write-ahead log.
+ */
+typedef std::uint64_t Lsn;
+
 /**
  * @brief Identifier for a record in a page.
  */
@@ -64,4 +69,63 @@ struct RecordId {
   }
 };
 
+/**
+ * @brief RecordId as index pages store it, without the padding: 6 bytes,
+ * aligned to 2 so arrays of them pack tightly.
+ */
+struct PackedRecordId {
+  /**
+   * Low and high halves of the page number.
+   */
+  std::uint16_t page_low;
+  std::uint16_t page_high;
+
+  SlotId slot_number;
+
+  /**
+   * Stores the given record ID.
+   *
+   * @param rid   Record ID to store.
+   * @return  This packed ID.
+   */
+  PackedRecordId& operator=(const RecordId& rid) {
+    page_low = static_cast<std::uint16_t>(rid.page_number);
+    page_high = static_cast<std::uint16_t>(rid.page_number >> 16);
+    slot_number = rid.slot_number;
+    return *this;
+  }
+
+  /**
+   * Returns the record ID stored.
+   */
+  operator RecordId() const {
+    RecordId rid = {static_cast<PageId>(page_low) |
+                        (static_cast<PageId>(page_high) << 16),
+                    slot_number, 0};
+    return rid;
+  }
+};
+
+/**
+ * @brief Datatype enumeration type.
+ */
+enum Datatype
+{
+	INTEGER = 0,
+	DOUBLE = 1,
+	STRING = 2
+};
+
+/**
+ * @brief Scan operations enumeration. Passed to BTreeIndex::startScan() and
+ * FileScan::scanNextBatch().
+ */
+enum Operator
+{ 
+	LT, 	/* Less Than */
+	LTE,	/* Less Than or Equal to */
+	GTE,	/* Greater Than or Equal to */
+	GT		/* Greater Than */
+};
+
 }